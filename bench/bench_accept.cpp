@@ -0,0 +1,188 @@
+// 短连接（每个请求一条连接，Connection: close）的建连开销
+//
+// 进程内启动 1 个 Worker 的 HttpServer，客户端在同一进程中串行地建连、发一个
+// GET /test.html、读完响应后关闭，三种监听配置交替运行若干轮：
+//   baseline      accept 后等下一轮 epoll_wait 再读
+//   defer-accept  TCP_DEFER_ACCEPT，连接带着请求才交给 accept，accept 后立即读
+//   fastopen      再加服务端 TFO，客户端用 MSG_FASTOPEN 把请求放进 SYN
+// 报告每秒连接数、/_hphs/stats 中 Worker 线程每连接的 CPU 时间和系统调用数。
+// TFO 需要 net.ipv4.tcp_fastopen 同时含 1（客户端）和 2（服务端），
+// 否则退化为普通握手，结果中的 "SYN data" 比例为 0。
+//
+//   bench_accept [seconds_per_round] [rounds]
+
+#include "http_server.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const int PORT = 18438;
+
+enum Mode { BASELINE, DEFER_ACCEPT, FASTOPEN, MODE_COUNT };
+static const char* const MODE_NAMES[] = {"baseline", "defer-accept", "fastopen"};
+
+static sockaddr_in serverAddress() {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return addr;
+}
+
+// 一条短连接：建连、发请求、读完响应。syn_data 返回请求是否随 SYN 送达
+static bool oneShot(const std::string& request, bool fastopen, bool& syn_data) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    sockaddr_in addr = serverAddress();
+    bool ok;
+    if (fastopen) {
+        ok = sendto(fd, request.data(), request.size(), MSG_FASTOPEN,
+                    reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) ==
+             static_cast<ssize_t>(request.size());
+    } else {
+        ok = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+             write(fd, request.data(), request.size()) == static_cast<ssize_t>(request.size());
+    }
+    // 缓存命中的响应总是 keep-alive，按 Content-Length 读完整个响应后由客户端关闭
+    std::string resp;
+    char buf[4096];
+    size_t expected = std::string::npos;
+    ssize_t n;
+    while (ok && resp.size() < expected && (n = read(fd, buf, sizeof(buf))) > 0) {
+        resp.append(buf, n);
+        size_t head = resp.find("\r\n\r\n");
+        size_t length = resp.find("Content-Length: ");
+        if (expected == std::string::npos && head != std::string::npos && length < head)
+            expected = head + 4 + std::strtoull(resp.c_str() + length + 16, nullptr, 10);
+    }
+    tcp_info info{};
+    socklen_t len = sizeof(info);
+    syn_data = fastopen && getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0 &&
+               (info.tcpi_options & TCPI_OPT_SYN_DATA);
+    close(fd);
+    return ok && resp.size() == expected;
+}
+
+// 从 /_hphs/stats 读取 Worker 的 CPU 时间（毫秒）、请求数和系统调用总数
+static bool fetchStats(double& cpu_ms, double& requests, double& syscalls) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr = serverAddress();
+    const std::string req = "GET /_hphs/stats HTTP/1.1\r\nConnection: close\r\n\r\n";
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        write(fd, req.data(), req.size()) != static_cast<ssize_t>(req.size())) {
+        close(fd);
+        return false;
+    }
+    std::string resp;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) resp.append(buf, n);
+    close(fd);
+
+    size_t cpu = resp.find("\"cpu_ms\":");
+    size_t total = resp.find("\"requests\":", resp.find("\"active_workers\""));
+    size_t calls = resp.find("\"syscalls\":{", total);
+    if (cpu == std::string::npos || total == std::string::npos || calls == std::string::npos)
+        return false;
+    cpu_ms = std::atof(resp.c_str() + cpu + 9);
+    requests = std::atof(resp.c_str() + total + 11);
+    syscalls = 0;
+    size_t end = resp.find('}', calls);
+    for (size_t p = resp.find(':', calls + 12); p < end; p = resp.find(':', p + 1))
+        syscalls += std::atof(resp.c_str() + p + 1);
+    return true;
+}
+
+struct RoundResult {
+    double cps;
+    double cpu_ns;          // Worker 线程每连接 CPU 时间
+    double syscalls;        // Worker 线程每连接系统调用数
+    double syn_data;        // 请求随 SYN 送达的比例
+};
+
+static RoundResult runRound(Mode mode, double seconds) {
+    ServerConfig config;
+    config.port = PORT;
+    config.worker_count = 1;
+    config.www_root = HPHS_WWW_ROOT;
+    config.io_threads = 0;
+    if (mode != BASELINE) config.defer_accept_s = 1;
+    if (mode == FASTOPEN) config.fastopen_queue = 256;
+
+    HttpServer server(config);
+    server.start();
+
+    const std::string request = "GET /test.html HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    bool syn_data = false;
+    // 等监听就绪，TFO 模式下顺便取得 cookie
+    for (int i = 0; i < 100 && !oneShot(request, mode == FASTOPEN, syn_data); ++i) usleep(10000);
+
+    double cpu_before, req_before, calls_before, cpu_after, req_after, calls_after;
+    if (!fetchStats(cpu_before, req_before, calls_before)) {
+        std::fprintf(stderr, "stats failed\n");
+        std::exit(1);
+    }
+
+    uint64_t connections = 0, with_data = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (!oneShot(request, mode == FASTOPEN, syn_data)) {
+            std::fprintf(stderr, "request failed\n");
+            std::exit(1);
+        }
+        ++connections;
+        with_data += syn_data;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!fetchStats(cpu_after, req_after, calls_after)) {
+        std::fprintf(stderr, "stats failed\n");
+        std::exit(1);
+    }
+    server.stop();
+
+    // 两次取统计之间有 connections 个短连接和 1 个统计请求
+    double served = req_after - req_before;
+    return {connections / elapsed, (cpu_after - cpu_before) * 1e6 / served,
+            (calls_after - calls_before) / served, static_cast<double>(with_data) / connections};
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 2.0;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 3;
+
+    // 交替运行，抵消机器负载随时间的漂移
+    RoundResult sum[MODE_COUNT] = {};
+    for (int r = 0; r < rounds; ++r) {
+        for (int mode = 0; mode < MODE_COUNT; ++mode) {
+            RoundResult result = runRound(static_cast<Mode>(mode), seconds);
+            std::printf("round %d %-13s %10.0f conn/s %8.0f ns/conn (worker CPU) %5.2f syscalls/conn\n",
+                        r + 1, MODE_NAMES[mode], result.cps, result.cpu_ns, result.syscalls);
+            std::fflush(stdout);
+            sum[mode].cps += result.cps;
+            sum[mode].cpu_ns += result.cpu_ns;
+            sum[mode].syscalls += result.syscalls;
+            sum[mode].syn_data += result.syn_data;
+        }
+    }
+
+    std::printf("\n%-13s %10s %10s %14s %10s\n", "", "conn/s", "ns/conn", "syscalls/conn",
+                "SYN data");
+    for (int mode = 0; mode < MODE_COUNT; ++mode) {
+        std::printf("%-13s %10.0f %10.0f %14.2f %9.0f%%\n", MODE_NAMES[mode],
+                    sum[mode].cps / rounds, sum[mode].cpu_ns / rounds, sum[mode].syscalls / rounds,
+                    sum[mode].syn_data / rounds * 100);
+    }
+    std::printf("defer-accept vs baseline: %+.1f%% conn/s, fastopen vs baseline: %+.1f%% conn/s\n",
+                (sum[DEFER_ACCEPT].cps / sum[BASELINE].cps - 1) * 100,
+                (sum[FASTOPEN].cps / sum[BASELINE].cps - 1) * 100);
+    return 0;
+}
@@ -0,0 +1,133 @@
+// 分配审计：缓存命中、304 和错误响应路径上不应有任何堆分配（需要 -DHPHS_ALLOC_AUDIT=ON）
+//
+// Worker 不启动事件循环线程，连接走 MemoryTransport，每种请求先预热若干轮
+// （连接的读写缓冲区、预构建错误响应等一次性分配在这里完成），
+// 之后只统计 Worker::poll 内的分配：客户端数据在 reset 之前喂入，传输层自身的分配不计。
+// 跑两遍：第一遍关闭 IO 线程池和原始请求头缓存，每个请求都完整解析、在事件循环内处理；
+// 第二遍用发布时的默认配置，404 经 IO 线程池回投，重复的请求头由原始请求头缓存直接命中。
+// IO 线程上的分配（完成消息）不在 Worker 线程，不计入。
+// 有任何分配时打印调用点并返回 1，可直接放进 CI。
+//
+//   bench_alloc [iterations]
+
+#include "alloc_audit.h"
+#include "bench_util.h"
+#include "io_pool.h"
+#include "memory_transport.h"
+#include "response_cache.h"
+#include "router.h"
+#include "worker.h"
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+struct Case {
+    const char* name;
+    std::string request;
+    bool closes;        // 响应后关闭连接，每轮新建连接
+};
+
+// 返回本轮 poll 内的分配次数；sites 累计到调用方
+static uint64_t serveOnce(Worker& worker, MemoryTransport& transport, const Case& c, int& fd,
+                          bool audit) {
+    if (c.closes) {
+        fd = transport.open();
+        worker.attachConnection(fd);
+    }
+    transport.feed(fd, c.request);
+    if (audit) alloc_audit::reset();
+    // 交给 IO 线程池的请求在完成回投之前 poll 返回 0
+    while (worker.poll(0) > 0 || worker.ioInflight() > 0) {
+    }
+    return audit ? alloc_audit::threadStats().count : 0;
+}
+
+// 用给定配置跑全部用例，返回有分配的用例数
+static int audit(const char* label, const ServerConfig& config, const ResponseCache& cache,
+                 const Router& router, uint64_t iterations) {
+    std::printf("%s\n", label);
+    std::unique_ptr<IoPool> io_pool;
+    if (config.io_threads > 0) io_pool = std::make_unique<IoPool>(config.io_threads);
+    Worker worker(0, config, cache, router, io_pool.get());
+    MemoryTransport transport(false);
+    worker.setTransport(&transport);
+    std::string etag(ResponseCache::etagOf(cache.find("/test.html")));
+
+    const Case cases[] = {
+        {"cache hit", "GET /test.html HTTP/1.1\r\nHost: localhost\r\n\r\n", false},
+        {"cache hit (directory)", "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n", false},
+        {"cache hit (normalized, query)",
+         "GET /a/..//%74est.html?v=123 HTTP/1.1\r\nHost: localhost\r\n\r\n", false},
+        {"304 not modified",
+         "GET /test.html HTTP/1.1\r\nHost: localhost\r\nIf-None-Match: " + etag + "\r\n\r\n",
+         false},
+        {"404 not found", "GET /missing.html HTTP/1.1\r\nHost: localhost\r\n\r\n", false},
+        {"405 method not allowed", "DELETE /test.html HTTP/1.1\r\nHost: localhost\r\n\r\n",
+         false},
+        {"405 discarded body",
+         "POST /test.html HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n\r\nhello", false},
+        {"400 bad request", "GARBAGE\r\n\r\n", true},
+        {"413 payload too large",
+         "POST /upload HTTP/1.1\r\nHost: localhost\r\nContent-Length: 99999999\r\n\r\n", true},
+    };
+
+    int failed = 0;
+    for (const Case& c : cases) {
+        int fd = c.closes ? -1 : transport.open();
+        if (!c.closes) worker.attachConnection(fd);
+        for (int i = 0; i < 100; ++i) serveOnce(worker, transport, c, fd, false);
+
+        uint64_t allocs = 0;
+        alloc_audit::Site sites[16];
+        size_t site_count = 0;
+        double ns = runBench(c.name, iterations, [&] {
+            uint64_t n = serveOnce(worker, transport, c, fd, true);
+            if (n > 0 && site_count == 0) site_count = alloc_audit::sites(sites, 16);
+            allocs += n;
+        });
+        doNotOptimize(ns);
+        if (allocs == 0) continue;
+
+        ++failed;
+        std::printf("  FAIL: %llu allocations, first offending request:\n",
+                    static_cast<unsigned long long>(allocs));
+        for (size_t i = 0; i < site_count; ++i) {
+            std::printf("    %6llu x %8llu bytes  %s\n",
+                        static_cast<unsigned long long>(sites[i].count),
+                        static_cast<unsigned long long>(sites[i].bytes),
+                        alloc_audit::describe(sites[i].caller).c_str());
+        }
+    }
+
+    std::printf("%d of %zu paths allocate (%llu requests each, after warm-up)\n\n", failed,
+                sizeof(cases) / sizeof(cases[0]), static_cast<unsigned long long>(iterations));
+    if (io_pool) io_pool->shutdown();
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+    if (!alloc_audit::enabled()) {
+        std::fprintf(stderr, "bench_alloc needs -DHPHS_ALLOC_AUDIT=ON\n");
+        return 1;
+    }
+
+    ServerConfig config;
+    config.worker_count = 1;
+    config.www_root = HPHS_WWW_ROOT;
+    config.max_body_size = 1 << 20;
+    ResponseCache cache;
+    cache.preload(config.www_root);
+    Router router;
+    router.compile();
+
+    ServerConfig parsed = config;
+    parsed.io_threads = 0;
+    parsed.raw_request_cache = 0;
+    int failed = audit("full parse, in-loop file IO (io_threads=0, raw request cache off)", parsed,
+                       cache, router, iterations);
+    failed += audit("default config (IO pool, raw request cache)", config, cache, router,
+                    iterations);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+// 协程连接处理 vs 回调状态机：缓存命中吞吐对比（需 -DHPHS_COROUTINES=ON）
+//
+// 进程内启动 1 个 Worker 的 HttpServer，两种模式交替运行若干轮；
+// 客户端在同一进程中用 N 条连接、每条流水线 D 个 GET /test.html 请求，
+// 服务端几乎全部时间都在缓存命中热路径上，差值即为协程调度本身的开销。
+// 客户端与服务端可能共用 CPU，吞吐受调度影响较大，因此同时报告
+// /_hphs/stats 中 Worker 线程的 CPU 时间折算的每请求开销
+//
+//   bench_coroutine [seconds_per_round] [connections] [depth] [rounds]
+
+#include "http_server.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+static const int PORT = 18437;
+
+static int connectServer() {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int i = 0; i < 100; ++i) {
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            int flag = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+            return fd;
+        }
+        usleep(10000);
+    }
+    close(fd);
+    return -1;
+}
+
+static bool readExactly(int fd, char* buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = read(fd, buf + done, len - done);
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+// 单个请求探测响应长度（头部 + Content-Length），缓存响应长度固定
+static size_t probeResponseSize(int fd, const std::string& request) {
+    if (write(fd, request.data(), request.size()) != (ssize_t)request.size()) return 0;
+    std::string head;
+    char c;
+    while (head.size() < 4 || head.compare(head.size() - 4, 4, "\r\n\r\n") != 0) {
+        if (read(fd, &c, 1) != 1) return 0;
+        head.push_back(c);
+    }
+    size_t pos = head.find("Content-Length: ");
+    if (pos == std::string::npos) return 0;
+    size_t body = std::strtoull(head.c_str() + pos + 16, nullptr, 10);
+    std::vector<char> rest(body);
+    if (!readExactly(fd, rest.data(), body)) return 0;
+    return head.size() + body;
+}
+
+// 从 /_hphs/stats 读取 Worker 的 CPU 时间（毫秒）和已处理请求数
+static bool fetchStats(int fd, double& cpu_ms, double& requests) {
+    const std::string req = "GET /_hphs/stats HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    if (write(fd, req.data(), req.size()) != (ssize_t)req.size()) return false;
+    std::string resp;
+    char buf[4096];
+    size_t body_at = std::string::npos;
+    size_t length = 0;
+    while (body_at == std::string::npos || resp.size() < body_at + length) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) return false;
+        resp.append(buf, n);
+        if (body_at == std::string::npos && (body_at = resp.find("\r\n\r\n")) != std::string::npos) {
+            body_at += 4;
+            size_t pos = resp.find("Content-Length: ");
+            if (pos == std::string::npos) return false;
+            length = std::strtoull(resp.c_str() + pos + 16, nullptr, 10);
+        }
+    }
+    size_t cpu = resp.find("\"cpu_ms\":", body_at);
+    size_t total = resp.find("\"requests\":", body_at);
+    if (cpu == std::string::npos || total == std::string::npos) return false;
+    cpu_ms = std::atof(resp.c_str() + cpu + 9);
+    requests = std::atof(resp.c_str() + total + 11);
+    return true;
+}
+
+struct RoundResult {
+    double rps;
+    double cpu_ns;      // Worker 线程每请求 CPU 时间
+};
+
+static RoundResult runRound(bool coroutines, double seconds, int connections, int depth) {
+    ServerConfig config;
+    config.port = PORT;
+    config.worker_count = 1;
+    config.www_root = HPHS_WWW_ROOT;
+    config.coroutines = coroutines;
+
+    HttpServer server(config);
+    server.start();
+
+    const std::string one = "GET /test.html HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    std::string batch;
+    for (int i = 0; i < depth; ++i) batch += one;
+
+    std::vector<int> fds;
+    size_t response_size = 0;
+    for (int i = 0; i < connections; ++i) {
+        int fd = connectServer();
+        if (fd < 0) {
+            std::fprintf(stderr, "connect failed\n");
+            std::exit(1);
+        }
+        size_t size = probeResponseSize(fd, one);
+        if (size == 0 || (response_size != 0 && size != response_size)) {
+            std::fprintf(stderr, "unexpected response\n");
+            std::exit(1);
+        }
+        response_size = size;
+        fds.push_back(fd);
+    }
+
+    int stats_fd = connectServer();
+    double cpu_before = 0, req_before = 0, cpu_after = 0, req_after = 0;
+    if (stats_fd < 0 || !fetchStats(stats_fd, cpu_before, req_before)) {
+        std::fprintf(stderr, "stats failed\n");
+        std::exit(1);
+    }
+
+    std::vector<char> buf(response_size * depth);
+    uint64_t requests = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < deadline) {
+        for (int fd : fds) {
+            if (write(fd, batch.data(), batch.size()) != (ssize_t)batch.size()) {
+                std::fprintf(stderr, "write failed\n");
+                std::exit(1);
+            }
+        }
+        for (int fd : fds) {
+            if (!readExactly(fd, buf.data(), buf.size())) {
+                std::fprintf(stderr, "read failed\n");
+                std::exit(1);
+            }
+        }
+        requests += static_cast<uint64_t>(connections) * depth;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!fetchStats(stats_fd, cpu_after, req_after)) {
+        std::fprintf(stderr, "stats failed\n");
+        std::exit(1);
+    }
+
+    close(stats_fd);
+    for (int fd : fds) close(fd);
+    server.stop();
+    return {requests / elapsed, (cpu_after - cpu_before) * 1e6 / (req_after - req_before)};
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 2.0;
+    int connections = argc > 2 ? std::atoi(argv[2]) : 64;
+    int depth = argc > 3 ? std::atoi(argv[3]) : 16;
+    int rounds = argc > 4 ? std::atoi(argv[4]) : 3;
+
+    // 交替运行，抵消机器负载随时间的漂移
+    double rps[2] = {0, 0};
+    double cpu[2] = {0, 0};
+    for (int r = 0; r < rounds; ++r) {
+        for (int mode = 0; mode < 2; ++mode) {
+            RoundResult result = runRound(mode == 1, seconds, connections, depth);
+            std::printf("round %d %-14s %12.0f req/s %8.1f ns/req (worker CPU)\n", r + 1,
+                        mode ? "coroutine" : "state machine", result.rps, result.cpu_ns);
+            std::fflush(stdout);
+            rps[mode] += result.rps;
+            cpu[mode] += result.cpu_ns;
+        }
+    }
+
+    std::printf("\n%-14s %12s %12s\n", "", "req/s", "ns/req");
+    std::printf("%-14s %12.0f %12.1f\n", "state machine", rps[0] / rounds, cpu[0] / rounds);
+    std::printf("%-14s %12.0f %12.1f\n", "coroutine", rps[1] / rounds, cpu[1] / rounds);
+    std::printf("coroutine vs state machine: throughput %+.2f%%, worker CPU per request %+.2f%%\n",
+                (rps[1] / rps[0] - 1) * 100, (cpu[1] / cpu[0] - 1) * 100);
+    return 0;
+}
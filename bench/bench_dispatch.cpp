@@ -0,0 +1,121 @@
+// 路由分发开销 vs 缓存命中
+//
+// 三条路径都包含同样的请求解析，差值即为分发本身的开销：
+//   cache hit      : HttpRequest::parse + ResponseCache::find
+//   static route   : HttpRequest::parse + Router::match（预构建响应）
+//   handler route  : HttpRequest::parse + Router::match + handler 写入复用缓冲区
+//   rate limited   : cache hit 之前先查一次按客户端限流表（1000 个客户端轮流，速率足够高不会拒绝）
+
+#include "bench_util.h"
+#include "connection_table.h"
+#include "http_request.h"
+#include "rate_limiter.h"
+#include "response_cache.h"
+#include "router.h"
+
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    uint64_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+
+    ResponseCache cache;
+    cache.preload(HPHS_WWW_ROOT);
+
+    Router router;
+    router.addStatic(Router::GET_HEAD, "/_hphs/health", Router::EXACT, 200,
+                     "text/plain; charset=utf-8", "ok\n");
+    router.add(Router::GET_HEAD, "/api/echo", Router::EXACT,
+               [](const HttpRequest& req, ResponseWriter& out) {
+                   out.setContentType("application/json");
+                   out.write("{\"path\":\"");
+                   out.write(req.path());
+                   out.write("\",\"n\":");
+                   out.write(static_cast<uint64_t>(42));
+                   out.write("}");
+               });
+    router.add(Router::ANY_METHOD, "/api/", Router::PREFIX,
+               [](const HttpRequest&, ResponseWriter& out) { out.write("prefix"); });
+    router.compile();
+
+    ConnectionTable table;
+    Connection& conn = *table.acquire(-1);
+
+    std::string_view cache_req = "GET /test.html HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    std::string_view health_req = "GET /_hphs/health HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    std::string_view handler_req = "GET /api/echo HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+    double parse = runBench("parse only", iterations, [&] {
+        HttpRequest req;
+        doNotOptimize(req.parse(cache_req));
+    });
+
+    double hit = runBench("cache hit", iterations, [&] {
+        HttpRequest req;
+        req.parse(cache_req);
+        conn.setCachedResponse(cache.find(req.path()));
+        doNotOptimize(conn.cachedRemaining());
+    });
+
+    double route_static = runBench("static route (health)", iterations, [&] {
+        HttpRequest req;
+        req.parse(health_req);
+        Router::Match m = router.match(req.method(), req.path());
+        conn.setCachedResponse(m.route->response);
+        doNotOptimize(conn.cachedRemaining());
+    });
+
+    double route_handler = runBench("handler route", iterations, [&] {
+        HttpRequest req;
+        req.parse(handler_req);
+        Router::Match m = router.match(req.method(), req.path());
+        ResponseWriter writer(conn.writeBuffer());
+        m.route->handler(req, writer);
+        conn.setWriteOffset(writer.finish(true));
+        doNotOptimize(conn.writeRemaining());
+    });
+
+    double miss = runBench("router miss + cache hit", iterations, [&] {
+        HttpRequest req;
+        req.parse(cache_req);
+        doNotOptimize(router.match(req.method(), req.path()).route);
+        conn.setCachedResponse(cache.find(req.path()));
+        doNotOptimize(conn.cachedRemaining());
+    });
+
+    // 客户端地址取自 10.0.0.0/16，每个 /24 约 4 个地址，主机与网段都限流
+    RateLimiter limiter(RateLimiter::Limits{0, 1000000000}, RateLimiter::Limits{0, 1000000000},
+                        1000, 16384, 1);
+    std::vector<PeerKey> peers;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        sockaddr_storage addr{};
+        sockaddr_in& in = reinterpret_cast<sockaddr_in&>(addr);
+        in.sin_family = AF_INET;
+        in.sin_addr.s_addr = htonl(0x0A000000u | (i * 61 % 65536));
+        peers.push_back(PeerKey::fromAddress(addr));
+    }
+    size_t next_peer = 0;
+    uint32_t now = limiter.clock();
+    double limited = runBench("rate limit + cache hit", iterations, [&] {
+        HttpRequest req;
+        req.parse(cache_req);
+        if (++next_peer == peers.size()) {
+            next_peer = 0;
+            now += 1000;
+        }
+        doNotOptimize(limiter.allowRequest(peers[next_peer], now));
+        conn.setCachedResponse(cache.find(req.path()));
+        doNotOptimize(conn.cachedRemaining());
+    });
+
+    std::printf("\ndispatch overhead over parse:\n");
+    std::printf("  cache hit              %8.1f ns\n", hit - parse);
+    std::printf("  static route           %8.1f ns\n", route_static - parse);
+    std::printf("  handler route          %8.1f ns\n", route_handler - parse);
+    std::printf("  router miss + cache    %8.1f ns\n", miss - parse);
+    std::printf("  rate limit check       %8.1f ns (over cache hit, %llu rejected)\n",
+                limited - hit, static_cast<unsigned long long>(limiter.limitedRequests()));
+    return 0;
+}
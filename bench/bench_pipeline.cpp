@@ -0,0 +1,199 @@
+// 整条请求处理路径（handleRead → processRequest → handleWrite）的单核开销
+//
+// Worker 不启动事件循环线程，连接走 MemoryTransport：请求由内存喂入，响应写回内存，
+// 每轮 feed 后调用一次 Worker::poll。没有内核和对端参与，结果稳定，小幅的热路径退化也能看出来；
+// 同一二进制下可以直接用 perf record 剖析。重复的请求头默认由原始请求头缓存直接命中，
+// 另有一组关闭该缓存、每个请求都完整解析的对照。
+//
+// 给出请求流文件时按文件内容回放：每轮新建一个连接，按 segment 字节分段喂入整个文件，
+// 读完后关闭写方向，报告每轮耗时和响应字节数，并校验每轮的响应完全相同。
+//
+// 最后校验 Expect: 100-continue：要读请求体时先回 100 Continue，一开始就拒绝时只回最终响应并关闭。
+//
+//   bench_pipeline [iterations] [request_file [segment]]
+
+#include "bench_util.h"
+#include "memory_transport.h"
+#include "response_cache.h"
+#include "router.h"
+#include "worker.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// 每轮喂入 stream 后处理到不再有事件，返回本轮写出的字节数
+static size_t serve(Worker& worker, MemoryTransport& transport, int fd,
+                    const std::string& stream) {
+    uint64_t before = transport.bytesOut();
+    transport.feed(fd, stream);
+    while (worker.poll(0) > 0) {
+    }
+    return static_cast<size_t>(transport.bytesOut() - before);
+}
+
+// 请求头带 Expect: 100-continue 先单独到达。body 非空时应先收到 100 Continue，
+// 喂入请求体后收到 status；body 为空时应直接收到 status 且连接被关闭
+static bool expectContinue(Worker& worker, MemoryTransport& transport, const char* name,
+                           const std::string& head, const std::string& body,
+                           const std::string& status) {
+    int fd = transport.open();
+    worker.attachConnection(fd);
+    transport.feed(fd, head);
+    while (worker.poll(0) > 0) {
+    }
+    std::string out = transport.takeOutput(fd);
+    const std::string status_line = "HTTP/1.1 " + status;
+    bool ok;
+    if (body.empty()) {
+        ok = out.compare(0, status_line.size(), status_line) == 0 && transport.closed(fd);
+    } else {
+        ok = out == "HTTP/1.1 100 Continue\r\n\r\n";
+        transport.feed(fd, body);
+        while (worker.poll(0) > 0) {
+        }
+        out = transport.takeOutput(fd);
+        ok = ok && out.compare(0, status_line.size(), status_line) == 0;
+    }
+    std::printf("  %-36s %s\n", name, ok ? "ok" : "FAILED");
+    if (!transport.closed(fd)) transport.close(fd);
+    return ok;
+}
+
+static int replay(Worker& worker, const std::string& path, uint64_t iterations,
+                  size_t segment) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::fprintf(stderr, "cannot open %s\n", path.c_str());
+        return 1;
+    }
+    std::ostringstream oss;
+    oss << in.rdbuf();
+    std::string stream = oss.str();
+
+    MemoryTransport transport(true);
+    worker.setTransport(&transport);
+
+    std::string expected;
+    bool same = true;
+    double ns = runBench("replay", iterations, [&] {
+        int fd = transport.open(segment);
+        worker.attachConnection(fd);
+        transport.feed(fd, stream);
+        transport.shutdown(fd);
+        while (worker.poll(0) > 0) {
+        }
+        std::string out = transport.takeOutput(fd);
+        if (expected.empty()) expected = out;
+        else if (out != expected) same = false;
+        if (!transport.closed(fd)) transport.close(fd);
+    });
+    std::printf("\n%zu request bytes -> %zu response bytes per replay, %.1f us/replay, "
+                "responses %s\n",
+                stream.size(), expected.size(), ns / 1000,
+                same ? "identical across replays" : "DIFFER between replays");
+    return same ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    ServerConfig config;
+    config.worker_count = 1;
+    config.www_root = HPHS_WWW_ROOT;
+    ResponseCache cache;
+    cache.preload(config.www_root);
+
+    Router router;
+    router.addStatic(Router::GET_HEAD, "/_hphs/health", Router::EXACT, 200,
+                     "text/plain; charset=utf-8", "ok\n");
+    router.add(Router::GET_HEAD, "/api/echo", Router::EXACT,
+               [](const HttpRequest& req, ResponseWriter& out) {
+                   out.setContentType("application/json");
+                   out.write("{\"path\":\"");
+                   out.write(req.path());
+                   out.write("\"}");
+               });
+    router.add(Router::methodBit(HttpRequest::POST), "/api/body", Router::EXACT,
+               [](const HttpRequest& req, ResponseWriter& out) {
+                   out.write(static_cast<uint64_t>(req.body().size()));
+               });
+    router.compile();
+
+    Worker worker(0, config, cache, router);
+
+    if (argc > 2) {
+        size_t segment = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 0;
+        return replay(worker, argv[2], iterations / 100 > 0 ? iterations / 100 : 1, segment);
+    }
+
+    MemoryTransport transport(false);
+    worker.setTransport(&transport);
+    int fd = transport.open();
+    worker.attachConnection(fd);
+
+    const std::string cache_req = "GET /test.html HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    const std::string health_req = "GET /_hphs/health HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    const std::string handler_req = "GET /api/echo HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    std::string pipelined;
+    for (int i = 0; i < 16; ++i) pipelined += cache_req;
+
+    size_t bytes = 0;
+    double hit = runBench("keep-alive cache hit", iterations, [&] {
+        bytes = serve(worker, transport, fd, cache_req);
+    });
+    double health = runBench("keep-alive static route", iterations, [&] {
+        serve(worker, transport, fd, health_req);
+    });
+    double handler = runBench("keep-alive handler route", iterations, [&] {
+        serve(worker, transport, fd, handler_req);
+    });
+    uint64_t reads = transport.reads(), writes = transport.writes();
+    double pipe = runBench("pipelined x16 cache hit", iterations / 16, [&] {
+        serve(worker, transport, fd, pipelined);
+    });
+    uint64_t pipe_requests = (iterations / 16 + iterations / 160) * 16;
+    double pipe_reads = static_cast<double>(transport.reads() - reads) / pipe_requests;
+    double pipe_writes = static_cast<double>(transport.writes() - writes) / pipe_requests;
+
+    // 对照：关闭原始请求头缓存，每个请求都完整解析
+    ServerConfig parse_config = config;
+    parse_config.raw_request_cache = 0;
+    Worker parsing(1, parse_config, cache, router);
+    parsing.setTransport(&transport);
+    int parse_fd = transport.open();
+    parsing.attachConnection(parse_fd);
+    double parsed_hit = runBench("keep-alive cache hit (always parse)", iterations, [&] {
+        serve(parsing, transport, parse_fd, cache_req);
+    });
+
+    std::printf("\nper request (event dispatch + read + parse + respond + write):\n");
+    std::printf("  cache hit            %8.1f ns  (%zu response bytes)\n", hit, bytes);
+    std::printf("  static route         %8.1f ns\n", health);
+    std::printf("  handler route        %8.1f ns\n", handler);
+    std::printf("  pipelined cache hit  %8.1f ns  (%.2f reads, %.2f writes per request)\n",
+                pipe / 16, pipe_reads, pipe_writes);
+    std::printf("  cache hit, parsed    %8.1f ns  (raw request cache off)\n", parsed_hit);
+    std::printf("  requests served      %llu, %llu without parsing\n",
+                static_cast<unsigned long long>(worker.requestCount()),
+                static_cast<unsigned long long>(worker.rawHits()));
+
+    std::printf("\nExpect: 100-continue\n");
+    MemoryTransport check(true);
+    Worker expecting(2, config, cache, router);
+    expecting.setTransport(&check);
+    bool ok = expectContinue(expecting, check, "route body after 100 Continue",
+                             "POST /api/body HTTP/1.1\r\nHost: localhost\r\n"
+                             "Content-Length: 5\r\nExpect: 100-continue\r\n\r\n",
+                             "hello", "200");
+    ok &= expectContinue(expecting, check, "405 without 100, then close",
+                         "POST /test.html HTTP/1.1\r\nHost: localhost\r\n"
+                         "Content-Length: 5\r\nExpect: 100-continue\r\n\r\n",
+                         "", "405");
+    ok &= expectContinue(expecting, check, "413 without 100, then close",
+                         "POST /test.html HTTP/1.1\r\nHost: localhost\r\n"
+                         "Content-Length: 99999999999\r\nExpect: 100-continue\r\n\r\n",
+                         "", "413");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+
+// 防止编译器把被测代码优化掉
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// 运行 fn 共 iterations 次，打印每次耗时，返回 ns/op
+template <typename Fn>
+inline double runBench(const char* name, uint64_t iterations, Fn&& fn) {
+    // 预热
+    for (uint64_t i = 0; i < iterations / 10; ++i) fn();
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) fn();
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    std::printf("%-40s %10.1f ns/op  (%llu iterations)\n", name, ns,
+                static_cast<unsigned long long>(iterations));
+    return ns;
+}
+
+#endif
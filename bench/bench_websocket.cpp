@@ -0,0 +1,260 @@
+// WebSocket 广播扇出：每 1 万个订阅连接的广播开销
+//
+// 进程内启动 1 个 Worker 的 HttpServer 并注册 /bench 端点；订阅客户端放在 fork 出的子进程中
+// （两边各持有 N 个 fd，不超过常见的文件描述符上限），握手完成后用 epoll 读取。
+// 每轮由服务端广播一条消息，子进程确认 N 个订阅者全部收到后经管道回报。
+// 报告每次广播送达全部订阅者的耗时、Worker 线程的 CPU 时间（来自 /_hphs/stats），
+// 以及按每 1 万订阅者折算的值。客户端与服务端可能共用 CPU，送达耗时包含客户端读取的时间，
+// Worker CPU 时间才是服务端扇出本身的代价。
+//
+//   bench_websocket [subscribers] [rounds] [payload_bytes...]
+
+#include "http_server.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+static const int PORT = 18439;
+
+static int connectServer() {
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int i = 0; i < 200; ++i) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            int flag = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+            return fd;
+        }
+        close(fd);
+        usleep(10000);
+    }
+    return -1;
+}
+
+static bool writeAll(int fd, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool readExactly(int fd, void* data, size_t len) {
+    char* p = static_cast<char*>(data);
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// 阻塞握手，握手后不会有数据先于广播到达
+static bool handshake(int fd) {
+    static const std::string request =
+        "GET /bench HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\n"
+        "Connection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n\r\n";
+    if (!writeAll(fd, request.data(), request.size())) return false;
+    std::string head;
+    char c;
+    while (head.size() < 4 || head.compare(head.size() - 4, 4, "\r\n\r\n") != 0) {
+        if (read(fd, &c, 1) != 1) return false;
+        head.push_back(c);
+    }
+    return head.compare(0, 12, "HTTP/1.1 101") == 0;
+}
+
+// 子进程：建立 n 个订阅连接，之后每收到一个帧长度就读到全部连接都收齐一帧，回报 'D'
+static int runSubscribers(int n, int ready_fd, int cmd_fd) {
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<int> fds;
+    fds.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        int fd = connectServer();
+        if (fd < 0 || !handshake(fd)) {
+            std::fprintf(stderr, "subscriber %d: handshake failed\n", i);
+            return 1;
+        }
+        int flags = fcntl(fd, F_GETFL);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        struct epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = fd;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+        fds.push_back(fd);
+    }
+    char ok = 'R';
+    writeAll(ready_fd, &ok, 1);
+
+    std::vector<struct epoll_event> events(1024);
+    std::vector<char> buf(1 << 16);
+    uint32_t frame_size;
+    while (readExactly(cmd_fd, &frame_size, sizeof(frame_size)) && frame_size > 0) {
+        uint64_t expected = static_cast<uint64_t>(frame_size) * n;
+        uint64_t received = 0;
+        while (received < expected) {
+            int m = epoll_wait(epfd, events.data(), events.size(), 5000);
+            if (m <= 0) {
+                std::fprintf(stderr, "subscribers: timed out (%llu / %llu bytes)\n",
+                             static_cast<unsigned long long>(received),
+                             static_cast<unsigned long long>(expected));
+                return 1;
+            }
+            for (int i = 0; i < m; ++i) {
+                ssize_t r;
+                while ((r = read(events[i].data.fd, buf.data(), buf.size())) > 0) received += r;
+            }
+        }
+        char done = 'D';
+        writeAll(ready_fd, &done, 1);
+    }
+    for (int fd : fds) close(fd);
+    return 0;
+}
+
+// 从 /_hphs/stats 读取 key 的第一个数值（唯一的 Worker 的 cpu_ms，或 websocket 汇总中的计数）
+static bool fetchStats(int fd, std::string& body) {
+    const std::string req = "GET /_hphs/stats HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    if (!writeAll(fd, req.data(), req.size())) return false;
+    std::string resp;
+    char buf[4096];
+    size_t body_at = std::string::npos;
+    size_t length = 0;
+    while (body_at == std::string::npos || resp.size() < body_at + length) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) return false;
+        resp.append(buf, n);
+        if (body_at == std::string::npos && (body_at = resp.find("\r\n\r\n")) != std::string::npos) {
+            body_at += 4;
+            size_t pos = resp.find("Content-Length: ");
+            if (pos == std::string::npos) return false;
+            length = std::strtoull(resp.c_str() + pos + 16, nullptr, 10);
+        }
+    }
+    body = resp.substr(body_at);
+    return true;
+}
+
+static double statValue(const std::string& body, const char* key, const char* after = nullptr) {
+    size_t from = after ? body.find(after) : 0;
+    if (from == std::string::npos) return 0;
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t pos = body.find(pattern, from);
+    return pos == std::string::npos ? 0 : std::atof(body.c_str() + pos + pattern.size());
+}
+
+int main(int argc, char* argv[]) {
+    int subscribers = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 50;
+    std::vector<size_t> payloads;
+    for (int i = 3; i < argc; ++i) payloads.push_back(std::strtoull(argv[i], nullptr, 10));
+    if (payloads.empty()) payloads = {64, 1024, 16384};
+
+    // 每个进程需要 subscribers 个连接外加少量其他 fd
+    struct rlimit rl;
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    if (rl.rlim_cur < static_cast<rlim_t>(subscribers) + 64) {
+        subscribers = static_cast<int>(rl.rlim_cur) - 64;
+        std::fprintf(stderr, "RLIMIT_NOFILE %llu: subscribers reduced to %d\n",
+                     static_cast<unsigned long long>(rl.rlim_cur), subscribers);
+    }
+
+    // 先 fork 再启动服务器线程，子进程只做客户端
+    int up[2], down[2];
+    if (pipe2(up, O_CLOEXEC) < 0 || pipe2(down, O_CLOEXEC) < 0) return 1;
+    pid_t child = fork();
+    if (child == 0) {
+        close(up[0]);
+        close(down[1]);
+        _exit(runSubscribers(subscribers, up[1], down[0]));
+    }
+    close(up[1]);
+    close(down[0]);
+
+    ServerConfig config;
+    config.port = PORT;
+    config.worker_count = 1;
+    config.www_root = HPHS_WWW_ROOT;
+    config.max_events = 4096;
+    HttpServer server(config);
+    server.addWebSocket("/bench");
+    server.start();
+
+    char reply = 0;
+    auto connect_start = std::chrono::steady_clock::now();
+    if (!readExactly(up[0], &reply, 1) || reply != 'R') {
+        std::fprintf(stderr, "subscribers failed to connect\n");
+        return 1;
+    }
+    std::printf("%d subscribers connected in %.0f ms\n", subscribers,
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                          connect_start).count());
+
+    int stats_fd = connectServer();
+    std::string stats;
+    std::printf("\n%-10s %14s %14s %18s %18s %10s\n", "payload", "delivery us",
+                "worker CPU us", "delivery us/10K", "worker CPU us/10K", "queued");
+    double scale = 10000.0 / subscribers;
+    for (size_t payload_size : payloads) {
+        std::string payload(payload_size, 'x');
+        uint32_t frame_size = static_cast<uint32_t>(
+            websocket::encodeFrame(websocket::TEXT, payload).size());
+
+        if (!fetchStats(stats_fd, stats)) return 1;
+        double cpu_before = statValue(stats, "cpu_ms");
+        double queued_before = statValue(stats, "queued", "\"websocket\"");
+
+        double wall_us = 0;
+        for (int r = 0; r < rounds; ++r) {
+            writeAll(down[1], &frame_size, sizeof(frame_size));
+            auto start = std::chrono::steady_clock::now();
+            server.broadcastWebSocket("/bench", payload);
+            if (!readExactly(up[0], &reply, 1) || reply != 'D') {
+                std::fprintf(stderr, "delivery failed\n");
+                return 1;
+            }
+            wall_us += std::chrono::duration<double, std::micro>(
+                           std::chrono::steady_clock::now() - start).count();
+        }
+
+        if (!fetchStats(stats_fd, stats)) return 1;
+        double cpu_us = (statValue(stats, "cpu_ms") - cpu_before) * 1000 / rounds;
+        double queued = statValue(stats, "queued", "\"websocket\"") - queued_before;
+        wall_us /= rounds;
+        std::printf("%-10zu %14.0f %14.0f %18.0f %18.0f %10.0f\n", payload_size, wall_us,
+                    cpu_us, wall_us * scale, cpu_us * scale, queued);
+        std::fflush(stdout);
+    }
+
+    uint32_t stop = 0;
+    writeAll(down[1], &stop, sizeof(stop));
+    int status = 0;
+    waitpid(child, &status, 0);
+    close(stats_fd);
+    server.stop();
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
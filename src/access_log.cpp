@@ -0,0 +1,176 @@
+#include "access_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t OUT_BUFFER_SIZE = 256 * 1024;   // 单次 write 的批量大小
+constexpr size_t MAX_LINE = 160;                 // 一条记录格式化后的上限
+constexpr size_t POP_BATCH = 256;
+
+const char* methodName(uint8_t m) {
+    // 与 HttpRequest::Method 顺序一致
+    static const char* names[] = {"INVALID", "GET", "POST", "HEAD", "PUT", "DELETE"};
+    return m < sizeof(names) / sizeof(names[0]) ? names[m] : "INVALID";
+}
+
+size_t roundUpPow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+}  // namespace
+
+AccessLogRing::AccessLogRing(size_t capacity)
+    : capacity_(roundUpPow2(std::max<size_t>(capacity, 2))), mask_(capacity_ - 1) {
+    records_.reset(new AccessLogRecord[capacity_]);
+}
+
+size_t AccessLogRing::pop(AccessLogRecord* out, size_t max) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t n = std::min(head - tail, max);
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = records_[(tail + i) & mask_];
+    }
+    tail_.store(tail + n, std::memory_order_release);
+    return n;
+}
+
+AccessLogger::AccessLogger(const std::string& path, size_t workers,
+                           size_t ring_capacity, uint32_t sample)
+    : path_(path), sample_(sample), out_(OUT_BUFFER_SIZE) {
+    for (size_t i = 0; i < workers; ++i) {
+        rings_.push_back(std::make_unique<AccessLogRing>(ring_capacity));
+    }
+}
+
+AccessLogger::~AccessLogger() {
+    stop();
+}
+
+bool AccessLogger::start() {
+    if (path_ == "-") {
+        fd_ = STDOUT_FILENO;
+    } else {
+        fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) return false;
+    }
+    running_ = true;
+    thread_ = std::thread(&AccessLogger::run, this);
+    return true;
+}
+
+void AccessLogger::stop() {
+    running_ = false;
+    if (thread_.joinable()) thread_.join();
+    if (fd_ > STDERR_FILENO) close(fd_);
+    fd_ = -1;
+}
+
+uint64_t AccessLogger::dropped() const {
+    uint64_t total = 0;
+    for (const auto& ring : rings_) total += ring->dropped();
+    return total;
+}
+
+void AccessLogger::run() {
+    AccessLogRecord batch[POP_BATCH];
+
+    while (true) {
+        // 先读 running_ 再取数据，保证停止前写入的记录都被刷出
+        bool running = running_.load();
+        size_t drained = 0;
+        for (auto& ring : rings_) {
+            size_t n;
+            while ((n = ring->pop(batch, POP_BATCH)) > 0) {
+                for (size_t i = 0; i < n; ++i) {
+                    if (out_len_ + MAX_LINE > out_.size()) flush();
+                    out_len_ += format(batch[i], out_.data() + out_len_);
+                }
+                drained += n;
+                written_.fetch_add(n, std::memory_order_relaxed);
+            }
+        }
+        flush();
+
+        if (!running) break;
+        if (drained == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+}
+
+void AccessLogger::flush() {
+    size_t done = 0;
+    while (done < out_len_) {
+        ssize_t n = write(fd_, out_.data() + done, out_len_ - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;  // 写失败只能丢弃，不影响服务
+        done += n;
+    }
+    out_len_ = 0;
+}
+
+// 2026-01-17T02:21:28.123456Z w0 GET /index.html 200 1234 56us
+size_t AccessLogger::format(const AccessLogRecord& r, char* out) {
+    char* p = out;
+
+    int64_t second = r.timestamp_ns / 1000000000;
+    if (second != cached_second_) {
+        time_t t = static_cast<time_t>(second);
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        strftime(cached_time_, sizeof(cached_time_), "%Y-%m-%dT%H:%M:%S", &tm);
+        cached_second_ = second;
+    }
+    size_t time_len = strlen(cached_time_);
+    memcpy(p, cached_time_, time_len);
+    p += time_len;
+
+    uint32_t micros = (r.timestamp_ns / 1000) % 1000000;
+    *p++ = '.';
+    for (int div = 100000; div > 0; div /= 10) {
+        *p++ = static_cast<char>('0' + (micros / div) % 10);
+    }
+    *p++ = 'Z';
+
+    memcpy(p, " w", 2);
+    p += 2;
+    p = std::to_chars(p, p + 4, r.worker).ptr;
+    *p++ = ' ';
+
+    const char* method = methodName(r.method);
+    size_t method_len = strlen(method);
+    memcpy(p, method, method_len);
+    p += method_len;
+    *p++ = ' ';
+
+    memcpy(p, r.path, r.path_len);
+    p += r.path_len;
+    if (r.path_truncated) {
+        // 截断的路径附带完整路径的 hash
+        memcpy(p, "...#", 4);
+        p += 4;
+        p = std::to_chars(p, p + 8, r.path_hash, 16).ptr;
+    }
+    *p++ = ' ';
+
+    p = std::to_chars(p, p + 5, r.status).ptr;
+    *p++ = ' ';
+    p = std::to_chars(p, p + 20, r.bytes).ptr;
+    *p++ = ' ';
+    p = std::to_chars(p, p + 10, r.latency_us).ptr;
+    memcpy(p, "us\n", 3);
+    p += 3;
+
+    return p - out;
+}
@@ -0,0 +1,123 @@
+#ifndef ACCESS_LOG_H
+#define ACCESS_LOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 定长二进制访问日志记录，一条正好一个 cache line
+// Worker 只做一次 64 字节拷贝，格式化全部放到刷盘线程
+struct AccessLogRecord {
+    uint64_t timestamp_ns = 0;   // 请求开始时间（CLOCK_REALTIME）
+    uint64_t bytes = 0;          // 响应字节数
+    uint32_t latency_us = 0;     // 解析完成到响应写完
+    uint32_t path_hash = 0;      // 完整路径的 FNV-1a，截断时用于区分
+    uint16_t status = 0;
+    uint8_t method = 0;          // HttpRequest::Method
+    uint8_t worker = 0;
+    uint8_t path_len = 0;        // path 中的有效字节数
+    uint8_t path_truncated = 0;
+    char path[34];
+};
+
+static_assert(sizeof(AccessLogRecord) == 64, "AccessLogRecord must be one cache line");
+
+// 单生产者单消费者无锁环形缓冲区
+// 生产者为所属 Worker，消费者为刷盘线程；满了直接丢弃并计数，绝不阻塞事件循环
+class AccessLogRing {
+public:
+    explicit AccessLogRing(size_t capacity);
+
+    bool push(const AccessLogRecord& record) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ >= capacity_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ >= capacity_) {
+                dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+                               std::memory_order_relaxed);
+                return false;
+            }
+        }
+        records_[head & mask_] = record;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者批量取出，返回取出条数
+    size_t pop(AccessLogRecord* out, size_t max);
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    std::unique_ptr<AccessLogRecord[]> records_;
+    size_t capacity_;
+    size_t mask_;
+
+    alignas(64) std::atomic<size_t> head_{0};     // 生产者写
+    size_t cached_tail_ = 0;                      // 生产者缓存的 tail，减少跨核读取
+    std::atomic<uint64_t> dropped_{0};            // 只有生产者写
+    alignas(64) std::atomic<size_t> tail_{0};     // 消费者写
+};
+
+// 异步访问日志：每个 Worker 一个环形缓冲区，后台线程格式化后大块写入
+class AccessLogger {
+public:
+    /**
+     * @param path 日志文件，"-" 表示标准输出
+     * @param workers Worker 数量（每个 Worker 一个环）
+     * @param ring_capacity 每个环的记录数，向上取整为 2 的幂
+     * @param sample 采样率：每 sample 个请求记录一个
+     */
+    AccessLogger(const std::string& path, size_t workers, size_t ring_capacity,
+                 uint32_t sample);
+    ~AccessLogger();
+
+    AccessLogger(const AccessLogger&) = delete;
+    AccessLogger& operator=(const AccessLogger&) = delete;
+
+    bool start();
+    void stop();
+
+    AccessLogRing& ring(size_t worker) { return *rings_[worker]; }
+
+    // Worker 侧采样判断，counter 为 Worker 自己的计数器
+    bool sampled(uint64_t& counter) const {
+        return sample_ <= 1 || ++counter % sample_ == 0;
+    }
+
+    uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const;
+
+    static uint32_t hashPath(const char* data, size_t len) {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < len; ++i) {
+            h ^= static_cast<unsigned char>(data[i]);
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+private:
+    void run();
+    size_t format(const AccessLogRecord& r, char* out);
+    void flush();
+
+    std::string path_;
+    uint32_t sample_;
+    int fd_ = -1;
+    std::vector<std::unique_ptr<AccessLogRing>> rings_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> written_{0};
+
+    // 刷盘线程私有：输出缓冲区和秒级时间前缀缓存
+    std::vector<char> out_;
+    size_t out_len_ = 0;
+    int64_t cached_second_ = -1;
+    char cached_time_[32];
+};
+
+#endif
@@ -0,0 +1,211 @@
+#include "alloc_audit.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#if HPHS_ALLOC_AUDIT
+#include <cerrno>
+#include <dlfcn.h>
+#include <new>
+
+// glibc 的真实实现；替换后的 malloc 系列转调这些函数，不经过 dlsym（dlsym 本身会分配）
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+namespace {
+
+// 每线程的调用点表：开放寻址，槽位用满后记入溢出项
+constexpr size_t SITE_SLOTS = 512;
+
+struct ThreadTally {
+    alloc_audit::Stats total;
+    alloc_audit::Site sites[SITE_SLOTS];
+    alloc_audit::Site overflow;
+};
+
+// 可执行文件中的 TLS 为静态模型，首次访问不会经过 __tls_get_addr 分配
+thread_local ThreadTally tally __attribute__((tls_model("initial-exec")));
+
+inline void record(const void* caller, size_t size) {
+    ThreadTally& t = tally;
+    ++t.total.count;
+    t.total.bytes += size;
+    size_t i = (reinterpret_cast<uintptr_t>(caller) >> 2) & (SITE_SLOTS - 1);
+    for (size_t probe = 0; probe < SITE_SLOTS; ++probe) {
+        alloc_audit::Site& s = t.sites[(i + probe) & (SITE_SLOTS - 1)];
+        if (s.caller == caller || s.caller == nullptr) {
+            s.caller = caller;
+            ++s.count;
+            s.bytes += size;
+            return;
+        }
+    }
+    ++t.overflow.count;
+    t.overflow.bytes += size;
+}
+
+void* newImpl(size_t size, const void* caller) {
+    record(caller, size);
+    if (size == 0) size = 1;
+    void* p = __libc_malloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* newAligned(size_t size, std::align_val_t align, const void* caller) {
+    record(caller, size);
+    if (size == 0) size = 1;
+    void* p = __libc_memalign(static_cast<size_t>(align), size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+}  // namespace
+
+#define HPHS_CALLER __builtin_return_address(0)
+
+void* operator new(size_t size) { return newImpl(size, HPHS_CALLER); }
+void* operator new[](size_t size) { return newImpl(size, HPHS_CALLER); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    record(HPHS_CALLER, size);
+    return __libc_malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    record(HPHS_CALLER, size);
+    return __libc_malloc(size ? size : 1);
+}
+void* operator new(size_t size, std::align_val_t align) {
+    return newAligned(size, align, HPHS_CALLER);
+}
+void* operator new[](size_t size, std::align_val_t align) {
+    return newAligned(size, align, HPHS_CALLER);
+}
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    record(HPHS_CALLER, size);
+    return __libc_memalign(static_cast<size_t>(align), size ? size : 1);
+}
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    record(HPHS_CALLER, size);
+    return __libc_memalign(static_cast<size_t>(align), size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { __libc_free(p); }
+void operator delete[](void* p) noexcept { __libc_free(p); }
+void operator delete(void* p, size_t) noexcept { __libc_free(p); }
+void operator delete[](void* p, size_t) noexcept { __libc_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { __libc_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { __libc_free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { __libc_free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { __libc_free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { __libc_free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { __libc_free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { __libc_free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    __libc_free(p);
+}
+
+// C 分配函数：libstdc++ 内部和第三方代码直接调用的 malloc 也计入
+extern "C" {
+
+void* malloc(size_t size) {
+    record(HPHS_CALLER, size);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    record(HPHS_CALLER, n * size);
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    record(HPHS_CALLER, size);
+    return __libc_realloc(ptr, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    record(HPHS_CALLER, size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    record(HPHS_CALLER, size);
+    void* p = __libc_memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+void free(void* ptr) { __libc_free(ptr); }
+
+}  // extern "C"
+
+namespace alloc_audit {
+
+bool enabled() { return true; }
+
+Stats threadStats() { return tally.total; }
+
+void reset() {
+    ThreadTally& t = tally;
+    t.total = Stats();
+    std::fill(t.sites, t.sites + SITE_SLOTS, Site());
+    t.overflow = Site();
+}
+
+size_t sites(Site* out, size_t max) {
+    const ThreadTally& t = tally;
+    size_t n = 0;
+    for (const Site& s : t.sites) {
+        if (s.count > 0 && n < max) out[n++] = s;
+    }
+    if (t.overflow.count > 0 && n < max) out[n++] = t.overflow;
+    std::sort(out, out + n, [](const Site& a, const Site& b) { return a.count > b.count; });
+    return n;
+}
+
+std::string describe(const void* caller) {
+    if (!caller) return "(site table full)";
+    Dl_info info;
+    char buf[512];
+    if (!dladdr(caller, &info)) {
+        snprintf(buf, sizeof(buf), "%p", caller);
+    } else if (info.dli_sname) {
+        snprintf(buf, sizeof(buf), "%s+0x%zx", info.dli_sname,
+                 static_cast<size_t>(static_cast<const char*>(caller) -
+                                     static_cast<const char*>(info.dli_saddr)));
+    } else if (info.dli_fname) {
+        snprintf(buf, sizeof(buf), "%s+0x%zx", info.dli_fname,
+                 static_cast<size_t>(static_cast<const char*>(caller) -
+                                     static_cast<const char*>(info.dli_fbase)));
+    } else {
+        snprintf(buf, sizeof(buf), "%p", caller);
+    }
+    return buf;
+}
+
+}  // namespace alloc_audit
+
+#else
+
+namespace alloc_audit {
+
+bool enabled() { return false; }
+Stats threadStats() { return Stats(); }
+void reset() {}
+size_t sites(Site*, size_t) { return 0; }
+std::string describe(const void* caller) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%p", caller);
+    return buf;
+}
+
+}  // namespace alloc_audit
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef ALLOC_AUDIT_H
+#define ALLOC_AUDIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 分配审计（-DHPHS_ALLOC_AUDIT=ON）：替换全局 operator new 和 malloc 系列，
+// 按线程统计分配次数和字节数，并按调用点（分配函数的返回地址）累计。
+// 计数都在线程局部存储里，不加锁；只看调用线程自己的分配。
+// 未启用时 enabled() 为 false，其余接口为空实现。
+//
+// 用法：预热后 reset()，跑一段只应命中零分配路径的代码，再看 threadStats() / sites()
+namespace alloc_audit {
+
+struct Stats {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+struct Site {
+    const void* caller = nullptr;   // 调用 operator new / malloc 的返回地址，表满后的溢出项为 nullptr
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+bool enabled();
+// 当前线程自上次 reset 以来的分配
+Stats threadStats();
+// 清零当前线程的计数和调用点表
+void reset();
+// 当前线程的调用点，按次数降序写入 out，返回写入的个数
+size_t sites(Site* out, size_t max);
+// 调用点的符号名和偏移（dladdr，需要 -rdynamic），找不到时为模块名加偏移
+std::string describe(const void* caller);
+
+}  // namespace alloc_audit
+
+#endif
@@ -0,0 +1,179 @@
+#include "cache_snapshot.h"
+#include "response_cache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr char CacheSnapshot::MAGIC[8];
+
+CacheSnapshot::~CacheSnapshot() {
+    if (base_) munmap(const_cast<char*>(base_), size_);
+}
+
+uint64_t CacheSnapshot::hashKey(std::string_view key) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+namespace {
+
+bool writeAll(int fd, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool CacheSnapshot::write(const std::string& path, const std::vector<PreparedFile>& files) {
+    // 条目：文件本身加上目录别名，别名复用同一段响应
+    struct Pending {
+        const std::string* key;
+        size_t file;
+    };
+    std::vector<Pending> keys;
+    for (size_t i = 0; i < files.size(); ++i) {
+        keys.push_back({&files[i].url_path, i});
+        if (!files[i].alias.empty()) keys.push_back({&files[i].alias, i});
+    }
+
+    uint64_t bucket_count = 16;
+    while (bucket_count < keys.size() * 2) bucket_count <<= 1;
+
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.entry_count = static_cast<uint32_t>(keys.size());
+    header.bucket_count = bucket_count;
+    header.buckets_offset = sizeof(Header);
+    header.entries_offset = header.buckets_offset + bucket_count * sizeof(uint32_t);
+
+    // 数据区：先放所有响应（按 64 字节对齐），再放 key 和 Content-Type
+    std::string data;
+    uint64_t data_offset = header.entries_offset + keys.size() * sizeof(Entry);
+    std::vector<uint64_t> response_offset(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        data.resize((data.size() + 63) & ~size_t(63));
+        response_offset[i] = data_offset + data.size();
+        data += files[i].response;
+    }
+
+    std::vector<Entry> entries(keys.size());
+    std::vector<uint32_t> buckets(bucket_count, 0);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const PreparedFile& f = files[keys[i].file];
+        Entry& e = entries[i];
+        e.hash = hashKey(*keys[i].key);
+        e.response_offset = response_offset[keys[i].file];
+        e.response_size = f.response.size();
+        e.body_size = f.body_size;
+        e.key_offset = data_offset + data.size();
+        e.key_size = static_cast<uint32_t>(keys[i].key->size());
+        data += *keys[i].key;
+        e.content_type_offset = data_offset + data.size();
+        e.content_type_size = static_cast<uint32_t>(f.content_type.size());
+        data += f.content_type;
+
+        uint64_t b = e.hash & (bucket_count - 1);
+        while (buckets[b] != 0) b = (b + 1) & (bucket_count - 1);
+        buckets[b] = static_cast<uint32_t>(i + 1);
+    }
+    header.file_size = data_offset + data.size();
+
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Cannot create " << tmp << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    bool ok = writeAll(fd, &header, sizeof(header)) &&
+              writeAll(fd, buckets.data(), buckets.size() * sizeof(uint32_t)) &&
+              writeAll(fd, entries.data(), entries.size() * sizeof(Entry)) &&
+              writeAll(fd, data.data(), data.size()) && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write " << path << ": " << strerror(errno) << std::endl;
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool CacheSnapshot::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Cannot open snapshot " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        std::cerr << "Invalid snapshot " << path << std::endl;
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    // MAP_SHARED 只读：页面直接来自页缓存，多个进程共享同一份物理内存
+    void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        std::cerr << "mmap snapshot " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    const Header* h = static_cast<const Header*>(p);
+    bool valid = memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0 && h->version == VERSION &&
+                 h->file_size == size && h->bucket_count != 0 &&
+                 (h->bucket_count & (h->bucket_count - 1)) == 0 &&
+                 h->bucket_count >= h->entry_count &&
+                 h->buckets_offset + h->bucket_count * sizeof(uint32_t) <= h->entries_offset &&
+                 h->entries_offset + uint64_t(h->entry_count) * sizeof(Entry) <= size &&
+                 h->entries_offset % alignof(Entry) == 0;
+    if (!valid) {
+        std::cerr << "Invalid snapshot " << path << " (bad header or version)" << std::endl;
+        munmap(p, size);
+        return false;
+    }
+
+    base_ = static_cast<const char*>(p);
+    size_ = size;
+    buckets_ = reinterpret_cast<const uint32_t*>(base_ + h->buckets_offset);
+    entry_table_ = reinterpret_cast<const Entry*>(base_ + h->entries_offset);
+    entry_count_ = h->entry_count;
+    bucket_mask_ = h->bucket_count - 1;
+    return true;
+}
+
+// 条目中的偏移在使用时校验，损坏的快照只会导致未命中
+std::string_view CacheSnapshot::find(std::string_view key) const {
+    uint64_t hash = hashKey(key);
+    for (uint64_t b = hash & bucket_mask_, probes = 0; probes <= bucket_mask_;
+         b = (b + 1) & bucket_mask_, ++probes) {
+        uint32_t index = buckets_[b];
+        if (index == 0 || index > entry_count_) return std::string_view();
+        const Entry& e = entry_table_[index - 1];
+        if (e.hash != hash || e.key_size != key.size() ||
+            e.key_offset > size_ || size_ - e.key_offset < e.key_size ||
+            memcmp(base_ + e.key_offset, key.data(), key.size()) != 0)
+            continue;
+        if (e.response_offset > size_ || size_ - e.response_offset < e.response_size)
+            return std::string_view();
+        return std::string_view(base_ + e.response_offset, e.response_size);
+    }
+    return std::string_view();
+}
@@ -0,0 +1,74 @@
+#ifndef CACHE_SNAPSHOT_H
+#define CACHE_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct PreparedFile;
+
+// hphs-pack 生成的响应缓存快照：索引、预构建响应头和文件内容放在同一个文件中，
+// 服务器只读 mmap 后原地查找，启动时不读取 www_root，同一主机上的多个进程共享页缓存
+//
+// 文件布局（小端，所有偏移相对文件开头）：
+//   Header | 桶数组 uint32[bucket_count] | Entry[entry_count] | 数据区（key、Content-Type、响应）
+// 桶中存条目下标 + 1（0 为空），线性探测；哈希为 FNV-1a，与进程无关
+class CacheSnapshot {
+public:
+    static constexpr char MAGIC[8] = {'H', 'P', 'H', 'S', 'S', 'N', 'A', 'P'};
+    static constexpr uint32_t VERSION = 1;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t entry_count;
+        uint64_t bucket_count;      // 2 的幂
+        uint64_t buckets_offset;
+        uint64_t entries_offset;
+        uint64_t file_size;
+    };
+
+    struct Entry {
+        uint64_t hash;
+        uint64_t key_offset;
+        uint64_t response_offset;   // 目录别名与 index.html 指向同一段
+        uint64_t response_size;
+        uint64_t body_size;
+        uint64_t content_type_offset;
+        uint32_t key_size;
+        uint32_t content_type_size;
+    };
+
+    CacheSnapshot() = default;
+    ~CacheSnapshot();
+
+    CacheSnapshot(const CacheSnapshot&) = delete;
+    CacheSnapshot& operator=(const CacheSnapshot&) = delete;
+
+    static uint64_t hashKey(std::string_view key);
+
+    // 把 scan 的结果写入 path（先写临时文件再 rename，已映射旧快照的进程不受影响）
+    static bool write(const std::string& path, const std::vector<PreparedFile>& files);
+
+    // 只读映射并校验头部，失败时输出原因并返回 false
+    bool open(const std::string& path);
+
+    // 返回快照中的完整响应，data() 为 nullptr 表示未命中
+    std::string_view find(std::string_view key) const;
+
+    bool loaded() const { return base_ != nullptr; }
+    size_t entries() const { return entry_count_; }
+    size_t mappedSize() const { return size_; }
+
+private:
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+    const uint32_t* buckets_ = nullptr;
+    const Entry* entry_table_ = nullptr;
+    size_t entry_count_ = 0;
+    uint64_t bucket_mask_ = 0;
+};
+
+#endif
@@ -3,14 +3,66 @@
 
 #include <string>
 #include <chrono>
+#include <cstdint>
 #include <unistd.h>
 #include <memory>
+#include "request_body.h"
+#include "access_log.h"
+#include "websocket.h"
+#include "rate_limiter.h"
 
-enum class ConnectionState {READING, WRITING, CLOSING};
+enum class ConnectionState : uint8_t {READING, READING_BODY, WAITING_IO, WRITING, WEBSOCKET, CLOSING};
 
-class Connection {
+// 分阶段延迟统计的计时点（CLOCK_MONOTONIC 纳秒）
+struct RequestTiming {
+    uint64_t accept_ns = 0;     // 连接建立
+    uint64_t start_ns = 0;      // 读到当前请求首字节的 epoll 唤醒时间，0 表示没有进行中的请求
+    bool first_byte = false;    // 当前请求的响应是否已写出首字节
+    uint32_t requests = 0;      // 连接上已解析的请求数
+    uint32_t load_mark = 0;     // 上一个负载统计周期结束时的 requests，差值即本周期的请求数
+};
+
+// 连接的冷数据：缓冲区、sendfile 路径、请求体、日志与计时
+// 只在真正处理请求内容时访问，放在 ConnectionTable 的旁路数组中
+struct ConnectionCold {
+    std::string read_buffer;
+    std::string write_buffer;
+    std::string sendfile_path;
+    off_t sendfile_size = 0;
+    off_t sendfile_offset = 0;
+    BodyState body;
+    uint64_t log_start_ns = 0;
+    AccessLogRecord log_record;
+    RequestTiming timing;
+    PeerKey peer;                   // 客户端地址的限流 key，只在开启限流时填写
+
+    // MSG_ZEROCOPY：0 未启用，1 已设置 SO_ZEROCOPY，-1 套接字不支持
+    int8_t zerocopy = 0;
+    uint32_t zerocopy_pending = 0;  // 已发出、尚未收到完成通知的零拷贝发送数
+
+    // 协程模式（HPHS_COROUTINES）：挂起中的协程帧地址和等待的事件，由 Worker 恢复
+    void* coro = nullptr;
+    uint8_t coro_wait = 0;
+    bool timed_out = false;         // 本次等待因超时被恢复
+    bool timer_queued = false;      // 定时器堆中有本连接的有效条目（到期时间 timer_ns）
+    uint64_t timer_ns = 0;
+    uint64_t deadline_ns = 0;       // 当前等待的截止时间，0 表示不限时
+
+    // WebSocket：升级请求通过校验时分配，101 写完后连接转入 WEBSOCKET 状态
+    std::unique_ptr<WebSocketState> ws;
+};
+
+// 连接的热数据，正好一个 cache line：每个 epoll 事件、写出和空闲扫描只碰这里
+// 对象由 ConnectionTable 分块分配并复用，冷数据通过 cold_ 指向旁路数组
+class alignas(64) Connection {
 public:
-    explicit Connection(int fd) : fd_(fd) {}
+    // 只供 ConnectionTable 构造，需 attach 后才能使用
+    Connection() = default;
+
+    void attach(ConnectionCold* cold, uint32_t slot) {
+        cold_ = cold;
+        slot_ = slot;
+    }
 
     int fd() const {return fd_;}
 
@@ -20,62 +72,76 @@ public:
 
     // 读缓冲区
     void appendRead(const char* data, size_t len) {
+        std::string& buf = cold_->read_buffer;
         //offset太大的时候，进行整理
-        if(read_offset_>4096 && read_offset_ > read_buffer_.size() / 2){
-            read_buffer_.erase(0, read_offset_);
+        if(read_offset_>4096 && read_offset_ > buf.size() / 2){
+            buf.erase(0, read_offset_);
             read_offset_=0;
         }
-        read_buffer_.append(data, len);
-    }
-    std::string& readBuffer(){
-        return read_buffer_;
+        buf.append(data, len);
     }
     void clearReadBuffer(){
-        read_buffer_.clear();
+        cold_->read_buffer.clear();
+        read_offset_ = 0;
     }
 
     // 写缓冲区
     void setWriteBuffer(std::string&& data){
-        write_buffer_ = std::move(data);
+        cold_->write_buffer = std::move(data);
         write_offset_ = 0;
     }
     void setWriteBuffer(const std::string& data){
-        write_buffer_ = data;
+        cold_->write_buffer = data;
         write_offset_ = 0;
     }
+    // 供路由处理函数直接写入，复用已有容量
+    std::string& writeBuffer(){
+        return cold_->write_buffer;
+    }
+    void setWriteOffset(size_t offset){
+        write_offset_ = offset;
+    }
     const char* writeData() const {
-        return write_buffer_.data() + write_offset_;
+        return cold_->write_buffer.data() + write_offset_;
     }
     size_t writeRemaining() const {
-        return write_buffer_.size() - write_offset_;
+        return cold_->write_buffer.size() - write_offset_;
     }
     void advanceWrite(size_t len){
         write_offset_ += len;
     }
     bool writeComplete() const {
-        return write_offset_ >= write_buffer_.size();
+        return write_offset_ >= cold_->write_buffer.size();
     }
 
     // Sendfile
     void setSendfile(const std::string& path, off_t size){
-        sendfile_path_ = path;
-        sendfile_size_ = size;
-        sendfile_offset_ = 0;
+        cold_->sendfile_path = path;
+        cold_->sendfile_size = size;
+        cold_->sendfile_offset = 0;
     }
     bool hasSendfile() const {
-        return !sendfile_path_.empty();
+        return !cold_->sendfile_path.empty();
     }
     const std::string& sendfilePath() const {
-        return sendfile_path_;
+        return cold_->sendfile_path;
     }
     off_t sendfileSize() const {
-        return sendfile_size_;
+        return cold_->sendfile_size;
     }
     off_t& sendfileOffset() {
-        return sendfile_offset_;
+        return cold_->sendfile_offset;
     }
     bool sendfileComplete() const {
-        return sendfile_offset_ >= sendfile_size_;
+        return cold_->sendfile_offset >= cold_->sendfile_size;
+    }
+
+    // 请求体
+    BodyState& body() {
+        return cold_->body;
+    }
+    void resetBody() {
+        cold_->body.reset();
     }
 
     // Keep-Alive
@@ -105,94 +171,135 @@ public:
         return elapsed > timeout_ms;
     }
 
-    // 重置连接状态（用于对象池复用）
+    // 是否可以继续处理新的请求（等待 IO 或写出中的连接不能处理流水线中的下一个请求，
+    // 升级为 WebSocket 后不再有 HTTP 请求）
+    bool busy() const {
+        return state_ == ConnectionState::WAITING_IO || state_ == ConnectionState::WRITING ||
+               state_ == ConnectionState::WEBSOCKET;
+    }
+
+    // 每次复用递增（跳过 0），异步完成时据此判断连接是否已被关闭复用
+    uint32_t generation() const { return generation_; }
+    uint32_t slot() const { return slot_; }
+
+    // epoll data.u64：高 32 位 generation，低 32 位槽位
+    // generation 不为 0，因此标记总是不小于 2^32，与 Worker 的监听 / 邮箱标记不冲突
+    uint64_t epollTag() const {
+        return (static_cast<uint64_t>(generation_) << 32) | slot_;
+    }
+
+    // 重置连接状态（连接表复用槽位时调用），冷数据保留缓冲区容量
     void reset(int fd) {
         fd_ = fd;
+        if (++generation_ == 0) ++generation_;
         closeFileFd();
         state_ = ConnectionState::READING;
         has_epollout_ = false;
-        read_buffer_.clear();
-        write_buffer_.clear();
-        write_offset_ = 0;
-        read_offset_ = 0; 
-        sendfile_path_.clear();
-        sendfile_size_ = 0;
-        sendfile_offset_ = 0;
         keep_alive_ = false;
-        pool_index_ = SIZE_MAX;
-        cached_response_ = nullptr;  // 清理缓存响应
-        cached_offset_ = 0;
+        log_pending_ = false;
+        read_offset_ = 0;
+        write_offset_ = 0;
+        cached_data_ = nullptr;  // 清理缓存响应
+        cached_remaining_ = 0;
         updateActivity(std::chrono::steady_clock::now());
-    }
 
-    void setPoolIndex(size_t idx) { pool_index_ = idx; }
-    size_t poolIndex() const { return pool_index_; }
+        cold_->read_buffer.clear();
+        cold_->write_buffer.clear();
+        cold_->sendfile_path.clear();
+        cold_->sendfile_size = 0;
+        cold_->sendfile_offset = 0;
+        cold_->body.reset();
+        cold_->timing = RequestTiming{};
+        cold_->peer = PeerKey{};
+        cold_->zerocopy = 0;
+        cold_->zerocopy_pending = 0;
+        cold_->coro = nullptr;
+        cold_->coro_wait = 0;
+        cold_->timed_out = false;
+        cold_->timer_queued = false;
+        cold_->deadline_ns = 0;
+        cold_->ws.reset();
+    }
 
-    void setCachedResponse(const std::string *resp){
-        cached_response_ = resp;
-        cached_offset_ = 0;
+    // 预构建响应（缓存 arena 或路由表中），只保存视图，不拷贝
+    void setCachedResponse(std::string_view resp){
+        cached_data_ = resp.data();
+        cached_remaining_ = static_cast<uint32_t>(resp.size());
     }
 
     bool hasCachedResponse() const {
-        return cached_response_ != nullptr;
+        return cached_data_ != nullptr;
     }
 
     const char* cachedData() const {
-        return cached_response_->data() + cached_offset_;
+        return cached_data_;
     }
 
     size_t cachedRemaining() const {
-        return cached_response_->size() - cached_offset_;
+        return cached_remaining_;
     }
 
     void advanceCached(size_t len){
-        cached_offset_ += len;
+        cached_data_ += len;
+        cached_remaining_ -= static_cast<uint32_t>(len);
     }
 
     void clearCachedResponse(){
-        cached_response_ = nullptr;
-        cached_offset_ = 0;
+        cached_data_ = nullptr;
+        cached_remaining_ = 0;
     }
 
     void consumeReadBuffer(size_t len){
         read_offset_ += len;
         //如果读完了，可以直接清空
-        if(read_offset_ == read_buffer_.size()){
-            read_buffer_.clear();
+        if(read_offset_ == cold_->read_buffer.size()){
+            cold_->read_buffer.clear();
             read_offset_ = 0;
         }
     }
 
+    // 未消费的数据（跳过 read_offset_ 之前已处理的部分）
     std::string_view readBuffer() const{
-        return std::string_view(read_buffer_.data() + read_offset_, 
-                                    read_buffer_.size() - read_offset_);
+        const std::string& buf = cold_->read_buffer;
+        return std::string_view(buf.data() + read_offset_, buf.size() - read_offset_);
+    }
+
+    // 访问日志：被采样的请求在解析完成时填写，首次写出时补状态码和字节数，写完提交
+    AccessLogRecord& logRecord() { return cold_->log_record; }
+    uint64_t logStartNs() const { return cold_->log_start_ns; }
+    bool logPending() const { return log_pending_; }
+    void beginLog(uint64_t start_ns) {
+        cold_->log_start_ns = start_ns;
+        cold_->log_record.status = 0;
+        log_pending_ = true;
     }
+    void endLog() { log_pending_ = false; }
+
+    RequestTiming& timing() { return cold_->timing; }
+    ConnectionCold& cold() { return *cold_; }
 
     bool hasEpollout() const { return has_epollout_; }
     void setHasEpollout(bool v) { has_epollout_ = v; }
 
 private:
-    int fd_;
+    int fd_ = -1;
+    uint32_t generation_ = 0;
+    uint32_t slot_ = UINT32_MAX;    // 在 ConnectionTable 中的槽位
     int file_fd_ = -1;
-    size_t pool_index_ = SIZE_MAX;  // 在 active_conns_ 中的索引
 
-    const std::string* cached_response_ = nullptr;
-    size_t cached_offset_ = 0;
-    
-private:
     ConnectionState state_ = ConnectionState::READING;
     bool has_epollout_ = false;
-    std::string read_buffer_;
-    std::string write_buffer_;
-    size_t read_offset_ = 0;
-    size_t write_offset_ = 0;
-    std::string sendfile_path_;
-    off_t sendfile_size_ = 0;
-    off_t sendfile_offset_ = 0;
     bool keep_alive_ = false;
+    bool log_pending_ = false;
+    uint32_t cached_remaining_ = 0; // 缓存响应不超过 ResponseCache 的单文件上限
 
+    const char* cached_data_ = nullptr;
+    size_t read_offset_ = 0;
+    size_t write_offset_ = 0;
     std::chrono::steady_clock::time_point last_active_ = std::chrono::steady_clock::now();
-
+    ConnectionCold* cold_ = nullptr;
 };
 
-#endif
\ No newline at end of file
+static_assert(sizeof(Connection) == 64, "Connection hot fields must fit one cache line");
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef CONNECTION_TABLE_H
+#define CONNECTION_TABLE_H
+
+#include "connection.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// 每个 Worker 一张连接表，按槽位索引
+// 热数据（Connection，64 字节）在每块中连续存放，冷数据在同一块的旁路数组里；
+// 按块增长，已分配的连接地址不变（IO 任务持有 Connection* + generation）
+class ConnectionTable {
+public:
+    static constexpr uint32_t CHUNK_SIZE = 1024;
+
+    ConnectionTable() = default;
+
+    // 禁止拷贝
+    ConnectionTable(const ConnectionTable&) = delete;
+    ConnectionTable& operator=(const ConnectionTable&) = delete;
+
+    Connection* acquire(int fd) {
+        if (free_.empty()) grow();
+        uint32_t slot = free_.back();
+        free_.pop_back();
+        Connection* conn = &at(slot);
+        conn->reset(fd);
+        ++active_;
+        return conn;
+    }
+
+    void release(Connection* conn) {
+        conn->reset(-1);
+        free_.push_back(conn->slot());   // 后进先出，刚释放的槽位还在缓存里
+        --active_;
+    }
+
+    // epoll 标记换回连接：槽位已释放或被复用（generation 不符）时返回 nullptr，
+    // 同一批事件中前面的处理关闭了连接，后面的陈旧事件不会落到新连接上
+    Connection* find(uint64_t tag) {
+        uint32_t slot = static_cast<uint32_t>(tag);
+        if (slot >= capacity()) return nullptr;
+        Connection* conn = &at(slot);
+        if (conn->fd() < 0 || conn->generation() != static_cast<uint32_t>(tag >> 32))
+            return nullptr;
+        return conn;
+    }
+
+    // 遍历所有活跃连接（顺序扫描热数据数组）
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        for (auto& chunk : chunks_) {
+            for (Connection& conn : chunk->hot) {
+                if (conn.fd() >= 0) fn(&conn);
+            }
+        }
+    }
+
+    // 连接全部归还后释放所有块（Worker 退役时），之后按需重新增长
+    void shrink() {
+        if (active_ != 0) return;
+        chunks_.clear();
+        chunks_.shrink_to_fit();
+        free_.clear();
+        free_.shrink_to_fit();
+    }
+
+    size_t size() const { return active_; }
+    size_t capacity() const { return chunks_.size() * CHUNK_SIZE; }
+
+private:
+    struct Chunk {
+        Connection hot[CHUNK_SIZE];
+        ConnectionCold cold[CHUNK_SIZE];
+    };
+
+    Connection& at(uint32_t slot) {
+        return chunks_[slot / CHUNK_SIZE]->hot[slot % CHUNK_SIZE];
+    }
+
+    void grow() {
+        uint32_t base = static_cast<uint32_t>(capacity());
+        chunks_.push_back(std::make_unique<Chunk>());
+        Chunk& chunk = *chunks_.back();
+        for (uint32_t i = 0; i < CHUNK_SIZE; ++i) {
+            chunk.hot[i].attach(&chunk.cold[i], base + i);
+        }
+        // 逆序入栈，低槽位先被使用
+        for (uint32_t i = CHUNK_SIZE; i > 0; --i) {
+            free_.push_back(base + i - 1);
+        }
+    }
+
+    std::vector<std::unique_ptr<Chunk>> chunks_;
+    std::vector<uint32_t> free_;
+    size_t active_ = 0;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef CORO_H
+#define CORO_H
+
+// 连接协程的最小运行时（HPHS_COROUTINES 构建才包含）：
+// 协程立即开始执行、结束时自行销毁，帧从所属 Worker 的 FramePool 分配
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <vector>
+
+// 固定大小的协程帧池，每个 Worker 一个，只在所属线程上使用
+// 同一个协程函数的帧大小固定，第一次分配的大小（向上取整）即为块大小，更大的帧退回 operator new
+class FramePool {
+public:
+    FramePool() = default;
+    ~FramePool() {
+        for (void* block : free_) ::operator delete(block);
+    }
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // 当前线程的帧池，由 Worker::run 设置；未设置时帧直接走 operator new
+    static FramePool*& current() {
+        static thread_local FramePool* pool = nullptr;
+        return pool;
+    }
+
+    void* allocate(size_t size) {
+        size_t total = size + sizeof(Header);
+        if (block_size_ == 0) block_size_ = (total + 63) & ~size_t(63);
+
+        void* block;
+        FramePool* owner = nullptr;
+        if (total <= block_size_) {
+            owner = this;
+            if (!free_.empty()) {
+                block = free_.back();
+                free_.pop_back();
+                ++reused_;
+            } else {
+                block = ::operator new(block_size_);
+                ++allocated_;
+            }
+        } else {
+            block = ::operator new(total);
+            ++oversized_;
+        }
+        static_cast<Header*>(block)->pool = owner;
+        return static_cast<Header*>(block) + 1;
+    }
+
+    // 不属于任何池的帧，头部布局相同，释放走同一条路径
+    static void* allocateUnpooled(size_t size) {
+        Header* block = static_cast<Header*>(::operator new(size + sizeof(Header)));
+        block->pool = nullptr;
+        return block + 1;
+    }
+
+    static void deallocate(void* frame) {
+        Header* block = static_cast<Header*>(frame) - 1;
+        if (block->pool) {
+            block->pool->free_.push_back(block);
+        } else {
+            ::operator delete(block);
+        }
+    }
+
+    // 归还空闲块（Worker 退役时），在用的帧不受影响
+    void trim() {
+        for (void* block : free_) ::operator delete(block);
+        free_.clear();
+        free_.shrink_to_fit();
+    }
+
+    size_t blockSize() const { return block_size_; }
+    uint64_t allocated() const { return allocated_; }   // 新分配的块
+    uint64_t reused() const { return reused_; }         // 从空闲链表取出的块
+    uint64_t oversized() const { return oversized_; }
+    size_t idle() const { return free_.size(); }
+
+private:
+    struct alignas(16) Header {
+        FramePool* pool;    // nullptr 表示直接由 operator new 分配
+    };
+
+    size_t block_size_ = 0;
+    std::vector<void*> free_;
+    uint64_t allocated_ = 0;
+    uint64_t reused_ = 0;
+    uint64_t oversized_ = 0;
+};
+
+// 即发即弃的协程：不保存句柄，协程体负责在结束前清理自己持有的连接
+struct CoTask {
+    struct promise_type {
+        CoTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+
+        static void* operator new(size_t size) {
+            FramePool* pool = FramePool::current();
+            return pool ? pool->allocate(size) : FramePool::allocateUnpooled(size);
+        }
+        static void operator delete(void* frame) noexcept {
+            FramePool::deallocate(frame);
+        }
+    };
+};
+
+#endif
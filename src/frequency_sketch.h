@@ -0,0 +1,80 @@
+#ifndef FREQUENCY_SKETCH_H
+#define FREQUENCY_SKETCH_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// TinyLFU 频率草图：4 行 count-min，4 位计数器（上限 15），16 个计数器打包在一个 64 位字里
+// 多个 Worker 并发更新，计数用 relaxed load/store：偶尔丢失一次递增不影响准入判断；
+// 计数器饱和后不再写入，热点 key 的查询只读共享缓存行。累计访问达到样本数后全体减半（老化），
+// 访问次数按线程每 16 次合并写一次共享计数
+class FrequencySketch {
+public:
+    explicit FrequencySketch(size_t expected_entries) {
+        size_t words = 64;
+        while (words * 4 < expected_entries) words <<= 1;   // 计数器数约为条目数的 4 倍以上
+        words_ = words;
+        counter_mask_ = words * 16 - 1;
+        sample_ = expected_entries * 10;
+        table_.reset(new std::atomic<uint64_t>[words]());
+    }
+
+    void increment(uint64_t hash) {
+        for (int row = 0; row < 4; ++row) {
+            size_t index = indexOf(hash, row);
+            std::atomic<uint64_t>& word = table_[index >> 4];
+            int shift = static_cast<int>(index & 15) * 4;
+            uint64_t value = word.load(std::memory_order_relaxed);
+            if (((value >> shift) & 15) < 15) {
+                word.store(value + (1ull << shift), std::memory_order_relaxed);
+            }
+        }
+        // 热点全部饱和后仍要老化，否则新的热点永远比不过旧的
+        thread_local uint32_t local = 0;
+        if ((++local & 15) != 0) return;
+        uint64_t n = additions_.load(std::memory_order_relaxed) + 16;
+        additions_.store(n, std::memory_order_relaxed);
+        if (n >= sample_) age();
+    }
+
+    uint32_t estimate(uint64_t hash) const {
+        uint32_t freq = 15;
+        for (int row = 0; row < 4; ++row) {
+            size_t index = indexOf(hash, row);
+            uint64_t value = table_[index >> 4].load(std::memory_order_relaxed);
+            uint32_t count = static_cast<uint32_t>((value >> ((index & 15) * 4)) & 15);
+            if (count < freq) freq = count;
+        }
+        return freq;
+    }
+
+private:
+    size_t indexOf(uint64_t hash, int row) const {
+        static constexpr uint64_t SEEDS[4] = {
+            0xc3a5c85c97cb3127ull, 0xb492b66fbe98f273ull,
+            0x9ae16a3b2f90404full, 0xcbf29ce484222325ull,
+        };
+        uint64_t h = (hash + SEEDS[row]) * SEEDS[(row + 1) & 3];
+        h ^= h >> 32;
+        return static_cast<size_t>(h) & counter_mask_;
+    }
+
+    void age() {
+        for (size_t i = 0; i < words_; ++i) {
+            uint64_t value = table_[i].load(std::memory_order_relaxed);
+            table_[i].store((value >> 1) & 0x7777777777777777ull, std::memory_order_relaxed);
+        }
+        additions_.store(additions_.load(std::memory_order_relaxed) / 2,
+                         std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<std::atomic<uint64_t>[]> table_;
+    size_t words_ = 0;
+    size_t counter_mask_ = 0;
+    uint64_t sample_ = 0;
+    std::atomic<uint64_t> additions_{0};
+};
+
+#endif
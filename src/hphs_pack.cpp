@@ -0,0 +1,33 @@
+// hphs-pack：把 www_root 预构建成响应缓存快照，服务器以 --cache-snapshot=FILE 直接映射使用
+//
+//   hphs-pack <www_root> <output>
+
+#include "cache_snapshot.h"
+#include "response_cache.h"
+
+#include <chrono>
+#include <iostream>
+
+int main(int argc, char* argv[]){
+    if(argc != 3){
+        std::cerr << "Usage: " << argv[0] << " <www_root> <output>" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<PreparedFile> files = ResponseCache::scan(argv[1]);
+    size_t bytes = 0;
+    size_t aliases = 0;
+    for(const PreparedFile& f : files){
+        bytes += f.response.size();
+        if(!f.alias.empty()) ++aliases;
+    }
+    if(!CacheSnapshot::write(argv[2], files)) return 1;
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "Packed " << files.size() << " files (" << aliases << " aliases, "
+              << bytes / 1024 << " KB of responses) into " << argv[2]
+              << " in " << ms << " ms" << std::endl;
+    return 0;
+}
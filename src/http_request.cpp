@@ -1,6 +1,5 @@
 #include "http_request.h"
-#include <sstream>
-#include <algorithm>
+#include <charconv>
 
 bool HttpRequest::parse(std::string_view buffer){
     /*
@@ -16,38 +15,44 @@ bool HttpRequest::parse(std::string_view buffer){
     if(header_end == std::string_view::npos){
         return false;
     }
+    header_complete_ = true;
 
-    // parsed_length_ = header_end + 4;
-
-    std::string_view header_part = buffer.substr(0, header_end);
-    body_ = buffer.substr(header_end + 4);
+    // 保留最后一个头部的 \r\n，保证每一行都以 \r\n 结尾
+    std::string_view header_part = buffer.substr(0, header_end + 2);
 
     // 解析请求行
     size_t line_end = header_part.find("\r\n");
-    if (line_end == std::string::npos) return false;
+    if (line_end == std::string_view::npos) return false;
     
     std::string_view request_line = header_part.substr(0, line_end);
     if (!parseRequestLine(request_line)) return false;
 
     // 解析请求头
     std::string_view headers = header_part.substr(line_end + 2);
-    parseHeaders(headers);
-
-    size_t body_len = 0;
-    if(headers_.count("content-length")){
-        body_len = std::stoi(headers_["content-length"]);
-    }
-
-    if(buffer.size() < header_end + 4 + body_len){
-        return false;
-    }
-
-    parsed_length_ = header_end + 4 + body_len;
-
-    if(body_len > 0){
-        body_ = buffer.substr(header_end + 4, body_len);
+    if (!parseHeaders(headers)) return false;
+
+    // 请求体长度：Transfer-Encoding 优先于 Content-Length
+    std::string_view te = getHeader("Transfer-Encoding");
+    if(te.data()){
+        bool chunked = false;
+        for(size_t i = 0; i + 7 <= te.size() && !chunked; ++i){
+            chunked = equalsIgnoreCase(te.substr(i, 7), "chunked");
+        }
+        if(!chunked){
+            return false;
+        }
+        chunked_ = true;
+    } else {
+        std::string_view value = getHeader("Content-Length");
+        if(value.data()){
+            auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), content_length_);
+            if(ec != std::errc() || end != value.data() + value.size()){
+                return false;
+            }
+        }
     }
 
+    parsed_length_ = header_end + 4;
     return true;
 }
 
@@ -78,20 +83,101 @@ bool HttpRequest::parseRequestLine(std::string_view line){
     line.remove_prefix(method_end + 1);
     size_t path_end = line.find(' ');
     if (path_end == std::string_view::npos) return false;
-    path_ = line.substr(0, path_end);
+    target_ = line.substr(0, path_end);
 
     line.remove_prefix(path_end + 1);
     version_ = line;    
 
-    if (path_.empty()){
-        path_ = "/";
+    return normalizeTarget(target_);
+}
+
+static int hexValue(char c){
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool HttpRequest::normalizeTarget(std::string_view target){
+    // absolute-form（http://host/path）只取路径部分
+    if (!target.empty() && target[0] != '/'){
+        size_t scheme = target.find("://");
+        if (scheme == std::string_view::npos ||
+            !(equalsIgnoreCase(target.substr(0, scheme), "http") ||
+              equalsIgnoreCase(target.substr(0, scheme), "https"))) return false;
+        size_t slash = target.find('/', scheme + 3);
+        target = slash == std::string_view::npos ? std::string_view() : target.substr(slash);
     }
 
+    // 一遍扫描找出 query / fragment 的起点，同时检查是否需要改写：
+    // 常见情况没有 %、连续斜杠和以 . 开头的段，path_ 直接引用原始数据
+    bool clean = true;
+    size_t end = 0;
+    for (char prev = 0; end < target.size(); prev = target[end++]){
+        char c = target[end];
+        if (c == '?' || c == '#') break;
+        if (c == '%' || (prev == '/' && (c == '/' || c == '.'))) clean = false;
+    }
+    if (end < target.size()){
+        if (target[end] == '?'){
+            query_ = target.substr(end + 1);
+            query_ = query_.substr(0, query_.find('#'));
+        }
+        target = target.substr(0, end);
+    }
+    if (target.empty()){
+        path_ = "/";
+        return true;
+    }
+    if (clean){
+        path_ = target;
+        return true;
+    }
+    if (target.size() > MAX_PATH_LENGTH) return false;
+
+    // 逐字节解码，同时维护当前段的起点；段结束时处理 . 和 ..
+    char* out = path_buf_;
+    size_t n = 1;
+    size_t seg = 1;
+    out[0] = '/';
+    auto closeSegment = [&]() {
+        std::string_view s(out + seg, n - seg);
+        if (s == "."){
+            n = seg;
+        } else if (s == ".."){
+            if (seg == 1) return false;     // 越过根目录
+            n = seg - 1;
+            while (out[n - 1] != '/') --n;
+            seg = n;
+        }
+        return true;
+    };
+    for (size_t i = 1; i < target.size(); ++i){
+        char c = target[i];
+        if (c == '%'){
+            int hi = i + 2 < target.size() ? hexValue(target[i + 1]) : -1;
+            int lo = hi >= 0 ? hexValue(target[i + 2]) : -1;
+            if (lo < 0 || (hi | lo) == 0) return false;    // 不完整的转义或 %00
+            c = static_cast<char>(hi << 4 | lo);
+            i += 2;
+        }
+        if (c != '/'){
+            out[n++] = c;
+            continue;
+        }
+        if (n == seg) continue;             // 连续斜杠
+        if (!closeSegment()) return false;
+        if (n == seg) continue;             // . / .. 已去掉，结尾已是斜杠
+        out[n++] = '/';
+        seg = n;
+    }
+    if (n > seg && !closeSegment()) return false;
+    path_ = std::string_view(out, n);
     return true;
 }
 
 
-void HttpRequest::parseHeaders(std::string_view header_part){
+bool HttpRequest::parseHeaders(std::string_view header_part){
     size_t start = 0;
     size_t pos = 0;
 
@@ -104,32 +190,43 @@ void HttpRequest::parseHeaders(std::string_view header_part){
 
 
         size_t colon = line.find(':');
-        if (colon == std::string::npos) continue;
+        if (colon == std::string_view::npos) continue;
 
         std::string_view key = line.substr(0, colon);
         std::string_view value = line.substr(colon + 1);
 
         size_t non_space = value.find_first_not_of(" \t");
-        if(non_space != std::string::npos){
+        if(non_space != std::string_view::npos){
             value.remove_prefix(non_space);
         } else {
-            value = {};
+            value = value.substr(value.size());   // 空值仍指向缓冲区，与“不存在”区分
+        }
+        if(header_count_ == MAX_HEADERS) return false;
+        headers_[header_count_++] = {key, value};
+
+        if(equalsIgnoreCase(key, "Connection")){
+            connection_ = value;
+        } else if(equalsIgnoreCase(key, "If-None-Match")){
+            if_none_match_ = value;
+        } else if(equalsIgnoreCase(key, "Expect")){
+            expect_continue_ = equalsIgnoreCase(value, "100-continue");
         }
-        headers_[toLower(std::string(key))] = std::string(value);
     }
+    return true;
 }
 
-std::string HttpRequest::getHeader(const std::string& key) const {
-    std::string lower_key = toLower(key);
-    auto it = headers_.find(lower_key);
-    if(it != headers_.end()){
-        return it->second;
+// 重复的请求头取最后一个
+std::string_view HttpRequest::getHeader(std::string_view key) const {
+    for(size_t i = header_count_; i > 0; --i){
+        if(equalsIgnoreCase(headers_[i - 1].key, key)){
+            return headers_[i - 1].value;
+        }
     }
-    return "";
+    return std::string_view();
 }
 
 bool HttpRequest::keepAlive() const {
-    std::string connection = getHeader("Connection");
+    std::string_view connection = connection_;
 
     if(version_ == "HTTP/1.1"){
         if (connection == "close") return false;
@@ -140,7 +237,7 @@ bool HttpRequest::keepAlive() const {
     }
 }
 
-std::string HttpRequest::methodString() const {
+std::string_view HttpRequest::methodString() const {
     switch (method_){
         case GET: return "GET";
         case POST: return "POST";
@@ -151,9 +248,14 @@ std::string HttpRequest::methodString() const {
     }
 }
 
-std::string HttpRequest::toLower(const std::string& str) {
-    std::string result = str;
-    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
-    return result;
+bool HttpRequest::equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if(a.size() != b.size()) return false;
+    for(size_t i = 0; i < a.size(); ++i){
+        char x = a[i], y = b[i];
+        if(x >= 'A' && x <= 'Z') x = static_cast<char>(x - 'A' + 'a');
+        if(y >= 'A' && y <= 'Z') y = static_cast<char>(y - 'A' + 'a');
+        if(x != y) return false;
+    }
+    return true;
 }
 
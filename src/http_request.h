@@ -1,8 +1,9 @@
 #ifndef HTTP_REQUEST_H
 #define HTTP_REQUEST_H
 
-#include <string>
-#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 
 /**
  * 
@@ -10,6 +11,13 @@
  * -请求头: Host: example.com
  * -请求体: POST
  * 
+ * 解析结果全部是指向传入缓冲区的 string_view，不做堆分配；
+ * 缓冲区需在使用 HttpRequest 期间保持不变（Worker 在 processRequest 内用完即弃）。
+ * 请求头最多 MAX_HEADERS 个，超过按格式错误处理。
+ *
+ * path() 是规范化后的路径：去掉 query 和 fragment，百分号解码，合并连续斜杠，
+ * 解析 . 和 ..（越过根目录按格式错误处理）。不需要改写时直接指向原始请求行，
+ * 否则写入对象内的定长缓冲区，因此 HttpRequest 不可复制。
  */
 
 class HttpRequest{
@@ -23,25 +31,58 @@ public:
         DELETE
     };
 
+    static constexpr size_t MAX_HEADERS = 64;
+    static constexpr size_t MAX_PATH_LENGTH = 2048;    // 需要改写的路径上限，超过按格式错误处理
+
     HttpRequest() : method_(INVALID), version_("HTTP/1.1") {}
+    HttpRequest(const HttpRequest&) = delete;
+    HttpRequest& operator=(const HttpRequest&) = delete;
 
     /**
-     * 解析HTTP请求
+     * 解析HTTP请求头（请求体由 Connection 流式接收，不在这里等待）
      * @param buffer 原始HTTP请求字符串
      * @return 解析是否成功
      */
     bool parse(std::string_view buffer);
 
+    /**
+     * 请求头是否已完整到达，用于区分“数据不够”和“格式错误”
+     */
+    bool headerComplete() const {return header_complete_; }
+
     Method method() const {return method_; }
-    const std::string& path() const {return path_; }
-    const std::string& version() const {return version_; }
-    const std::string& body() const {return body_; }   
+    std::string_view path() const {return path_; }
+    // 请求行中的原始 request-target
+    std::string_view target() const {return target_; }
+    // '?' 之后、'#' 之前的部分，没有时为空
+    std::string_view query() const {return query_; }
+    std::string_view version() const {return version_; }
+
+    /**
+     * 请求体信息：Content-Length 或 Transfer-Encoding: chunked
+     */
+    uint64_t contentLength() const {return content_length_; }
+    bool chunked() const {return chunked_; }
+    bool hasBody() const {return chunked_ || content_length_ > 0; }
+    // HTTP/1.1 的 Expect: 100-continue：客户端等 100 Continue 或最终响应后才发送请求体
+    bool expectContinue() const {return expect_continue_ && version_ == "HTTP/1.1"; }
+
+    /**
+     * 交给路由处理函数的请求体，由 Worker 在请求体整体到达后设置；其余请求为空
+     */
+    std::string_view body() const {return body_; }
+    void setBody(std::string_view body) {body_ = body; }
     
     /**
-     * @param key 请求头名称
-     * @return 请求头的值
+     * @param key 请求头名称（不区分大小写）
+     * @return 请求头的值，不存在时为空
      */
-    std::string getHeader(const std::string& key) const;
+    std::string_view getHeader(std::string_view key) const;
+
+    /**
+     * 条件请求的 If-None-Match，解析时顺带取出，不存在时为空
+     */
+    std::string_view ifNoneMatch() const {return if_none_match_; }
 
     /**
      * 是否为Keep-Alive
@@ -51,10 +92,10 @@ public:
     /**
      * 方法枚举转换成字符串
      */
-    std::string methodString() const;
+    std::string_view methodString() const;
 
     /**
-     * 返回解析消耗的字节数
+     * 返回解析消耗的字节数（仅请求头）
      */
     size_t parseLength() const {return parsed_length_;}
 
@@ -66,23 +107,44 @@ private:
     bool parseRequestLine(std::string_view line);
 
     /**
-     * 解析请求头
+     * 由 request-target 得到 path_ 和 query_，不合法时返回 false
      */
-    void parseHeaders(std::string_view header_part);
+    bool normalizeTarget(std::string_view target);
 
     /**
-     * 字符串转小写
+     * 解析请求头，超过 MAX_HEADERS 时返回 false
      */
-    static std::string toLower(const std::string& str);
+    bool parseHeaders(std::string_view header_part);
+
+    /**
+     * ASCII 不区分大小写比较
+     */
+    static bool equalsIgnoreCase(std::string_view a, std::string_view b);
 
 
 private:
+    struct Header {
+        std::string_view key;
+        std::string_view value;
+    };
+
     Method method_;
-    std::string path_;
-    std::string version_;
-    std::unordered_map<std::string, std::string> headers_;
-    std::string body_;
+    std::string_view target_;
+    std::string_view path_;
+    std::string_view query_;
+    std::string_view version_;
+    Header headers_[MAX_HEADERS];
+    size_t header_count_ = 0;
+    // 解析路径上要用的几个请求头，避免再次线性查找
+    std::string_view connection_;
+    std::string_view if_none_match_;
+    uint64_t content_length_ = 0;
+    std::string_view body_;
+    bool chunked_ = false;
+    bool expect_continue_ = false;
+    bool header_complete_ = false;
     size_t parsed_length_ = 0;
+    char path_buf_[MAX_PATH_LENGTH];
 
 
 };
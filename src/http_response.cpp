@@ -33,10 +33,37 @@ std::string HttpResponse::build(){
 
 }
 
-std::string HttpResponse::getStatusMessage(int code){
+std::string_view HttpResponse::prebuiltError(int status, bool keep_alive){
+    static constexpr int STATUSES[] = {400, 404, 405, 413, 500};
+    static constexpr size_t COUNT = sizeof(STATUSES) / sizeof(STATUSES[0]);
+    // 函数内静态量，首次调用时线程安全地构建
+    static const std::string *const responses = [] {
+        auto *built = new std::string[COUNT * 2];
+        for (size_t i = 0; i < COUNT; ++i) {
+            for (int k = 0; k < 2; ++k) {
+                HttpResponse response;
+                response.setStatusCode(STATUSES[i]);
+                response.setBody(std::string("<html><body><h1>") + std::to_string(STATUSES[i]) +
+                                 " " + getStatusMessage(STATUSES[i]) + "</h1></body></html>");
+                response.setContentType("text/html");
+                response.setKeepAlive(k == 1);
+                built[i * 2 + k] = response.build();
+            }
+        }
+        return built;
+    }();
+    size_t index = COUNT - 1;
+    for (size_t i = 0; i < COUNT; ++i) {
+        if (STATUSES[i] == status) index = i;
+    }
+    return responses[index * 2 + (keep_alive ? 1 : 0)];
+}
+
+const char* HttpResponse::getStatusMessage(int code){
     switch(code){
         case 200: return "OK";
         case 201: return "Created";
+        case 202: return "Accepted";
         case 204: return "No Content";
         case 301: return "Moved Permanently";
         case 302: return "Found";
@@ -46,6 +73,9 @@ std::string HttpResponse::getStatusMessage(int code){
         case 403: return "Forbidden";
         case 404: return "Not Found";
         case 405: return "Method Not Allowed";
+        case 411: return "Length Required";
+        case 413: return "Payload Too Large";
+        case 429: return "Too Many Requests";
         case 500: return "Internal Server Error";
         case 501: return "Not Implemented";
         case 502: return "Bad Gateway";
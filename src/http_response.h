@@ -2,6 +2,7 @@
 #define HTTP_RESPONSE_H
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 /**
@@ -34,6 +35,7 @@ public:
      * @param body
      */
     void setBody(const std::string& body) { body_ = body;}
+    void setBody(std::string&& body) { body_ = std::move(body);}
 
     /**
      * @param key 响应头
@@ -93,10 +95,19 @@ public:
      */
 
     static std::string getContentType(const std::string& path);
+
+    /**
+     * 状态码对应的描述
+     */
+    static const char* getStatusMessage(int code);
+
+    /**
+     * 预构建的错误响应（400/404/405/413/500，其余按 500），进程内只构建一次，
+     * 之后返回的视图一直有效，错误路径上不再分配
+     */
+    static std::string_view prebuiltError(int status, bool keep_alive);
     
 private:
-    static std::string getStatusMessage(int code);
-
 private:
     int status_code_;
     std::string status_message_;
@@ -14,18 +14,662 @@
 #include <fstream>
 #include <sstream>
 #include <netinet/tcp.h>
+#include <algorithm>
+#include <chrono>
 
+// 自动缩容需连续满足条件的周期数：扩容立即执行，缩容慢一些，避免在阈值附近来回振荡
+static constexpr int SCALE_DOWN_SAMPLES = 3;
 
 void HttpServer::start(){
-    // 预加载静态文件到缓存
-    cache_.preload(config_.www_root);
-    std::cout << "Cached " << cache_.size() << " static files" << std::endl;
+    // 弹性 Worker：上限不小于启动数，下限不大于启动数
+    if(config_.max_workers > 0){
+        max_workers_ = std::max(config_.max_workers, config_.worker_count);
+        min_workers_ = std::clamp(config_.min_workers, 1, config_.worker_count);
+    }
+    int slots = max_workers_ > 0 ? max_workers_ : config_.worker_count;
+
+    if(!config_.cache_snapshot.empty() && cache_.loadSnapshot(config_.cache_snapshot)){
+        // 预构建快照：只读映射，页面按需缺页载入
+        const CacheSnapshot& snapshot = cache_.snapshot();
+        std::cout << "Cache snapshot: " << config_.cache_snapshot << ", "
+                  << snapshot.entries() << " entries, "
+                  << snapshot.mappedSize() / 1024 << " KB mapped" << std::endl;
+    } else if(config_.cache_budget > 0){
+        // 有上限的按需缓存，不预加载
+        cache_.enableBudget(config_.cache_budget, slots);
+        std::cout << "Cache: lazy fill, budget " << config_.cache_budget / 1024
+                  << " KB (max entry " << cache_.lazy()->maxEntrySize() / 1024
+                  << " KB)" << std::endl;
+    } else {
+        // 预加载静态文件到缓存
+        cache_.preload(config_.www_root);
+        std::cout << "Cached " << cache_.size() << " static files" << std::endl;
+        const ResponseArena& arena = cache_.arena();
+        std::cout << "Cache arena: " << arena.used() / 1024 << " KB used / "
+                  << arena.capacity() / 1024 << " KB mapped ("
+                  << arena.backingName() << "), " << cache_.aliasCount()
+                  << " aliases share bytes" << std::endl;
+    }
 
+    registerBuiltinRoutes();
+    // 命令行指定的 WebSocket 端点：客户端发来的消息原样广播给该端点的全部订阅者
+    for(const std::string& path : config_.websocket_paths){
+        router_.addWebSocket(path, [this](uint32_t channel, std::string_view payload, bool binary){
+            publishWebSocket(channel, websocket::makeFrame(
+                binary ? websocket::BINARY : websocket::TEXT, payload));
+        });
+    }
+    router_.compile();
+    std::cout << "Registered " << router_.size() << " routes" << std::endl;
+
+    if(config_.io_threads > 0){
+        io_pool_ = std::make_unique<IoPool>(config_.io_threads);
+    }
+
+    if(!config_.access_log.empty()){
+        access_log_ = std::make_unique<AccessLogger>(
+            config_.access_log, slots, config_.access_log_ring,
+            config_.access_log_sample);
+        if(!access_log_->start()){
+            std::cerr << "Failed to open access log " << config_.access_log << std::endl;
+            access_log_.reset();
+        }
+    }
+
+    openSharedListeners();
+
+    // 先全部创建再启动，运行期 workers_ 不再变化，stats 路由可以无锁遍历；
+    // 弹性模式按上限创建，超出启动数的 Worker 只占计数器和邮箱，由控制线程按需启动
+    for(int i = 0; i < slots; ++i){
+        workers_.push_back(std::make_unique<Worker>(i, config_, cache_, router_,
+                                                    io_pool_.get()));
+        workers_.back()->setAccessLog(access_log_.get());
+        for(const auto& listener : shared_listeners_){
+            workers_.back()->addSharedListener(listener.first, false);
+        }
+    }
+    std::vector<Worker*> peers;
+    for(auto& worker : workers_){
+        peers.push_back(worker.get());
+    }
+    for(auto& worker : workers_){
+        worker->setPeers(peers);
+    }
     for(int i = 0; i < config_.worker_count; ++i){
-        workers_.push_back(std::make_unique<Worker>(i, config_, cache_));
-        workers_.back()->start();
+        if(workers_[i]->start()) ++active_workers_;
     }
     running_ = true;
+    if(max_workers_ > 0){
+        utilization_.reset(new std::atomic<uint32_t>[slots]());
+        std::cout << "Elastic workers: " << active_workers_.load() << " active, "
+                  << min_workers_ << ".." << max_workers_;
+        if(config_.autoscale_ms > 0){
+            std::cout << ", autoscale every " << config_.autoscale_ms << " ms ("
+                      << config_.scale_down_util << "%.." << config_.scale_up_util << "%)";
+        }
+        std::cout << std::endl;
+        scaler_ = std::thread(&HttpServer::runScaler, this);
+    }
+}
+
+bool HttpServer::setWorkerCount(int count){
+    if(max_workers_ == 0 || count < min_workers_ || count > max_workers_) return false;
+    {
+        std::lock_guard<std::mutex> lock(scale_mutex_);
+        scale_target_ = count;
+    }
+    scale_cv_.notify_one();
+    return true;
+}
+
+// 弹性 Worker 的控制线程：管理命令随时唤醒，开启 autoscale 时按周期采样在线 Worker 的线程 CPU 时间。
+// 一次只增减一个；退役要等连接迁完（最长 drain_timeout_ms），期间不做其他调整
+void HttpServer::runScaler(){
+    std::vector<uint64_t> last_cpu(workers_.size());
+    auto last_sample = std::chrono::steady_clock::now();
+    auto resample = [&]{
+        for(size_t i = 0; i < workers_.size(); ++i) last_cpu[i] = workers_[i]->cpuTimeNs();
+        last_sample = std::chrono::steady_clock::now();
+    };
+    resample();
+    int low_samples = 0;
+
+    while(running_){
+        {
+            std::unique_lock<std::mutex> lock(scale_mutex_);
+            auto wake = [this]{ return !running_ || scale_target_.load() != 0; };
+            if(config_.autoscale_ms > 0){
+                scale_cv_.wait_for(lock, std::chrono::milliseconds(config_.autoscale_ms), wake);
+            } else {
+                scale_cv_.wait(lock, wake);
+            }
+        }
+        if(!running_) break;
+
+        int target = scale_target_.exchange(0);
+        if(target > 0){
+            while(running_ && activeWorkers() < target && addWorker()){}
+            while(running_ && activeWorkers() > target && retireWorker()){}
+            resample();
+            low_samples = 0;
+            continue;
+        }
+
+        // 利用率 = 周期内线程 CPU 时间 / 墙钟时间；忙轮询模式下空闲时也接近 100%
+        auto now = std::chrono::steady_clock::now();
+        uint64_t wall = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_sample).count();
+        last_sample = now;
+        uint64_t busy = 0;
+        int active = 0;
+        for(size_t i = 0; i < workers_.size(); ++i){
+            uint64_t cpu = workers_[i]->cpuTimeNs();
+            uint64_t used = cpu >= last_cpu[i] ? cpu - last_cpu[i] : cpu;
+            last_cpu[i] = cpu;
+            if(workers_[i]->state() != Worker::State::RUNNING){
+                utilization_[i] = 0;
+                continue;
+            }
+            uint32_t permille = static_cast<uint32_t>(
+                std::min<uint64_t>(1000, used * 1000 / std::max<uint64_t>(wall, 1)));
+            utilization_[i] = permille;
+            busy += permille;
+            ++active;
+        }
+        if(active == 0) continue;
+
+        if(busy / active > config_.scale_up_util * 10 && active < max_workers_){
+            low_samples = 0;
+            if(addWorker()) resample();
+        } else if(active > min_workers_ &&
+                  busy / (active - 1) < config_.scale_down_util * 10){
+            if(++low_samples >= SCALE_DOWN_SAMPLES){
+                low_samples = 0;
+                if(retireWorker()) resample();
+            }
+        } else {
+            low_samples = 0;
+        }
+    }
+}
+
+// 启动编号最小的已停止 Worker：打开自己的 SO_REUSEPORT 监听套接字加入组，内核随即开始向它分发新连接
+bool HttpServer::addWorker(){
+    for(auto& worker : workers_){
+        if(worker->state() != Worker::State::STOPPED) continue;
+        worker->join();
+        if(!worker->start()){
+            std::cerr << "Scale: failed to start worker " << worker->id() << std::endl;
+            return false;
+        }
+        int active = ++active_workers_;
+        publishRateShare(active);
+        std::cout << "Scale: worker " << worker->id() << " started, "
+                  << active << " active" << std::endl;
+        return true;
+    }
+    return false;
+}
+
+// 退役编号最大的在线 Worker，在线 Worker 的编号保持连续；阻塞到它的连接迁完、线程退出
+bool HttpServer::retireWorker(){
+    if(activeWorkers() <= 1) return false;
+    for(auto it = workers_.rbegin(); it != workers_.rend(); ++it){
+        Worker& worker = **it;
+        if(worker.state() != Worker::State::RUNNING) continue;
+        uint64_t migrated = worker.migratedOut();
+        std::cout << "Scale: retiring worker " << worker.id() << ", draining "
+                  << worker.connectionCount() << " connections" << std::endl;
+        worker.retire();
+        int active = --active_workers_;
+        publishRateShare(active);
+        worker.join();
+        // 线程退出前后才到达的迁入连接交给当前最轻的在线 Worker
+        Worker* target = nullptr;
+        for(auto& peer : workers_){
+            if(peer->state() != Worker::State::RUNNING) continue;
+            if(!target || peer->load() < target->load()) target = peer.get();
+        }
+        if(target) worker.handOff(*target);
+        std::cout << "Scale: worker " << worker.id() << " retired, "
+                  << worker.migratedOut() - migrated << " connections migrated, "
+                  << active << " active" << std::endl;
+        return true;
+    }
+    return false;
+}
+
+// 按 IP 限流的配额由在线 Worker 均分，增减 Worker 后通知各 Worker 重新分摊（新启动的 Worker 也在其中）
+void HttpServer::publishRateShare(int active){
+    if(!config_.ip_conn_rate && !config_.ip_request_rate &&
+       !config_.subnet_conn_rate && !config_.subnet_request_rate) return;
+    broadcast([active](Worker& w){ w.setRateShare(active); });
+}
+
+// 未指定 --listen 时沿用位置参数的端口；不含 {worker} 的 UNIX 端点在这里创建一次，所有 Worker 共享
+void HttpServer::openSharedListeners(){
+    if(config_.listen.empty()){
+        ListenEndpoint endpoint;
+        endpoint.port = config_.port;
+        config_.listen.push_back(endpoint);
+    }
+    for(const ListenEndpoint& endpoint : config_.listen){
+        std::cout << "Listening on " << endpoint.describe() << std::endl;
+        if(endpoint.perWorker()) continue;
+        int fd = openListenSocket(endpoint, 0);
+        if(fd < 0){
+            std::cerr << "Failed to listen on " << endpoint.describe() << ": "
+                      << strerror(errno) << std::endl;
+            continue;
+        }
+        shared_listeners_.emplace_back(fd, endpoint.path);
+    }
+}
+
+void HttpServer::broadcast(const std::function<void(Worker&)>& fn){
+    for(auto& worker : workers_){
+        if(worker->state() == Worker::State::STOPPED) continue;
+        worker->post(fn);
+    }
+}
+
+// 已停止的 Worker 也投递，重新启动时先处理
+void HttpServer::publishCacheGeneration(uint64_t generation){
+    for(auto& worker : workers_){
+        worker->postCacheGeneration(generation);
+    }
+}
+
+bool HttpServer::broadcastWebSocket(const std::string& path, std::string_view payload, bool binary){
+    int32_t channel = router_.webSocketChannel(path);
+    if(channel < 0) return false;
+    publishWebSocket(static_cast<uint32_t>(channel),
+                     websocket::makeFrame(binary ? websocket::BINARY : websocket::TEXT, payload));
+    return true;
+}
+
+void HttpServer::publishWebSocket(uint32_t channel, websocket::Frame frame){
+    for(auto& worker : workers_){
+        if(worker->state() == Worker::State::STOPPED) continue;
+        worker->postWebSocketFrame(channel, frame);
+    }
+}
+
+// 千分之一为单位的定点数，保留三位小数输出
+static void writeThousandths(ResponseWriter& out, uint64_t value){
+    out.write(value / 1000);
+    out.write('.');
+    uint64_t frac = value % 1000;
+    out.write(static_cast<char>('0' + frac / 100));
+    out.write(static_cast<char>('0' + frac / 10 % 10));
+    out.write(static_cast<char>('0' + frac % 10));
+}
+
+// 纳秒按微秒输出，保留三位小数
+static void writeMicros(ResponseWriter& out, uint64_t ns){
+    writeThousandths(out, ns);
+}
+
+static const char* const SYSCALL_NAMES[] = {
+    "epoll_wait", "epoll_ctl", "accept", "read", "write", "sendfile",
+};
+
+static void loadSyscalls(const Worker::SyscallCounters& c, uint64_t (&out)[6]){
+    out[0] = c.epoll_wait.load(std::memory_order_relaxed);
+    out[1] = c.epoll_ctl.load(std::memory_order_relaxed);
+    out[2] = c.accept.load(std::memory_order_relaxed);
+    out[3] = c.read.load(std::memory_order_relaxed);
+    out[4] = c.write.load(std::memory_order_relaxed);
+    out[5] = c.sendfile.load(std::memory_order_relaxed);
+}
+
+// requests 非 0 时按每请求次数输出，否则输出总数
+static void writeSyscalls(ResponseWriter& out, const uint64_t (&counts)[6], uint64_t requests){
+    out.write('{');
+    for(size_t i = 0; i < 6; ++i){
+        if(i > 0) out.write(',');
+        out.write('"');
+        out.write(SYSCALL_NAMES[i]);
+        out.write("\":");
+        if(requests > 0) writeThousandths(out, counts[i] * 1000 / requests);
+        else out.write(counts[i]);
+    }
+    out.write('}');
+}
+
+// 内置路由：/_hphs/health 为静态响应，/_hphs/stats 汇总各 Worker 计数，
+// /_hphs/latency 按需合并各 Worker 的分阶段延迟直方图
+void HttpServer::registerBuiltinRoutes(){
+    router_.addStatic(Router::GET_HEAD, "/_hphs/health", Router::EXACT,
+                      200, "text/plain; charset=utf-8", "ok\n");
+
+    router_.add(Router::GET_HEAD, "/_hphs/stats", Router::EXACT,
+                [this](const HttpRequest&, ResponseWriter& out){
+        uint64_t total_requests = 0;
+        uint64_t total_connections = 0;
+        uint64_t cache_hits = 0;
+        uint64_t cache_misses = 0;
+        uint64_t raw_hits = 0;
+        uint64_t syscalls[6] = {};
+        out.setContentType("application/json");
+        out.write("{\"workers\":[");
+        for(size_t i = 0; i < workers_.size(); ++i){
+            const Worker& w = *workers_[i];
+            if(i > 0) out.write(',');
+            out.write("{\"id\":");
+            out.write(static_cast<uint64_t>(w.id()));
+            out.write(",\"state\":\"");
+            out.write(Worker::stateName(w.state()));
+            out.write("\",\"connections\":");
+            out.write(static_cast<uint64_t>(w.connectionCount()));
+            out.write(",\"requests\":");
+            out.write(w.requestCount());
+            out.write(",\"messages\":");
+            out.write(w.messageCount());
+            out.write(",\"cpu_ms\":");
+            out.write(w.cpuTimeNs() / 1000000);
+            out.write(",\"busy_polls\":");
+            out.write(w.busyPolls());
+            out.write(",\"blocking_waits\":");
+            out.write(w.blockingWaits());
+            out.write(",\"load\":");
+            out.write(w.load());
+            out.write(",\"migrated_out\":");
+            out.write(w.migratedOut());
+            out.write(",\"migrated_in\":");
+            out.write(w.migratedIn());
+            out.write(",\"rebalances\":");
+            out.write(w.rebalances());
+            out.write(",\"cache_hits\":");
+            out.write(w.cacheHits());
+            out.write(",\"cache_misses\":");
+            out.write(w.cacheMisses());
+            out.write(",\"websocket_connections\":");
+            out.write(w.webSocket().connections.load(std::memory_order_relaxed));
+            uint64_t counts[6];
+            loadSyscalls(w.syscalls(), counts);
+            out.write(",\"syscalls\":");
+            writeSyscalls(out, counts, 0);
+            for(size_t k = 0; k < 6; ++k) syscalls[k] += counts[k];
+            out.write('}');
+            total_requests += w.requestCount();
+            total_connections += w.connectionCount();
+            cache_hits += w.cacheHits();
+            cache_misses += w.cacheMisses();
+            raw_hits += w.rawHits();
+        }
+        out.write("],\"active_workers\":");
+        out.write(static_cast<uint64_t>(activeWorkers()));
+        out.write(",\"connections\":");
+        out.write(total_connections);
+        out.write(",\"requests\":");
+        out.write(total_requests);
+        out.write(",\"busy_poll_us\":");
+        out.write(static_cast<uint64_t>(config_.busy_poll_us));
+        out.write(",\"rebalance_ms\":");
+        out.write(static_cast<uint64_t>(config_.rebalance_ms));
+        out.write(",\"epoll_register_once\":");
+        out.write(config_.epoll_register_once ? "true" : "false");
+        out.write(",\"syscalls\":");
+        writeSyscalls(out, syscalls, 0);
+        out.write(",\"syscalls_per_request\":");
+        writeSyscalls(out, syscalls, std::max<uint64_t>(total_requests, 1));
+        // 命中率按千分比输出
+        const LazyCache* lazy = cache_.lazy();
+        out.write(",\"cache\":{\"mode\":");
+        out.write(cache_.snapshot().loaded() ? "\"snapshot\""
+                  : lazy ? "\"lazy\"" : "\"preload\"");
+        out.write(",\"hits\":");
+        out.write(cache_hits);
+        out.write(",\"misses\":");
+        out.write(cache_misses);
+        out.write(",\"hit_permille\":");
+        out.write(cache_hits + cache_misses > 0
+                  ? cache_hits * 1000 / (cache_hits + cache_misses) : 0);
+        if(lazy){
+            out.write(",\"budget\":");
+            out.write(static_cast<uint64_t>(lazy->budget()));
+            out.write(",\"resident_bytes\":");
+            out.write(static_cast<uint64_t>(lazy->residentBytes()));
+            out.write(",\"entries\":");
+            out.write(static_cast<uint64_t>(lazy->entries()));
+            out.write(",\"admitted\":");
+            out.write(lazy->admitted());
+            out.write(",\"rejected\":");
+            out.write(lazy->rejected());
+            out.write(",\"evictions\":");
+            out.write(lazy->evictions());
+        } else {
+            out.write(",\"entries\":");
+            out.write(static_cast<uint64_t>(cache_.size()));
+        }
+        out.write('}');
+        // 跳过解析直接命中的请求占全部请求的千分比
+        out.write(",\"raw_request_cache\":{\"entries\":");
+        out.write(static_cast<uint64_t>(workers_.front()->rawCacheCapacity()));
+        out.write(",\"hits\":");
+        out.write(raw_hits);
+        out.write(",\"hit_permille\":");
+        out.write(total_requests > 0 ? raw_hits * 1000 / total_requests : 0);
+        out.write('}');
+        if(config_.zerocopy_threshold > 0){
+            uint64_t zc[5] = {};
+            for(auto& worker : workers_){
+                const Worker::ZerocopyCounters& c = worker->zerocopy();
+                zc[0] += c.sends.load(std::memory_order_relaxed);
+                zc[1] += c.bytes.load(std::memory_order_relaxed);
+                zc[2] += c.completed.load(std::memory_order_relaxed);
+                zc[3] += c.copied.load(std::memory_order_relaxed);
+                zc[4] += c.fallbacks.load(std::memory_order_relaxed);
+            }
+            out.write(",\"zerocopy\":{\"sends\":");
+            out.write(zc[0]);
+            out.write(",\"bytes\":");
+            out.write(zc[1]);
+            out.write(",\"completed\":");
+            out.write(zc[2]);
+            out.write(",\"copied\":");
+            out.write(zc[3]);
+            out.write(",\"fallbacks\":");
+            out.write(zc[4]);
+            out.write('}');
+        }
+        if(router_.webSocketCount() > 0){
+            uint64_t ws[6] = {};
+            for(auto& worker : workers_){
+                const Worker::WebSocketCounters& c = worker->webSocket();
+                ws[0] += c.connections.load(std::memory_order_relaxed);
+                ws[1] += c.messages.load(std::memory_order_relaxed);
+                ws[2] += c.frames.load(std::memory_order_relaxed);
+                ws[3] += c.queued.load(std::memory_order_relaxed);
+                ws[4] += c.dropped.load(std::memory_order_relaxed);
+                ws[5] += c.slow_closed.load(std::memory_order_relaxed);
+            }
+            out.write(",\"websocket\":{\"endpoints\":");
+            out.write(static_cast<uint64_t>(router_.webSocketCount()));
+            out.write(",\"connections\":");
+            out.write(ws[0]);
+            out.write(",\"messages\":");
+            out.write(ws[1]);
+            out.write(",\"frames\":");
+            out.write(ws[2]);
+            out.write(",\"queued\":");
+            out.write(ws[3]);
+            out.write(",\"dropped\":");
+            out.write(ws[4]);
+            out.write(",\"slow_closed\":");
+            out.write(ws[5]);
+            out.write('}');
+        }
+        if(workers_.front()->rateLimiter()){
+            uint64_t limited_connections = 0, limited_requests = 0, evictions = 0;
+            size_t capacity = 0;
+            for(auto& worker : workers_){
+                const RateLimiter& limiter = *worker->rateLimiter();
+                limited_connections += limiter.limitedConnections();
+                limited_requests += limiter.limitedRequests();
+                evictions += limiter.evictions();
+                capacity += limiter.capacity();
+            }
+            out.write(",\"rate_limit\":{\"limited_connections\":");
+            out.write(limited_connections);
+            out.write(",\"limited_requests\":");
+            out.write(limited_requests);
+            out.write(",\"table_entries\":");
+            out.write(static_cast<uint64_t>(capacity));
+            out.write(",\"evictions\":");
+            out.write(evictions);
+            out.write('}');
+        }
+        if(access_log_){
+            out.write(",\"access_log\":{\"written\":");
+            out.write(access_log_->written());
+            out.write(",\"dropped\":");
+            out.write(access_log_->dropped());
+            out.write('}');
+        }
+        out.write("}\n");
+    });
+
+    if(max_workers_ > 0) registerWorkerRoutes();
+
+    router_.add(Router::GET_HEAD, "/_hphs/latency", Router::EXACT,
+                [this](const HttpRequest&, ResponseWriter& out){
+        struct Stage {
+            const char* name;
+            const LatencyHistogram LatencyStats::* hist;
+            bool time;
+        };
+        static const Stage stages[] = {
+            {"parse", &LatencyStats::parse, true},
+            {"first_byte", &LatencyStats::first_byte, true},
+            {"complete", &LatencyStats::complete, true},
+            {"first_request", &LatencyStats::first_request, true},
+            {"connection_lifetime", &LatencyStats::lifetime, true},
+            {"requests_per_connection", &LatencyStats::requests_per_conn, false},
+        };
+        static const std::pair<const char*, double> quantiles[] = {
+            {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p999", 0.999},
+        };
+
+        // 快照约 5KB，放在堆上避免占用 Worker 栈
+        auto snap = std::make_unique<LatencyHistogram::Snapshot>();
+        out.setContentType("application/json");
+        out.write("{\"unit\":\"us\"");
+        for(const Stage& stage : stages){
+            *snap = LatencyHistogram::Snapshot{};
+            for(auto& worker : workers_){
+                snap->merge(worker->latency().*stage.hist);
+            }
+            auto value = [&](uint64_t v){
+                if(stage.time) writeMicros(out, v);
+                else out.write(v);
+            };
+            out.write(",\"");
+            out.write(stage.name);
+            out.write("\":{\"count\":");
+            out.write(snap->count);
+            out.write(",\"mean\":");
+            value(snap->mean());
+            for(const auto& q : quantiles){
+                out.write(",\"");
+                out.write(q.first);
+                out.write("\":");
+                value(snap->percentile(q.second));
+            }
+            out.write(",\"max\":");
+            value(snap->max);
+            out.write('}');
+        }
+        out.write("}\n");
+    });
+}
+
+// 口令比较耗时与第一个不同字节的位置无关
+static bool tokenEquals(std::string_view a, std::string_view b){
+    if(a.size() != b.size()) return false;
+    unsigned char diff = 0;
+    for(size_t i = 0; i < a.size(); ++i){
+        diff |= static_cast<unsigned char>(a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
+
+// 弹性 Worker 的管理接口：GET /_hphs/workers 查看，与 stats 一样只读、没有鉴权。
+// POST /_hphs/workers/<n> 调整在线数量，监听端点对外公开，只有配置了 admin_token 才注册，
+// 请求须带 Authorization: Bearer <token>
+void HttpServer::registerWorkerRoutes(){
+    router_.add(Router::GET_HEAD, "/_hphs/workers", Router::EXACT,
+                [this](const HttpRequest&, ResponseWriter& out){
+        out.setContentType("application/json");
+        out.write("{\"active\":");
+        out.write(static_cast<uint64_t>(activeWorkers()));
+        out.write(",\"min\":");
+        out.write(static_cast<uint64_t>(min_workers_));
+        out.write(",\"max\":");
+        out.write(static_cast<uint64_t>(max_workers_));
+        out.write(",\"autoscale_ms\":");
+        out.write(static_cast<uint64_t>(config_.autoscale_ms));
+        out.write(",\"workers\":[");
+        for(size_t i = 0; i < workers_.size(); ++i){
+            const Worker& w = *workers_[i];
+            if(i > 0) out.write(',');
+            out.write("{\"id\":");
+            out.write(static_cast<uint64_t>(w.id()));
+            out.write(",\"state\":\"");
+            out.write(Worker::stateName(w.state()));
+            out.write("\",\"connections\":");
+            out.write(static_cast<uint64_t>(w.connectionCount()));
+            if(config_.autoscale_ms > 0){
+                out.write(",\"utilization_permille\":");
+                out.write(static_cast<uint64_t>(utilization_[i].load(std::memory_order_relaxed)));
+            }
+            out.write('}');
+        }
+        out.write("]}\n");
+    });
+
+    if(config_.admin_token.empty()) return;
+
+    router_.add(Router::methodBit(HttpRequest::POST), "/_hphs/workers/", Router::PREFIX,
+                [this](const HttpRequest& req, ResponseWriter& out){
+        std::string_view auth = req.getHeader("Authorization");
+        constexpr std::string_view scheme = "Bearer ";
+        if(auth.substr(0, scheme.size()) != scheme ||
+           !tokenEquals(auth.substr(scheme.size()), config_.admin_token)){
+            out.setStatus(401);
+            out.addHeader("WWW-Authenticate", "Bearer");
+            out.setContentType("application/json");
+            out.write("{\"error\":\"unauthorized\"}\n");
+            return;
+        }
+        std::string_view arg = std::string_view(req.path()).substr(sizeof("/_hphs/workers/") - 1);
+        int count = 0;
+        bool valid = !arg.empty() && arg.size() <= 4;
+        for(char c : arg){
+            if(c < '0' || c > '9'){
+                valid = false;
+                break;
+            }
+            count = count * 10 + (c - '0');
+        }
+        out.setContentType("application/json");
+        if(!valid || !setWorkerCount(count)){
+            out.setStatus(400);
+            out.write("{\"error\":\"worker count must be between ");
+            out.write(static_cast<uint64_t>(min_workers_));
+            out.write(" and ");
+            out.write(static_cast<uint64_t>(max_workers_));
+            out.write("\"}\n");
+            return;
+        }
+        // 异步执行：退役要等连接迁完，进度看 GET /_hphs/workers
+        out.setStatus(202);
+        out.write("{\"target\":");
+        out.write(static_cast<uint64_t>(count));
+        out.write(",\"active\":");
+        out.write(static_cast<uint64_t>(activeWorkers()));
+        out.write("}\n");
+    });
 }
 
 void HttpServer::stop(){
@@ -33,7 +677,31 @@ void HttpServer::stop(){
     for(auto& worker : workers_){
         worker->stop();
     }
+    // 控制线程可能正等着某个 Worker 退役完成，先停 Worker 再等它；
+    // 它在停止前刚启动的 Worker 由第二遍 stop 停下
+    if(scaler_.joinable()){
+        {
+            std::lock_guard<std::mutex> lock(scale_mutex_);
+        }
+        scale_cv_.notify_one();
+        scaler_.join();
+        for(auto& worker : workers_){
+            worker->stop();
+        }
+    }
     for(auto& worker :workers_){
         worker->join();
     }
+    // Worker 停止后再停 IO 线程，未处理的完成由各 Worker 的完成队列析构时回收
+    if(io_pool_){
+        io_pool_->shutdown();
+    }
+    if(access_log_){
+        access_log_->stop();
+    }
+    for(const auto& listener : shared_listeners_){
+        close(listener.first);
+        unlink(listener.second.c_str());
+    }
+    shared_listeners_.clear();
 }
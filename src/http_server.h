@@ -3,9 +3,15 @@
 
 #include "server_config.h"
 #include "response_cache.h"
+#include "router.h"
 #include "worker.h"
+#include "io_pool.h"
+#include "access_log.h"
 #include <vector>
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 class HttpServer {
 public:
@@ -13,11 +19,54 @@ public:
     void start();
     void stop();
 
+    // 路由注册需在 start() 之前完成，start() 时编译为静态路由表
+    Router& router() { return router_; }
+
+    // 控制面入口：经各 Worker 的邮箱在其线程上执行，不与数据面争锁
+    void broadcast(const std::function<void(Worker&)>& fn);
+    void publishCacheGeneration(uint64_t generation);
+
+    // WebSocket 端点，需在 start() 之前注册，返回端点编号；handler 为空时只向客户端推送
+    uint32_t addWebSocket(const std::string& path, WebSocketHandler handler = nullptr){
+        return router_.addWebSocket(path, std::move(handler));
+    }
+    // 向端点的全部订阅连接推送一条消息（任意线程调用）：帧只编码一次，各 Worker 共享
+    // 端点不存在时返回 false
+    bool broadcastWebSocket(const std::string& path, std::string_view payload, bool binary = false);
+    void publishWebSocket(uint32_t channel, websocket::Frame frame);
+
+    // 弹性 Worker（--max-workers）：请求把在线 Worker 调整到 count 个（任意线程调用），
+    // 由控制线程逐个启动或退役；未开启或超出 [min_workers, max_workers] 时返回 false
+    bool setWorkerCount(int count);
+    int activeWorkers() const { return active_workers_.load(std::memory_order_relaxed); }
+
 private:
+    void registerBuiltinRoutes();
+    void registerWorkerRoutes();
+    void openSharedListeners();
+    void runScaler();
+    bool addWorker();
+    bool retireWorker();
+    void publishRateShare(int active);
+
     ServerConfig config_;
     ResponseCache cache_;                              // 静态文件缓存
+    Router router_;                                    // 动态路由
+    std::unique_ptr<IoPool> io_pool_;                  // 阻塞文件 IO 线程池，需比 Worker 活得久
+    std::unique_ptr<AccessLogger> access_log_;         // 访问日志，Worker 停止后再停止
     std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::pair<int, std::string>> shared_listeners_;  // 共享的 UNIX 监听套接字 fd 与路径
     std::atomic<bool> running_{false};
+
+    // 弹性 Worker：workers_ 按上限一次创建，只有前 active_workers_ 个左右处于运行状态
+    int max_workers_ = 0;                              // 0 表示未开启，Worker 数固定
+    int min_workers_ = 1;
+    std::atomic<int> active_workers_{0};
+    std::atomic<int> scale_target_{0};                 // 管理命令请求的 Worker 数，0 表示没有
+    std::unique_ptr<std::atomic<uint32_t>[]> utilization_;  // 各 Worker 最近一个周期的 CPU 利用率（千分比）
+    std::thread scaler_;
+    std::mutex scale_mutex_;
+    std::condition_variable scale_cv_;
 };
 
 #endif
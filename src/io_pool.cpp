@@ -0,0 +1,105 @@
+#include "io_pool.h"
+#include "mailbox.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+IoPool::IoPool(size_t threads) {
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back(&IoPool::run, this);
+    }
+}
+
+IoPool::~IoPool() {
+    shutdown();
+}
+
+void IoPool::submit(IoTask* task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task->next = nullptr;
+        if (tail_) tail_->next = task;
+        else head_ = task;
+        tail_ = task;
+    }
+    cv_.notify_one();
+}
+
+void IoPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ && threads_.empty()) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : threads_) {
+        if (t.joinable()) t.join();
+    }
+    threads_.clear();
+
+    while (IoTask* task = head_) {
+        head_ = task->next;
+        delete task;
+    }
+    tail_ = nullptr;
+}
+
+void IoPool::run() {
+    while (true) {
+        IoTask* task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || head_ != nullptr; });
+            if (stopping_) return;
+            task = head_;
+            head_ = task->next;
+            if (!head_) tail_ = nullptr;
+        }
+        execute(*task);
+
+        WorkerMessage* msg = new WorkerMessage;
+        msg->type = WorkerMessage::IO_COMPLETE;
+        msg->io_task = task;
+        task->completion->push(msg);
+    }
+}
+
+void IoPool::execute(IoTask& task) {
+    struct stat st;
+    if (stat(task.path.c_str(), &st) < 0) {
+        task.error = errno;
+        return;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        task.error = ENOENT;
+        return;
+    }
+    task.size = st.st_size;
+    bool fill = task.fill_limit > 0 && static_cast<size_t>(st.st_size) <= task.fill_limit;
+    if (fill) task.kind = IoTask::READ_FILE;
+
+    int fd = open(task.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        task.error = errno;
+        return;
+    }
+
+    if (task.kind == IoTask::STAT_OPEN) {
+        task.fd = fd;
+        return;
+    }
+
+    task.data.resize(task.size);
+    size_t done = 0;
+    while (done < task.data.size()) {
+        ssize_t n = read(fd, &task.data[done], task.data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += n;
+    }
+    task.data.resize(done);
+    task.filled = fill && done == static_cast<size_t>(st.st_size);   // 读取不完整的不缓存
+    close(fd);
+}
@@ -0,0 +1,74 @@
+#ifndef IO_POOL_H
+#define IO_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+class Connection;
+class Mailbox;
+
+// 阻塞文件操作任务：在 IO 线程上执行 stat/open/read，完成后经邮箱回投给发起的 Worker。
+// 任务对象由 Worker 池化复用，path 预留 PATH_MAX，未命中和 404 路径上不再分配
+struct IoTask {
+    enum Kind {
+        STAT_OPEN,   // stat + open，结果 fd 交给 sendfile
+        READ_FILE    // stat + 读取整个文件
+    };
+
+    Kind kind = STAT_OPEN;
+    std::string path;              // 文件完整路径
+    size_t fill_limit = 0;         // 非 0 时不超过该大小的文件读入 data（按需缓存），kind 改为 READ_FILE
+    std::string url_path;          // 按需缓存的请求路径
+
+    // 执行结果
+    int error = 0;                 // errno，0 表示成功
+    off_t size = 0;
+    int fd = -1;                   // STAT_OPEN 打开的文件，未被接管时由 Worker 关闭
+    std::string data;              // READ_FILE 读到的内容
+    bool filled = false;           // data 是为按需缓存读入的完整文件
+
+    // 回投目标：连接可能在等待期间被关闭复用，用 generation 校验
+    Connection* conn = nullptr;
+    uint32_t generation = 0;
+    Mailbox* completion = nullptr;        // 发起 Worker 的邮箱
+
+    IoTask* next = nullptr;               // IoPool 队列的侵入式链接
+};
+
+// 阻塞 IO 线程池（所有 Worker 共享）
+class IoPool {
+public:
+    explicit IoPool(size_t threads);
+    ~IoPool();
+
+    IoPool(const IoPool&) = delete;
+    IoPool& operator=(const IoPool&) = delete;
+
+    void submit(IoTask* task);
+
+    /**
+     * 停止并回收线程，未执行的任务直接丢弃
+     */
+    void shutdown();
+
+    size_t threadCount() const { return threads_.size(); }
+
+private:
+    void run();
+    static void execute(IoTask& task);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    // 侵入式 FIFO：入队不分配
+    IoTask* head_ = nullptr;
+    IoTask* tail_ = nullptr;
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+};
+
+#endif
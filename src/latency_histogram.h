@@ -0,0 +1,110 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+// 单调时钟纳秒（vDSO，TSC 时钟源下约 20ns，不陷入内核）
+inline uint64_t monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// 对数线性直方图（HDR 风格）：每个 2 的幂区间再等分 16 份，相对误差不超过 1/16
+// 单写者（所属 Worker）多读者：计数用 relaxed 原子读改写，读取端随时取快照合并
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr uint64_t SUB_COUNT = 1ull << SUB_BITS;
+    static constexpr int MAX_EXP = 44;     // 超过 2^44（纳秒约 4.9 小时）的值记入最后一个桶
+    static constexpr size_t BUCKETS = (MAX_EXP - SUB_BITS + 1) * SUB_COUNT;
+
+    void record(uint64_t value) {
+        bump(counts_[bucketOf(value)], 1);
+        bump(count_, 1);
+        bump(sum_, value);
+        if (value > max_.load(std::memory_order_relaxed)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    static size_t bucketOf(uint64_t value) {
+        if (value < SUB_COUNT) return static_cast<size_t>(value);
+        int exp = 63 - __builtin_clzll(value);
+        if (exp >= MAX_EXP) return BUCKETS - 1;
+        return (exp - SUB_BITS + 1) * SUB_COUNT +
+               ((value >> (exp - SUB_BITS)) & (SUB_COUNT - 1));
+    }
+
+    // 桶内的最大值，分位数按它报告（不会低估尾延迟）
+    static uint64_t bucketUpper(size_t index) {
+        if (index < SUB_COUNT) return index;
+        int exp = static_cast<int>(index / SUB_COUNT) + SUB_BITS - 1;
+        uint64_t sub = index % SUB_COUNT;
+        int shift = exp - SUB_BITS;
+        return ((SUB_COUNT + sub + 1) << shift) - 1;
+    }
+
+    // 多个 Worker 的直方图合并后的只读快照
+    struct Snapshot {
+        uint64_t counts[BUCKETS] = {};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+
+        void merge(const LatencyHistogram& h) {
+            for (size_t i = 0; i < BUCKETS; ++i) {
+                counts[i] += h.counts_[i].load(std::memory_order_relaxed);
+            }
+            count += h.count_.load(std::memory_order_relaxed);
+            sum += h.sum_.load(std::memory_order_relaxed);
+            uint64_t m = h.max_.load(std::memory_order_relaxed);
+            if (m > max) max = m;
+        }
+
+        uint64_t mean() const { return count ? sum / count : 0; }
+
+        // q 取 0~1；桶计数与 count 不是同一时刻读取的，以桶计数之和为准
+        uint64_t percentile(double q) const {
+            uint64_t total = 0;
+            for (size_t i = 0; i < BUCKETS; ++i) total += counts[i];
+            if (total == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(q * total);
+            if (rank >= total) rank = total - 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < BUCKETS; ++i) {
+                seen += counts[i];
+                if (seen > rank) {
+                    uint64_t upper = bucketUpper(i);
+                    return upper < max ? upper : max;
+                }
+            }
+            return max;
+        }
+    };
+
+private:
+    static void bump(std::atomic<uint64_t>& a, uint64_t n) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> counts_[BUCKETS] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// 每个 Worker 的分阶段延迟统计（纳秒），时间起点为读到请求首字节的那次 epoll 唤醒
+struct LatencyStats {
+    LatencyHistogram parse;             // 唤醒 -> 请求头解析完成（含同批事件排队）
+    LatencyHistogram first_byte;        // 唤醒 -> 响应首次写出
+    LatencyHistogram complete;          // 唤醒 -> 响应全部写完
+    LatencyHistogram first_request;     // accept -> 连接上第一个请求解析完成
+    LatencyHistogram lifetime;          // 连接存活时间
+    LatencyHistogram requests_per_conn; // 每个连接处理的请求数（非时间）
+};
+
+#endif
@@ -0,0 +1,283 @@
+#include "lazy_cache.h"
+#include "response_cache.h"
+
+#include <algorithm>
+#include <functional>
+
+struct LazyCache::Node {
+    CacheEntry entry;               // response 指向 data
+    std::string key;
+    uint64_t hash = 0;
+    std::string data;
+    size_t charge = 0;              // 计入预算的字节（响应 + key + 节点本身）
+    std::atomic<uint8_t> freq{0};   // S3-FIFO 访问计数，命中时饱和递增
+    bool in_main = false;
+};
+
+namespace {
+
+size_t roundUpPow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+}  // namespace
+
+LazyCache::Table::Table(size_t capacity)
+    : mask(capacity - 1), slots(new std::atomic<Node*>[capacity]()) {}
+
+// 条目数上限按平均 2KB 估算，很多小文件时先触及条目上限；表容量为上限的两倍
+LazyCache::LazyCache(size_t budget, size_t workers)
+    : budget_(budget),
+      small_budget_(budget / 10),
+      max_entries_(std::max<size_t>(256, budget / 2048)),
+      max_entry_size_(std::min<size_t>(1024 * 1024, budget / 8)),
+      table_(new Table(roundUpPow2(max_entries_ * 2))),
+      sketch_(max_entries_),
+      seen_(new SeenEpoch[workers]),
+      workers_(workers) {}
+
+LazyCache::~LazyCache() {
+    for (Node* node : small_) delete node;
+    for (Node* node : main_) delete node;
+    for (auto& r : retired_nodes_) delete r.second;
+    for (auto& r : retired_tables_) delete r.second;
+    delete table_.load();
+}
+
+uint64_t LazyCache::hashKey(std::string_view key) {
+    return std::hash<std::string_view>()(key);
+}
+
+LazyCache::Node* LazyCache::lookup(const Table& table, std::string_view key,
+                                   uint64_t hash) const {
+    size_t i = hash & table.mask;
+    for (size_t probes = 0; probes <= table.mask; ++probes, i = (i + 1) & table.mask) {
+        Node* node = table.slots[i].load(std::memory_order_acquire);
+        if (!node) return nullptr;
+        if (node != tombstone() && node->hash == hash && node->key == key) return node;
+    }
+    return nullptr;
+}
+
+const CacheEntry* LazyCache::find(std::string_view key, uint64_t hash) {
+    sketch_.increment(hash);
+    Node* node = lookup(*table_.load(std::memory_order_acquire), key, hash);
+    if (!node) return nullptr;
+    uint8_t freq = node->freq.load(std::memory_order_relaxed);
+    if (freq < MAX_FREQ) node->freq.store(freq + 1, std::memory_order_relaxed);
+    return &node->entry;
+}
+
+const CacheEntry* LazyCache::insert(std::string_view key, uint64_t hash,
+                                    std::string response,
+                                    const std::string& content_type,
+                                    size_t body_size) {
+    size_t charge = response.size() + key.size() + sizeof(Node);
+    if (response.size() > max_entry_size_) return nullptr;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    reclaim();
+
+    // 多个 Worker 同时未命中同一文件时，后到的直接用已插入的条目
+    if (Node* existing = lookup(*table_.load(std::memory_order_relaxed), key, hash)) {
+        return &existing->entry;
+    }
+
+    // TinyLFU：需要淘汰时，新条目的频率必须高于下一个被淘汰者
+    if (used_bytes_ + charge > budget_ || entries_.load(std::memory_order_relaxed) >= max_entries_) {
+        const std::deque<Node*>& queue = small_.empty() ? main_ : small_;
+        if (!queue.empty() &&
+            sketch_.estimate(hash) <= sketch_.estimate(queue.front()->hash)) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            noteVictim();
+            return nullptr;
+        }
+        while (used_bytes_ + charge > budget_ ||
+               entries_.load(std::memory_order_relaxed) >= max_entries_) {
+            if (!evictOne()) break;
+        }
+        if (used_bytes_ + charge > budget_) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            noteVictim();
+            return nullptr;
+        }
+    }
+
+    Node* node = new Node;
+    node->key.assign(key.data(), key.size());
+    node->hash = hash;
+    node->data = std::move(response);
+    node->charge = charge;
+    node->entry.response = node->data;
+    node->entry.content_type = content_type;
+    node->entry.body_size = body_size;
+
+    // 刚从小队列挤出又被请求的 key 直接进主队列
+    node->in_main = takeGhost(hash);
+    if (node->in_main) {
+        main_.push_back(node);
+    } else {
+        small_.push_back(node);
+        small_bytes_ += charge;
+    }
+    used_bytes_ += charge;
+    publish(node);
+
+    resident_bytes_.store(used_bytes_, std::memory_order_relaxed);
+    entries_.store(entries_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    admitted_.fetch_add(1, std::memory_order_relaxed);
+    noteVictim();
+    return &node->entry;
+}
+
+// 剩余空间放不下最大条目（或条目数已满）时视为将满，记录下一个被淘汰者
+void LazyCache::noteVictim() {
+    const std::deque<Node*>& queue = small_.empty() ? main_ : small_;
+    victim_hash_.store(queue.empty() ? 0 : queue.front()->hash, std::memory_order_relaxed);
+    full_.store(used_bytes_ + max_entry_size_ > budget_ ||
+                    entries_.load(std::memory_order_relaxed) >= max_entries_,
+                std::memory_order_relaxed);
+}
+
+// 发布到查找表：复用墓碑或空槽，墓碑过多时先重建
+void LazyCache::publish(Node* node) {
+    Table* table = table_.load(std::memory_order_relaxed);
+    if ((table->used + table->tombstones + 1) * 4 > (table->mask + 1) * 3) {
+        rebuild();
+        table = table_.load(std::memory_order_relaxed);
+    }
+    size_t i = node->hash & table->mask;
+    while (true) {
+        Node* slot = table->slots[i].load(std::memory_order_relaxed);
+        if (!slot || slot == tombstone()) {
+            if (slot == tombstone()) --table->tombstones;
+            table->slots[i].store(node, std::memory_order_release);
+            ++table->used;
+            return;
+        }
+        i = (i + 1) & table->mask;
+    }
+}
+
+void LazyCache::unlink(Node* node) {
+    Table* table = table_.load(std::memory_order_relaxed);
+    size_t i = node->hash & table->mask;
+    while (true) {
+        Node* slot = table->slots[i].load(std::memory_order_relaxed);
+        if (!slot) return;
+        if (slot == node) {
+            table->slots[i].store(tombstone(), std::memory_order_release);
+            --table->used;
+            ++table->tombstones;
+            return;
+        }
+        i = (i + 1) & table->mask;
+    }
+}
+
+// 新表只含有效条目，旧表与节点一样退休，读者可能仍在遍历
+void LazyCache::rebuild() {
+    Table* old = table_.load(std::memory_order_relaxed);
+    Table* fresh = new Table(old->mask + 1);
+    for (size_t i = 0; i <= old->mask; ++i) {
+        Node* node = old->slots[i].load(std::memory_order_relaxed);
+        if (!node || node == tombstone()) continue;
+        size_t j = node->hash & fresh->mask;
+        while (fresh->slots[j].load(std::memory_order_relaxed)) j = (j + 1) & fresh->mask;
+        fresh->slots[j].store(node, std::memory_order_relaxed);
+        ++fresh->used;
+    }
+    table_.store(fresh, std::memory_order_release);
+    retired_tables_.emplace_back(epoch_.fetch_add(1) + 1, old);
+}
+
+// S3-FIFO：小队列超过 10% 预算（或主队列为空）时从小队列淘汰，访问过的晋升到主队列，
+// 未访问的移出并记入幽灵队列；主队列按访问计数给二次机会。返回 false 表示已无可淘汰条目
+bool LazyCache::evictOne() {
+    while (!small_.empty() || !main_.empty()) {
+        if (!small_.empty() && (small_bytes_ > small_budget_ || main_.empty())) {
+            Node* node = small_.front();
+            small_.pop_front();
+            small_bytes_ -= node->charge;
+            if (node->freq.load(std::memory_order_relaxed) > 0) {
+                node->freq.store(0, std::memory_order_relaxed);
+                node->in_main = true;
+                main_.push_back(node);
+                continue;
+            }
+            rememberGhost(node->hash);
+            retire(node);
+            return true;
+        }
+        Node* node = main_.front();
+        main_.pop_front();
+        uint8_t freq = node->freq.load(std::memory_order_relaxed);
+        if (freq > 0) {
+            node->freq.store(freq - 1, std::memory_order_relaxed);
+            main_.push_back(node);
+            continue;
+        }
+        retire(node);
+        return true;
+    }
+    return false;
+}
+
+void LazyCache::retire(Node* node) {
+    unlink(node);
+    used_bytes_ -= node->charge;
+    resident_bytes_.store(used_bytes_, std::memory_order_relaxed);
+    entries_.store(entries_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+    // epoch 递增在摘除之后：看到新 epoch 的 Worker 不可能再从表中拿到该节点
+    retired_nodes_.emplace_back(epoch_.fetch_add(1) + 1, node);
+}
+
+void LazyCache::online(size_t worker) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    seen_[worker].epoch.store(epoch_.load(std::memory_order_acquire),
+                              std::memory_order_release);
+}
+
+// 释放所有在线 Worker 都已越过其退休 epoch 的节点和表
+void LazyCache::reclaim() {
+    if (retired_nodes_.empty() && retired_tables_.empty()) return;
+    uint64_t safe = UINT64_MAX;
+    for (size_t i = 0; i < workers_; ++i) {
+        safe = std::min(safe, seen_[i].epoch.load(std::memory_order_acquire));
+    }
+    auto release = [safe](auto& list) {
+        size_t kept = 0;
+        for (auto& r : list) {
+            if (r.first <= safe) {
+                delete r.second;
+            } else {
+                list[kept++] = r;
+            }
+        }
+        list.resize(kept);
+    };
+    release(retired_nodes_);
+    release(retired_tables_);
+}
+
+void LazyCache::rememberGhost(uint64_t hash) {
+    ghost_.push_back(hash);
+    ++ghost_count_[hash];
+    size_t limit = std::max<size_t>(1024, entries_.load(std::memory_order_relaxed));
+    while (ghost_.size() > limit) {
+        auto it = ghost_count_.find(ghost_.front());
+        if (it != ghost_count_.end() && --it->second == 0) ghost_count_.erase(it);
+        ghost_.pop_front();
+    }
+}
+
+bool LazyCache::takeGhost(uint64_t hash) {
+    auto it = ghost_count_.find(hash);
+    if (it == ghost_count_.end()) return false;
+    // 队列中的旧记录留给老化淘汰，计数清零即视为已消费
+    ghost_count_.erase(it);
+    return true;
+}
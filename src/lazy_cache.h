@@ -0,0 +1,144 @@
+#ifndef LAZY_CACHE_H
+#define LAZY_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "frequency_sketch.h"
+
+struct CacheEntry;
+
+// 有内存上限的响应缓存层（--cache-budget）：未命中时按需读入，所有 Worker 共享
+//
+// - 查找无锁：开放寻址表的槽位是原子指针，插入 / 淘汰在互斥锁内发布
+// - 准入：TinyLFU 频率草图，至少被请求过两次且频率高于将被淘汰者才读入内存
+// - 淘汰：S3-FIFO（小队列过滤一次性访问，主队列按访问位二次机会，幽灵队列记住刚被挤出的 key）
+// - 回收：被淘汰的条目按 epoch 退休，每个 Worker 每轮事件循环报告一次静止点，
+//   所有在线 Worker 都越过退休 epoch 后才释放；Worker 保证条目指针不跨越事件循环迭代
+//   （写不完时把剩余响应拷进连接自己的写缓冲区）
+class LazyCache {
+public:
+    LazyCache(size_t budget, size_t workers);
+    ~LazyCache();
+
+    LazyCache(const LazyCache&) = delete;
+    LazyCache& operator=(const LazyCache&) = delete;
+
+    static uint64_t hashKey(std::string_view key);
+
+    // 任意 Worker 线程调用：查找并记录访问频率，返回的指针只在本轮事件循环内有效
+    const CacheEntry* find(std::string_view key, uint64_t hash);
+
+    // 未命中后判断是否值得读入内存：频率草图至少见过两次，且缓存将满时频率高于下一个被淘汰者
+    // （无锁的近似判断，insert 内仍会复核），避免为注定被拒绝的文件读盘
+    bool wantFill(uint64_t hash) const {
+        uint32_t freq = sketch_.estimate(hash);
+        if (freq < ADMIT_FREQUENCY) return false;
+        uint64_t victim = victim_hash_.load(std::memory_order_relaxed);
+        return !full_.load(std::memory_order_relaxed) || freq > sketch_.estimate(victim);
+    }
+
+    // 插入预构建响应，必要时淘汰；未准入时返回 nullptr，调用方改用自己的缓冲区发送
+    const CacheEntry* insert(std::string_view key, uint64_t hash, std::string response,
+                             const std::string& content_type, size_t body_size);
+
+    // Worker 的静止点：此前从本缓存拿到的指针都已不再使用
+    void quiescent(size_t worker) {
+        uint64_t epoch = epoch_.load(std::memory_order_acquire);
+        std::atomic<uint64_t>& seen = seen_[worker].epoch;
+        if (seen.load(std::memory_order_relaxed) != epoch) {
+            seen.store(epoch, std::memory_order_release);
+        }
+    }
+
+    // Worker 线程启动 / 退出时调用：离线的 Worker 不参与回收判断（未启动的 Worker 默认离线）。
+    // online 在互斥锁内登记当前 epoch，与退休和回收串行，之后拿到的指针都受保护
+    void online(size_t worker);
+    void offline(size_t worker) {
+        seen_[worker].epoch.store(OFFLINE, std::memory_order_release);
+    }
+
+    size_t budget() const { return budget_; }
+    size_t maxEntrySize() const { return max_entry_size_; }
+    size_t residentBytes() const { return resident_bytes_.load(std::memory_order_relaxed); }
+    size_t entries() const { return entries_.load(std::memory_order_relaxed); }
+    uint64_t admitted() const { return admitted_.load(std::memory_order_relaxed); }
+    uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+    uint64_t evictions() const { return evictions_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t ADMIT_FREQUENCY = 2;
+    static constexpr uint8_t MAX_FREQ = 3;
+    static constexpr uint64_t OFFLINE = UINT64_MAX;
+
+    struct Node;
+    // 已删除槽位的占位，查找时跳过、插入时可复用
+    static Node* tombstone() { return reinterpret_cast<Node*>(uintptr_t(1)); }
+
+    struct Table {
+        explicit Table(size_t capacity);
+        size_t mask;
+        size_t used = 0;          // 有效条目
+        size_t tombstones = 0;    // 已删除的槽位，查找时需跨过
+        std::unique_ptr<std::atomic<Node*>[]> slots;
+    };
+
+    // 每个 Worker 一个缓存行，避免静止点写入互相干扰
+    struct alignas(64) SeenEpoch {
+        std::atomic<uint64_t> epoch{OFFLINE};
+    };
+
+    Node* lookup(const Table& table, std::string_view key, uint64_t hash) const;
+    void publish(Node* node);
+    void unlink(Node* node);
+    void rebuild();
+    bool evictOne();
+    void retire(Node* node);
+    void reclaim();
+    void rememberGhost(uint64_t hash);
+    bool takeGhost(uint64_t hash);
+    void noteVictim();
+
+    const size_t budget_;
+    const size_t small_budget_;       // S3-FIFO 小队列占预算的 10%
+    const size_t max_entries_;
+    const size_t max_entry_size_;
+
+    std::atomic<Table*> table_;
+    FrequencySketch sketch_;
+
+    // 以下只在 mutex_ 内访问
+    std::mutex mutex_;
+    std::deque<Node*> small_;
+    std::deque<Node*> main_;
+    size_t small_bytes_ = 0;
+    size_t used_bytes_ = 0;
+    std::deque<uint64_t> ghost_;
+    std::unordered_map<uint64_t, uint32_t> ghost_count_;
+    std::vector<std::pair<uint64_t, Node*>> retired_nodes_;
+    std::vector<std::pair<uint64_t, Table*>> retired_tables_;
+
+    std::atomic<uint64_t> epoch_{1};
+    std::unique_ptr<SeenEpoch[]> seen_;
+    size_t workers_;
+
+    // wantFill 的无锁快照，每次 insert 后更新
+    std::atomic<bool> full_{false};
+    std::atomic<uint64_t> victim_hash_{0};
+
+    std::atomic<size_t> resident_bytes_{0};
+    std::atomic<size_t> entries_{0};
+    std::atomic<uint64_t> admitted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include "listen_endpoint.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <charconv>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static bool parsePort(std::string_view s, int& port) {
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), port);
+    return ec == std::errc() && ptr == s.data() + s.size() && port > 0 && port < 65536;
+}
+
+bool ListenEndpoint::parse(std::string_view spec, ListenEndpoint& out) {
+    out = ListenEndpoint{};
+    if (spec.substr(0, 5) == "unix:") {
+        out.kind = UNIX;
+        out.path = std::string(spec.substr(5));
+        // sun_path 上限 108 字节，{worker} 展开后最多多出几位
+        return !out.path.empty() && out.path.size() < sizeof(sockaddr_un::sun_path) - 8;
+    }
+
+    if (!spec.empty() && spec[0] == '[') {
+        size_t close = spec.find(']');
+        if (close == std::string_view::npos || close + 1 >= spec.size() ||
+            spec[close + 1] != ':')
+            return false;
+        out.kind = TCP6;
+        out.host = std::string(spec.substr(1, close - 1));
+        in6_addr addr;
+        return inet_pton(AF_INET6, out.host.c_str(), &addr) == 1 &&
+               parsePort(spec.substr(close + 2), out.port);
+    }
+
+    size_t colon = spec.rfind(':');
+    if (colon != std::string_view::npos) {
+        out.host = std::string(spec.substr(0, colon));
+        in_addr addr;
+        if (inet_pton(AF_INET, out.host.c_str(), &addr) != 1) return false;
+        spec = spec.substr(colon + 1);
+    }
+    return parsePort(spec, out.port);
+}
+
+std::string ListenEndpoint::unixPath(int worker) const {
+    std::string result = path;
+    size_t pos = result.find("{worker}");
+    if (pos != std::string::npos) result.replace(pos, 8, std::to_string(worker));
+    return result;
+}
+
+std::string ListenEndpoint::describe() const {
+    switch (kind) {
+    case TCP6: return "[" + (host.empty() ? std::string("::") : host) + "]:" + std::to_string(port);
+    case UNIX: return "unix:" + path;
+    default: return (host.empty() ? std::string("0.0.0.0") : host) + ":" + std::to_string(port);
+    }
+}
+
+int openListenSocket(const ListenEndpoint& endpoint, int worker_id) {
+    int family = endpoint.kind == ListenEndpoint::TCP4   ? AF_INET
+                 : endpoint.kind == ListenEndpoint::TCP6 ? AF_INET6
+                                                         : AF_UNIX;
+    int sockfd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sockfd < 0)
+        return -1;
+
+    int opt = 1;
+    sockaddr_storage storage{};
+    socklen_t addr_len = 0;
+
+    if (endpoint.kind == ListenEndpoint::UNIX) {
+        auto* addr = reinterpret_cast<sockaddr_un*>(&storage);
+        std::string path = endpoint.unixPath(worker_id);
+        addr->sun_family = AF_UNIX;
+        path.copy(addr->sun_path, sizeof(addr->sun_path) - 1);
+        addr_len = sizeof(sockaddr_un);
+        unlink(path.c_str());  // 上次运行残留的套接字文件
+    } else {
+        setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+        if (endpoint.kind == ListenEndpoint::TCP6) {
+            setsockopt(sockfd, IPPROTO_IPV6, IPV6_V6ONLY, &opt, sizeof(opt));
+            auto* addr = reinterpret_cast<sockaddr_in6*>(&storage);
+            addr->sin6_family = AF_INET6;
+            addr->sin6_addr = in6addr_any;
+            if (!endpoint.host.empty())
+                inet_pton(AF_INET6, endpoint.host.c_str(), &addr->sin6_addr);
+            addr->sin6_port = htons(endpoint.port);
+            addr_len = sizeof(sockaddr_in6);
+        } else {
+            auto* addr = reinterpret_cast<sockaddr_in*>(&storage);
+            addr->sin_family = AF_INET;
+            addr->sin_addr.s_addr = INADDR_ANY;
+            if (!endpoint.host.empty())
+                inet_pton(AF_INET, endpoint.host.c_str(), &addr->sin_addr);
+            addr->sin_port = htons(endpoint.port);
+            addr_len = sizeof(sockaddr_in);
+        }
+    }
+
+    if (bind(sockfd, reinterpret_cast<sockaddr*>(&storage), addr_len) < 0 ||
+        listen(sockfd, SOMAXCONN) < 0) {
+        int saved = errno;
+        close(sockfd);
+        errno = saved;
+        return -1;
+    }
+    return sockfd;
+}
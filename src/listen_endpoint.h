@@ -0,0 +1,39 @@
+#ifndef LISTEN_ENDPOINT_H
+#define LISTEN_ENDPOINT_H
+
+#include <string>
+#include <string_view>
+
+// 监听端点
+//   "8080" / "0.0.0.0:8080"     IPv4
+//   "[::]:8080" / "[::1]:8080"  IPv6（IPV6_V6ONLY，可与同端口的 IPv4 并存）
+//   "unix:/run/hphs.sock"       所有 Worker 共享一个 AF_UNIX 套接字
+//   "unix:/run/hphs-{worker}.sock"  每个 Worker 一个套接字文件（类似 SO_REUSEPORT 的分布）
+struct ListenEndpoint {
+    enum Kind { TCP4, TCP6, UNIX };
+
+    Kind kind = TCP4;
+    std::string host;       // 数字地址，为空表示任意地址
+    int port = 0;
+    std::string path;       // UNIX 套接字路径，可含 {worker}
+
+    bool tcp() const { return kind != UNIX; }
+
+    // TCP 端点各 Worker 用 SO_REUSEPORT 各自绑定；不含 {worker} 的 UNIX 端点只能绑定一次，由 HttpServer 创建后共享
+    bool perWorker() const {
+        return kind != UNIX || path.find("{worker}") != std::string::npos;
+    }
+
+    std::string unixPath(int worker) const;
+    std::string describe() const;
+
+    static bool parse(std::string_view spec, ListenEndpoint& out);
+};
+
+/**
+ * 创建非阻塞监听套接字：TCP 开启 SO_REUSEADDR/SO_REUSEPORT，UNIX 先删除残留的套接字文件
+ * @return fd，失败返回 -1（errno 保留）
+ */
+int openListenSocket(const ListenEndpoint& endpoint, int worker_id);
+
+#endif
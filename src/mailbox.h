@@ -0,0 +1,133 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+class Worker;
+struct IoTask;
+
+// Worker 间传递的消息
+struct WorkerMessage {
+    enum Type {
+        CLOSURE,            // 在目标 Worker 线程上执行任意函数
+        CONNECTION,         // 连接转交：fd + 已读取未处理的数据
+        CACHE_GENERATION,   // 缓存代数变化
+        IO_COMPLETE,        // 阻塞 IO 任务完成
+        WEBSOCKET_FRAME     // 向本 Worker 上某个 WebSocket 端点的全部订阅连接发送编码好的帧
+    };
+
+    Type type = CLOSURE;
+    std::function<void(Worker&)> closure;
+    int fd = -1;
+    std::string buffered;
+    uint64_t generation = 0;
+    IoTask* io_task = nullptr;
+    std::shared_ptr<const std::string> frame;   // 各 Worker 共享同一份帧
+    uint32_t channel = 0;
+
+    std::atomic<WorkerMessage*> next{nullptr};  // 侵入式队列指针
+};
+
+// 多生产者单消费者无锁邮箱（Vyukov 侵入式 MPSC 队列）+ eventfd 唤醒
+//
+// 生产者 push 只有一次 exchange 和一次 store，不加锁；
+// notified_ 保证消费者处理前的一批消息只写一次 eventfd。
+class Mailbox {
+public:
+    Mailbox() : head_(&stub_), tail_(&stub_) {
+        event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+
+    ~Mailbox() {
+        while (WorkerMessage* msg = pop()) delete msg;
+        if (event_fd_ >= 0) close(event_fd_);
+    }
+
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+
+    int eventFd() const { return event_fd_; }
+
+    // 是否有尚未 drain 的唤醒，供不经过 epoll 的调用方（内存传输层）检查
+    bool notified() const { return notified_.load(std::memory_order_acquire); }
+
+    // 任意线程调用，邮箱接管 msg 的所有权
+    void push(WorkerMessage* msg) {
+        msg->next.store(nullptr, std::memory_order_relaxed);
+        WorkerMessage* prev = head_.exchange(msg, std::memory_order_acq_rel);
+        prev->next.store(msg, std::memory_order_release);
+
+        // 消费者清除标记之前的后续消息不再写 eventfd
+        if (!notified_.exchange(true, std::memory_order_seq_cst)) {
+            uint64_t one = 1;
+            ssize_t n = write(event_fd_, &one, sizeof(one));
+            (void)n;
+        }
+    }
+
+    // 消费者（所属 Worker 线程）调用：先清除唤醒标记再取空队列，
+    // 清除之后到达的消息一定会重新写 eventfd
+    template <typename Fn>
+    size_t drain(Fn&& fn) {
+        uint64_t value;
+        ssize_t n = read(event_fd_, &value, sizeof(value));
+        (void)n;
+        // 用 exchange 而不是 store：读到生产者写入的 true，与其 push 建立同步
+        notified_.exchange(false, std::memory_order_seq_cst);
+
+        size_t count = 0;
+        while (WorkerMessage* msg = pop()) {
+            fn(msg);
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    // 单消费者出队，返回的消息由调用方负责释放
+    WorkerMessage* pop() {
+        WorkerMessage* tail = tail_;
+        WorkerMessage* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (!next) return nullptr;
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail_ = next;
+            return tail;
+        }
+        // 队列中只剩最后一个节点：放回 stub 后才能取出它
+        if (tail != head_.load(std::memory_order_acquire)) {
+            return nullptr;  // 有生产者正在入队，下次再取
+        }
+        push_stub();
+        next = tail->next.load(std::memory_order_acquire);
+        if (next) {
+            tail_ = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+    void push_stub() {
+        stub_.next.store(nullptr, std::memory_order_relaxed);
+        WorkerMessage* prev = head_.exchange(&stub_, std::memory_order_acq_rel);
+        prev->next.store(&stub_, std::memory_order_release);
+    }
+
+    WorkerMessage stub_;
+    alignas(64) std::atomic<WorkerMessage*> head_;   // 生产者端
+    alignas(64) WorkerMessage* tail_;                // 消费者端
+    alignas(64) std::atomic<bool> notified_{false};
+    int event_fd_ = -1;
+};
+
+#endif
@@ -2,16 +2,105 @@
 #include <iostream>
 #include <csignal>
 #include <memory>
+#include <string_view>
 #include "server_config.h"
 
+// 可选参数：--key=value
+static bool applyOption(ServerConfig& config, std::string_view arg){
+    size_t eq = arg.find('=');
+    if(arg.substr(0, 2) != "--" || eq == std::string_view::npos) return false;
+
+    std::string_view key = arg.substr(2, eq - 2);
+    std::string value(arg.substr(eq + 1));
+
+    if(key == "upload-root") config.upload_root = value;
+    else if(key == "max-header-size") config.max_header_size = std::stoull(value);
+    else if(key == "max-body-size") config.max_body_size = std::stoull(value);
+    else if(key == "io-threads") config.io_threads = std::stoi(value);
+    else if(key == "access-log") config.access_log = value;
+    else if(key == "access-log-sample") config.access_log_sample = std::stoul(value);
+    else if(key == "access-log-ring") config.access_log_ring = std::stoull(value);
+    else if(key == "latency-stats") config.latency_stats = value != "0";
+    else if(key == "busy-poll") config.busy_poll_us = std::stoul(value);
+    else if(key == "cache-ignore-query"){
+        // 逗号分隔的参数名，空值表示带 query 的请求都不查缓存
+        config.cache_ignore_query.clear();
+        size_t start = 0;
+        while(start < value.size()){
+            size_t comma = value.find(',', start);
+            if(comma == std::string::npos) comma = value.size();
+            if(comma > start) config.cache_ignore_query.push_back(value.substr(start, comma - start));
+            start = comma + 1;
+        }
+    }
+    else if(key == "defer-accept") config.defer_accept_s = std::stoi(value);
+    else if(key == "fastopen") config.fastopen_queue = std::stoi(value);
+    else if(key == "listen"){
+        ListenEndpoint endpoint;
+        if(!ListenEndpoint::parse(value, endpoint)) return false;
+        config.listen.push_back(std::move(endpoint));
+    }
+    else if(key == "zerocopy") config.zerocopy_threshold = std::stoull(value);
+    else if(key == "rebalance") config.rebalance_ms = std::stoul(value);
+    else if(key == "max-workers") config.max_workers = std::stoi(value);
+    else if(key == "min-workers") config.min_workers = std::stoi(value);
+    else if(key == "autoscale") config.autoscale_ms = std::stoul(value);
+    else if(key == "scale-up") config.scale_up_util = std::stoul(value);
+    else if(key == "scale-down") config.scale_down_util = std::stoul(value);
+    else if(key == "admin-token") config.admin_token = value;
+    else if(key == "drain-timeout") config.drain_timeout_ms = std::stoul(value);
+    else if(key == "epoll-once") config.epoll_register_once = value != "0";
+    else if(key == "cache-snapshot") config.cache_snapshot = value;
+    else if(key == "cache-budget") config.cache_budget = std::stoull(value);
+    else if(key == "raw-cache") config.raw_request_cache = std::stoull(value);
+    else if(key == "ip-conn-rate") config.ip_conn_rate = std::stoul(value);
+    else if(key == "ip-req-rate") config.ip_request_rate = std::stoul(value);
+    else if(key == "subnet-conn-rate") config.subnet_conn_rate = std::stoul(value);
+    else if(key == "subnet-req-rate") config.subnet_request_rate = std::stoul(value);
+    else if(key == "rate-burst-ms") config.rate_limit_burst_ms = std::stoul(value);
+    else if(key == "rate-limit-table") config.rate_limit_table = std::stoull(value);
+    else if(key == "rate-limit-close") config.rate_limit_close = value != "0";
+    else if(key == "websocket") config.websocket_paths.push_back(value);
+    else if(key == "ws-queue-limit") config.websocket_queue_limit = std::stoull(value);
+    else if(key == "ws-slow"){
+        if(value != "drop" && value != "close") return false;
+        config.websocket_drop_slow = value == "drop";
+    }
+#if HPHS_COROUTINES
+    else if(key == "coroutines") config.coroutines = value != "0";
+#endif
+    else return false;
+    return true;
+}
 
 int main(int argc, char* argv[]){
     signal(SIGPIPE, SIG_IGN);
 
     ServerConfig config;
-    if(argc >= 2) config.port = std::atoi(argv[1]);
-    if(argc >= 3) config.worker_count = std::atoi(argv[2]);
-    if(argc >= 4) config.www_root = argv[3];
+    int positional = 0;
+    for(int i = 1; i < argc; ++i){
+        std::string_view arg = argv[i];
+        if(arg.substr(0, 2) == "--"){
+            bool ok = false;
+            try {
+                ok = applyOption(config, arg);
+            } catch(const std::exception&) {
+                ok = false;
+            }
+            if(!ok){
+                std::cerr << "Invalid option: " << arg << std::endl;
+                return 1;
+            }
+            continue;
+        }
+        // 位置参数：[port] [workers] [www_root]
+        switch(positional++){
+            case 0: config.port = std::atoi(argv[i]); break;
+            case 1: config.worker_count = std::atoi(argv[i]); break;
+            case 2: config.www_root = argv[i]; break;
+            default: break;
+        }
+    }
 
     HttpServer server(config);
     server.start();
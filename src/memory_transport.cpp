@@ -0,0 +1,188 @@
+#include "memory_transport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+int MemoryTransport::open(size_t segment) {
+    conns_.emplace_back();
+    conns_.back().segment = segment;
+    return FD_BASE + static_cast<int>(conns_.size() - 1);
+}
+
+void MemoryTransport::feed(int fd, std::string_view data) {
+    Conn& c = conn(fd);
+    if (c.closed || data.empty()) return;
+    c.input.append(data.data(), data.size());
+    signal(fd, EPOLLIN);
+}
+
+void MemoryTransport::shutdown(int fd) {
+    Conn& c = conn(fd);
+    if (c.closed) return;
+    c.eof = true;
+    signal(fd, EPOLLIN | EPOLLRDHUP);
+}
+
+std::string MemoryTransport::takeOutput(int fd) {
+    std::string out;
+    out.swap(conn(fd).output);
+    return out;
+}
+
+// 已注册且订阅了该事件时记下边沿，等 epollWait 报告
+void MemoryTransport::signal(int fd, uint32_t events) {
+    Conn& c = conn(fd);
+    if (!c.registered) return;
+    uint32_t edge = events & (c.events | EPOLLRDHUP);
+    if ((c.events & EPOLLRDHUP) == 0) edge &= ~static_cast<uint32_t>(EPOLLRDHUP);
+    if (edge == 0) return;
+    c.pending |= edge;
+    if (!c.queued) {
+        c.queued = true;
+        ready_.push_back(fd);
+    }
+}
+
+void MemoryTransport::append(Conn& c, const char* data, size_t len) {
+    if (capture_) c.output.append(data, len);
+    bytes_out_ += len;
+}
+
+int MemoryTransport::accept(int, sockaddr*, socklen_t*, int) {
+    errno = EAGAIN;
+    return -1;
+}
+
+ssize_t MemoryTransport::read(int fd, void* buf, size_t len) {
+    if (!owns(fd) || conn(fd).closed) {
+        errno = EBADF;
+        return -1;
+    }
+    Conn& c = conn(fd);
+    ++reads_;
+    size_t available = c.input.size() - c.read_pos;
+    if (available == 0) {
+        if (c.eof) return 0;
+        errno = EAGAIN;
+        return -1;
+    }
+    size_t n = std::min(len, available);
+    if (c.segment > 0) n = std::min(n, c.segment);
+    memcpy(buf, c.input.data() + c.read_pos, n);
+    c.read_pos += n;
+    if (c.read_pos == c.input.size()) {
+        c.input.clear();
+        c.read_pos = 0;
+    }
+    bytes_in_ += n;
+    return static_cast<ssize_t>(n);
+}
+
+ssize_t MemoryTransport::write(int fd, const void* buf, size_t len) {
+    if (!owns(fd) || conn(fd).closed) {
+        errno = EBADF;
+        return -1;
+    }
+    ++writes_;
+    append(conn(fd), static_cast<const char*>(buf), len);
+    return static_cast<ssize_t>(len);
+}
+
+ssize_t MemoryTransport::writev(int fd, const iovec* iov, int iovcnt) {
+    if (!owns(fd) || conn(fd).closed) {
+        errno = EBADF;
+        return -1;
+    }
+    ++writes_;
+    Conn& c = conn(fd);
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        append(c, static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+        total += iov[i].iov_len;
+    }
+    return static_cast<ssize_t>(total);
+}
+
+// 源文件是真实 fd，用 pread 读出后当作写出的数据
+ssize_t MemoryTransport::sendfile(int out_fd, int in_fd, off_t* offset, size_t count) {
+    if (!owns(out_fd) || conn(out_fd).closed) {
+        errno = EBADF;
+        return -1;
+    }
+    ++writes_;
+    Conn& c = conn(out_fd);
+    char buf[65536];
+    size_t total = 0;
+    while (total < count) {
+        ssize_t n = pread(in_fd, buf, std::min(sizeof(buf), count - total), *offset);
+        if (n < 0) {
+            if (total > 0) break;
+            return -1;
+        }
+        if (n == 0) break;
+        append(c, buf, static_cast<size_t>(n));
+        *offset += n;
+        total += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(total);
+}
+
+int MemoryTransport::close(int fd) {
+    if (!owns(fd)) return ::close(fd);
+    Conn& c = conn(fd);
+    if (c.closed) {
+        errno = EBADF;
+        return -1;
+    }
+    c.closed = true;
+    c.registered = false;
+    c.pending = 0;
+    c.input.clear();
+    c.read_pos = 0;
+    return 0;
+}
+
+int MemoryTransport::epollCtl(int, int op, int fd, epoll_event* event) {
+    if (!owns(fd) || conn(fd).closed) {
+        // 监听套接字和邮箱不在内存传输层中，注册成功但永远不会就绪
+        if (!owns(fd)) return 0;
+        errno = EBADF;
+        return -1;
+    }
+    Conn& c = conn(fd);
+    if (op == EPOLL_CTL_DEL) {
+        c.registered = false;
+        c.pending = 0;
+        return 0;
+    }
+    if (op == EPOLL_CTL_ADD && c.registered) {
+        errno = EEXIST;
+        return -1;
+    }
+    c.registered = true;
+    c.events = event->events;
+    c.data = event->data;
+    // 与内核一致：注册时已可读 / 可写的连接立即产生一个边沿
+    uint32_t ready = EPOLLOUT;
+    if (c.read_pos < c.input.size()) ready |= EPOLLIN;
+    if (c.eof) ready |= EPOLLIN | EPOLLRDHUP;
+    signal(fd, ready);
+    return 0;
+}
+
+int MemoryTransport::epollWait(int, epoll_event* events, int max_events, int) {
+    int n = 0;
+    while (n < max_events && !ready_.empty()) {
+        int fd = ready_.front();
+        ready_.pop_front();
+        Conn& c = conn(fd);
+        c.queued = false;
+        if (!c.registered || c.pending == 0) continue;
+        events[n].events = c.pending;
+        events[n].data = c.data;
+        c.pending = 0;
+        ++n;
+    }
+    return n;
+}
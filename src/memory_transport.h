@@ -0,0 +1,92 @@
+#ifndef MEMORY_TRANSPORT_H
+#define MEMORY_TRANSPORT_H
+
+#include "transport.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 内存中的连接：客户端数据由 feed 写入，服务端写出的数据按需保存。
+// 没有内核参与，配合 Worker::attachConnection / Worker::poll 在调用线程上驱动，
+// 结果只取决于输入，适合做单核基准、剖析和流量回放。
+//
+// - 虚拟 fd 从 FD_BASE 开始，不会与真实 fd 冲突；对真实 fd 的 close / sendfile 的源文件照常走内核
+// - 读：每次最多返回 segment 字节（默认不限），模拟请求分段到达；没有数据时 EAGAIN，shutdown 后读到 0
+// - 写：总是一次写完
+// - epoll：按边沿触发模拟，feed 产生 EPOLLIN，注册或修改为含 EPOLLOUT 时产生一次 EPOLLOUT；
+//   epollWait 从不阻塞。没有监听套接字，accept 总是 EAGAIN
+// - 只能在一个线程上使用
+class MemoryTransport final : public Transport {
+public:
+    static constexpr int FD_BASE = 1 << 24;
+
+    // capture 为 false 时只统计写出的字节数，不保存内容（基准用）
+    explicit MemoryTransport(bool capture = true) : capture_(capture) {}
+
+    // 新建一个连接，返回虚拟 fd
+    int open(size_t segment = 0);
+    // 追加客户端发来的数据
+    void feed(int fd, std::string_view data);
+    // 客户端关闭写方向：数据读完后 read 返回 0
+    void shutdown(int fd);
+
+    // 服务端写出、尚未取走的数据（capture 为 true 时）
+    const std::string& output(int fd) const { return conn(fd).output; }
+    std::string takeOutput(int fd);
+    bool closed(int fd) const { return conn(fd).closed; }
+    // 客户端数据中尚未被服务端读走的字节
+    size_t unread(int fd) const { return conn(fd).input.size() - conn(fd).read_pos; }
+
+    // 累计计数
+    uint64_t reads() const { return reads_; }
+    uint64_t writes() const { return writes_; }
+    uint64_t bytesIn() const { return bytes_in_; }
+    uint64_t bytesOut() const { return bytes_out_; }
+
+    int accept(int listen_fd, sockaddr* addr, socklen_t* addr_len, int flags) override;
+    ssize_t read(int fd, void* buf, size_t len) override;
+    ssize_t write(int fd, const void* buf, size_t len) override;
+    ssize_t writev(int fd, const iovec* iov, int iovcnt) override;
+    ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count) override;
+    int close(int fd) override;
+    int epollCtl(int epfd, int op, int fd, epoll_event* event) override;
+    int epollWait(int epfd, epoll_event* events, int max_events, int timeout) override;
+
+private:
+    struct Conn {
+        std::string input;
+        size_t read_pos = 0;
+        size_t segment = 0;
+        bool eof = false;
+        bool closed = false;
+        std::string output;
+        // epoll 注册
+        bool registered = false;
+        uint32_t events = 0;
+        epoll_data_t data{};
+        uint32_t pending = 0;       // 尚未报告的边沿
+        bool queued = false;        // 已在 ready_ 中
+    };
+
+    bool owns(int fd) const {
+        return fd >= FD_BASE && static_cast<size_t>(fd - FD_BASE) < conns_.size();
+    }
+    Conn& conn(int fd) { return conns_[fd - FD_BASE]; }
+    const Conn& conn(int fd) const { return conns_[fd - FD_BASE]; }
+    void signal(int fd, uint32_t events);
+    void append(Conn& c, const char* data, size_t len);
+
+    bool capture_;
+    std::vector<Conn> conns_;
+    std::deque<int> ready_;
+    uint64_t reads_ = 0;
+    uint64_t writes_ = 0;
+    uint64_t bytes_in_ = 0;
+    uint64_t bytes_out_ = 0;
+};
+
+#endif
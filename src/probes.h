@@ -0,0 +1,44 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+// USDT 静态探针（provider 为 hphs），供 bpftrace / perf / SystemTap 在线挂载。
+// 未挂载时每个探针只是一条 nop，参数只取寄存器里已有的值，不做额外计算；
+// 没有 sys/sdt.h（systemtap-sdt-dev）或 -DHPHS_USDT=OFF 时编译为空。
+//
+// 探针与参数：
+//   accept(fd, worker)
+//   request(fd, method, path, path_len)      请求头解析完成，path 不以 0 结尾
+//   cache_hit(fd, path, path_len)
+//   cache_miss(fd, path, path_len)
+//   response(fd, keep_alive)                 响应全部写出
+//   write_again(fd, remaining)               写到 EAGAIN，剩余字节数（不含 sendfile 部分）
+//   sendfile_start(fd, size)                 首次调用 sendfile 前（尚未发出字节时遇到 EAGAIN 会再次触发）
+//   sendfile_done(fd, size)
+//   close(fd, reason, requests)              reason 见 CloseReason
+//
+// 例：按请求统计解析到写完的延迟
+//   bpftrace -e 'usdt:./hphs:hphs:request { @s[arg0] = nsecs; }
+//                usdt:./hphs:hphs:response /@s[arg0]/ { @us = hist((nsecs - @s[arg0]) / 1000); delete(@s[arg0]); }'
+
+#if HPHS_USDT
+#include <sys/sdt.h>
+#define HPHS_PROBE(...) STAP_PROBEV(hphs, __VA_ARGS__)
+#else
+// 参数仍然“使用”一次，避免只用于探针的变量产生未使用警告；都是无副作用的取值，会被优化掉
+template <typename... Args>
+inline void hphsProbeUnused(const Args&...) {}
+#define HPHS_PROBE(name, ...) hphsProbeUnused(__VA_ARGS__)
+#endif
+
+// close 探针的 reason 参数
+enum class CloseReason : int {
+    ERROR = 0,          // 读写出错
+    PEER = 1,           // 对端关闭
+    DONE = 2,           // 非 keep-alive 响应写完
+    IDLE = 3,           // 空闲超时
+    WEBSOCKET = 4,      // WebSocket 关闭握手完成、协议错误或慢消费者
+    RATE_LIMITED = 5,   // 超过连接速率，未进入连接表
+    DRAINED = 6,        // Worker 退役时超过排空时限仍未能迁出
+};
+
+#endif
@@ -0,0 +1,232 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <endian.h>
+#include <memory>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include "latency_histogram.h"
+
+// 客户端地址折算出的限流 key：单个地址与所在网段（IPv4 /24，IPv6 按 /64 视为一个地址、/48 为网段）
+// 已经过混合，可直接用作哈希；0 表示不限流（UNIX 套接字）
+struct PeerKey {
+    uint64_t host = 0;
+    uint64_t subnet = 0;
+
+    static PeerKey fromAddress(const sockaddr_storage& addr) {
+        PeerKey key;
+        if (addr.ss_family == AF_INET) {
+            uint32_t ip = ntohl(reinterpret_cast<const sockaddr_in&>(addr).sin_addr.s_addr);
+            key.host = mix(0x0400000000000000ull | ip);
+            key.subnet = mix(0x1800000000000000ull | (ip & 0xFFFFFF00u));
+        } else if (addr.ss_family == AF_INET6) {
+            const in6_addr& a = reinterpret_cast<const sockaddr_in6&>(addr).sin6_addr;
+            if (IN6_IS_ADDR_V4MAPPED(&a)) {
+                uint32_t ip = (uint32_t(a.s6_addr[12]) << 24) | (uint32_t(a.s6_addr[13]) << 16) |
+                              (uint32_t(a.s6_addr[14]) << 8) | a.s6_addr[15];
+                key.host = mix(0x0400000000000000ull | ip);
+                key.subnet = mix(0x1800000000000000ull | (ip & 0xFFFFFF00u));
+            } else {
+                uint64_t prefix;
+                memcpy(&prefix, a.s6_addr, sizeof(prefix));
+                key.host = mix(prefix ^ 0x6464646464646464ull);
+                key.subnet = mix((prefix & htobe64(0xFFFFFFFFFFFF0000ull)) ^ 0x3030303030303030ull);
+            }
+        }
+        return key;
+    }
+
+private:
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        x ^= x >> 33;
+        return x ? x : 1;
+    }
+};
+
+// 按客户端地址 / 网段的令牌桶限流，每个 Worker 一个实例，只在所属线程上访问
+//
+// - 表：组相联开放寻址，每组 4 个 16 字节条目正好一个 cache line，查找只碰一行；
+//   条目只存 32 位指纹，组满时替换最久未访问的条目（被替换的客户端重新拿到满桶），计数是近似的
+// - 桶：GCRA，每个桶只存一个理论到达时间（微秒，32 位回绕），无需单独的令牌数和刷新时间
+// - 分片：SO_REUSEPORT 把同一客户端的连接分散到各 Worker，配置的速率按在线 Worker 数均分，
+//   弹性 Worker 增减后由 setWorkers 重新分摊
+class RateLimiter {
+public:
+    struct Limits {
+        uint32_t conn_rate = 0;     // 每秒，0 表示不限
+        uint32_t request_rate = 0;
+    };
+
+    RateLimiter(const Limits& host, const Limits& subnet, uint32_t burst_ms,
+                size_t table_entries, uint32_t workers)
+        : host_limits_(host), subnet_limits_(subnet), burst_ms_(burst_ms),
+          host_(makeBucket(host.conn_rate, burst_ms, workers),
+                makeBucket(host.request_rate, burst_ms, workers)),
+          subnet_(makeBucket(subnet.conn_rate, burst_ms, workers),
+                  makeBucket(subnet.request_rate, burst_ms, workers)),
+          base_ns_(monotonicNs()) {
+        size_t groups = 1;
+        while (groups * WAYS < table_entries) groups <<= 1;
+        group_mask_ = groups - 1;
+        groups_.reset(new Group[groups]());
+    }
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    // 限流用的时钟（微秒，回绕），Worker 每次唤醒取一次
+    uint32_t clock() const { return static_cast<uint32_t>((monotonicNs() - base_ns_) / 1000); }
+
+    // 在线 Worker 数变化后重新计算本 Worker 的份额；已有条目的理论到达时间保留，按新间隔继续
+    void setWorkers(uint32_t workers) {
+        host_ = KeyLimits(makeBucket(host_limits_.conn_rate, burst_ms_, workers),
+                          makeBucket(host_limits_.request_rate, burst_ms_, workers));
+        subnet_ = KeyLimits(makeBucket(subnet_limits_.conn_rate, burst_ms_, workers),
+                            makeBucket(subnet_limits_.request_rate, burst_ms_, workers));
+    }
+
+    bool limitsConnections() const { return host_.conn.interval || subnet_.conn.interval; }
+    bool limitsRequests() const { return host_.request.interval || subnet_.request.interval; }
+
+    bool allowConnection(const PeerKey& peer, uint32_t now) {
+        if (allow(peer.host, host_.conn, &Entry::conn_tat, now) &&
+            allow(peer.subnet, subnet_.conn, &Entry::conn_tat, now))
+            return true;
+        addRelaxed(limited_connections_);
+        return false;
+    }
+
+    bool allowRequest(const PeerKey& peer, uint32_t now) {
+        if (allow(peer.host, host_.request, &Entry::request_tat, now) &&
+            allow(peer.subnet, subnet_.request, &Entry::request_tat, now))
+            return true;
+        addRelaxed(limited_requests_);
+        return false;
+    }
+
+    // 预构建的 429，keep_alive 为 false 时带 Connection: close
+    static const std::string& tooManyRequests(bool keep_alive) {
+        static const std::string keep = build(true);
+        static const std::string close = build(false);
+        return keep_alive ? keep : close;
+    }
+
+    // 任意线程可读取
+    uint64_t limitedConnections() const { return limited_connections_.load(std::memory_order_relaxed); }
+    uint64_t limitedRequests() const { return limited_requests_.load(std::memory_order_relaxed); }
+    uint64_t evictions() const { return evictions_.load(std::memory_order_relaxed); }
+    size_t capacity() const { return (group_mask_ + 1) * WAYS; }
+
+private:
+    static constexpr size_t WAYS = 4;
+
+    struct Entry {
+        uint32_t fingerprint;   // 0 为空
+        uint32_t touched;       // 最近访问时间，组满时替换最旧的
+        uint32_t conn_tat;      // 理论到达时间
+        uint32_t request_tat;
+    };
+    struct alignas(64) Group {
+        Entry ways[WAYS];
+    };
+    static_assert(sizeof(Group) == 64, "one group per cache line");
+
+    // interval：每个请求占用的时间；tolerance：允许提前的时间，即突发容量
+    struct Bucket {
+        uint32_t interval = 0;  // 0 表示不限
+        uint32_t tolerance = 0;
+    };
+    struct KeyLimits {
+        KeyLimits(Bucket c, Bucket r) : conn(c), request(r) {}
+        Bucket conn;
+        Bucket request;
+    };
+
+    static Bucket makeBucket(uint32_t rate, uint32_t burst_ms, uint32_t workers) {
+        Bucket b;
+        if (rate == 0) return b;
+        uint64_t interval = uint64_t(1000000) * (workers ? workers : 1) / rate;
+        b.interval = static_cast<uint32_t>(interval ? std::min<uint64_t>(interval, 1u << 30) : 1);
+        uint64_t burst_us = uint64_t(burst_ms) * 1000;
+        b.tolerance = static_cast<uint32_t>(
+            std::min<uint64_t>(burst_us > b.interval ? burst_us - b.interval : 0, 1u << 30));
+        return b;
+    }
+
+    static void addRelaxed(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // GCRA：理论到达时间不晚于 now + tolerance 时放行并后移一个 interval。
+    // 正常情况下 tat - now 不超过 tolerance + interval，更大的差值说明条目已闲置到时钟回绕，按满桶处理
+    bool allow(uint64_t key, const Bucket& bucket, uint32_t Entry::*tat, uint32_t now) {
+        if (bucket.interval == 0 || key == 0) return true;
+        Entry& e = lookup(key, now);
+        uint32_t& t = e.*tat;
+        int32_t ahead = static_cast<int32_t>(t - now);
+        if (ahead <= 0 || static_cast<uint32_t>(ahead) > bucket.tolerance + bucket.interval) {
+            t = now;
+        } else if (static_cast<uint32_t>(ahead) > bucket.tolerance) {
+            return false;
+        }
+        t += bucket.interval;
+        return true;
+    }
+
+    Entry& lookup(uint64_t key, uint32_t now) {
+        Entry* group = groups_[key & group_mask_].ways;
+        uint32_t fingerprint = static_cast<uint32_t>(key >> 32) | 1;
+        Entry* victim = group;
+        for (size_t i = 0; i < WAYS; ++i) {
+            if (group[i].fingerprint == fingerprint) {
+                group[i].touched = now;
+                return group[i];
+            }
+        }
+        for (size_t i = 0; i < WAYS; ++i) {
+            if (group[i].fingerprint == 0) {
+                victim = &group[i];
+                break;
+            }
+            if (static_cast<int32_t>(group[i].touched - victim->touched) < 0) victim = &group[i];
+        }
+        if (victim->fingerprint != 0) addRelaxed(evictions_);
+        *victim = Entry{fingerprint, now, now, now};
+        return *victim;
+    }
+
+    static std::string build(bool keep_alive) {
+        std::string body = "429 Too Many Requests\n";
+        std::string r = "HTTP/1.1 429 Too Many Requests\r\n";
+        r += "Server: HPHS/1.0\r\n";
+        r += "Content-Type: text/plain; charset=utf-8\r\n";
+        r += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+        r += "Retry-After: 1\r\n";
+        r += keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        return r + body;
+    }
+
+    const Limits host_limits_;
+    const Limits subnet_limits_;
+    const uint32_t burst_ms_;
+    KeyLimits host_;
+    KeyLimits subnet_;
+    const uint64_t base_ns_;
+    size_t group_mask_ = 0;
+    std::unique_ptr<Group[]> groups_;
+
+    std::atomic<uint64_t> limited_connections_{0};
+    std::atomic<uint64_t> limited_requests_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
+
+#endif
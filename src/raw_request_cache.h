@@ -0,0 +1,144 @@
+#ifndef RAW_REQUEST_CACHE_H
+#define RAW_REQUEST_CACHE_H
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// 原始请求头 → 预构建响应的直接映射，每个 Worker 一个，只在所属线程上访问
+//
+// 负载均衡器、健康检查和压测客户端会成百万次地发送逐字节相同的请求头。
+// 第一次走完整的解析和查找后，把整个请求头块（到 \r\n\r\n 为止）连同解析出的预构建响应
+// （静态文件缓存或静态路由）和 keep-alive
+// 决定记下来；之后同样的字节只需一次哈希加一次 memcmp，不再构造 HttpRequest。
+//
+// - 直接映射，槽位数为 2 的幂，冲突时覆盖；每个槽位保存请求头原文，命中时逐字节校验
+// - 只记录结果仅由请求字节决定、且响应在进程生命周期内不变的请求（由调用方保证）
+// - 超过 MAX_HEADER 的请求头不记录
+class RawRequestCache {
+public:
+    static constexpr size_t MAX_HEADER = 512;
+
+    struct Hit {
+        std::string_view response;
+        std::string_view target;    // 请求行中的原始 request-target，指向调用方数据（探针用）
+        size_t length;              // 请求头长度，即要消费的字节数
+        bool keep_alive;
+        bool cached;                // 响应来自 ResponseCache（计入缓存命中），否则为静态路由
+        uint8_t method;             // 调用方记录的请求方法
+    };
+
+    explicit RawRequestCache(size_t entries) {
+        size_t slots = 1;
+        while (slots < entries) slots <<= 1;
+        mask_ = entries > 0 ? slots - 1 : 0;
+        if (entries > 0) {
+            slots_.resize(slots);
+            bytes_.reset(new char[slots * MAX_HEADER]);
+        }
+    }
+
+    bool enabled() const { return !slots_.empty(); }
+
+    // data 开头是完整且已记录的请求头时返回 true
+    bool lookup(std::string_view data, Hit& hit) const {
+        size_t len = headerLength(data);
+        if (len == 0) return false;
+        uint64_t h = hash(data.data(), len);
+        const Slot& s = slots_[h & mask_];
+        if (s.hash != h || s.length != len ||
+            memcmp(bytes_.get() + (h & mask_) * MAX_HEADER, data.data(), len) != 0)
+            return false;
+        hit.response = s.response;
+        hit.target = data.substr(s.target_offset, s.target_length);
+        hit.length = len;
+        hit.keep_alive = s.keep_alive;
+        hit.cached = s.cached;
+        hit.method = s.method;
+        return true;
+    }
+
+    // header 为完整的请求头块（以 \r\n\r\n 结尾）
+    void insert(std::string_view header, std::string_view response, bool keep_alive,
+                bool cached, uint8_t method) {
+        if (!enabled() || header.size() > MAX_HEADER || header.size() < 4 ||
+            header.compare(header.size() - 4, 4, "\r\n\r\n") != 0)
+            return;
+        uint64_t h = hash(header.data(), header.size());
+        size_t index = h & mask_;
+        Slot& s = slots_[index];
+        s.hash = h;
+        s.length = static_cast<uint32_t>(header.size());
+        size_t begin = header.find(' ');
+        size_t end = begin == std::string_view::npos ? begin : header.find(' ', begin + 1);
+        if (end == std::string_view::npos) begin = end = 0;
+        else ++begin;
+        s.target_offset = static_cast<uint16_t>(begin);
+        s.target_length = static_cast<uint16_t>(end - begin);
+        s.keep_alive = keep_alive;
+        s.cached = cached;
+        s.method = method;
+        s.response = response;
+        memcpy(bytes_.get() + index * MAX_HEADER, header.data(), header.size());
+    }
+
+    // 响应缓存内容变化时整体作废
+    void clear() {
+        for (Slot& s : slots_) s = Slot();
+    }
+
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        uint32_t length = 0;        // 0 为空
+        uint16_t target_offset = 0;
+        uint16_t target_length = 0;
+        bool keep_alive = false;
+        bool cached = false;
+        uint8_t method = 0;
+        std::string_view response;
+    };
+
+    // 请求头块长度（含 \r\n\r\n），在 MAX_HEADER 内找不到时返回 0。
+    // 按行 memchr 找 '\n'，短请求头上比 memmem 快几倍
+    static size_t headerLength(std::string_view data) {
+        const char* begin = data.data();
+        const char* end = begin + (data.size() < MAX_HEADER ? data.size() : MAX_HEADER);
+        const char* p = begin;
+        while (true) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+            if (!nl) return 0;
+            if (nl - begin >= 3 && nl[-1] == '\r' && nl[-2] == '\n' && nl[-3] == '\r')
+                return nl - begin + 1;
+            p = nl + 1;
+        }
+    }
+
+    // 按 8 字节一组的乘法-移位哈希，请求头通常只有几十字节
+    static uint64_t hash(const char* p, size_t n) {
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ n;
+        while (n >= 8) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            h = (h ^ w) * 0xff51afd7ed558ccdull;
+            h ^= h >> 32;
+            p += 8;
+            n -= 8;
+        }
+        uint64_t w = 0;
+        memcpy(&w, p, n);
+        h = (h ^ w) * 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 29;
+        return h;
+    }
+
+    size_t mask_ = 0;
+    std::vector<Slot> slots_;
+    std::unique_ptr<char[]> bytes_;
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef REQUEST_BODY_H
+#define REQUEST_BODY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unistd.h>
+
+// chunked 编码增量解码器
+// 数据到多少喂多少，解出的数据块直接交给 sink 回调，自身不缓存任何数据
+class ChunkedDecoder {
+public:
+    enum State {
+        SIZE,          // 读取十六进制块长度
+        SIZE_EXT,      // 跳过 chunk-ext
+        SIZE_LF,       // 块长度行的 \n
+        DATA,          // 块数据
+        DATA_CR,       // 块数据后的 \r
+        DATA_LF,       // 块数据后的 \n
+        TRAILER,       // trailer 行首
+        TRAILER_LINE,  // trailer 行内容
+        TRAILER_LF,    // 结束空行的 \n
+        DONE,
+        ERROR
+    };
+
+    /**
+     * 喂入一段原始数据
+     * @param sink bool(const char*, size_t)，返回 false 表示中止
+     * @return 消耗的字节数；DONE 之后的数据属于下一个请求，不会被消耗
+     */
+    template <typename Sink>
+    size_t feed(const char* data, size_t len, Sink&& sink) {
+        size_t i = 0;
+        while (i < len && state_ != DONE && state_ != ERROR) {
+            char c = data[i];
+            switch (state_) {
+            case SIZE: {
+                int digit = hexValue(c);
+                if (digit >= 0) {
+                    // 超过 15 位十六进制视为非法，防止溢出
+                    if (++size_digits_ > 15) { state_ = ERROR; break; }
+                    chunk_remaining_ = (chunk_remaining_ << 4) | digit;
+                } else if (size_digits_ == 0) {
+                    state_ = ERROR;
+                } else if (c == '\r') {
+                    state_ = SIZE_LF;
+                } else if (c == ';' || c == ' ' || c == '\t') {
+                    state_ = SIZE_EXT;
+                } else {
+                    state_ = ERROR;
+                }
+                ++i;
+                break;
+            }
+            case SIZE_EXT:
+                if (c == '\r') state_ = SIZE_LF;
+                else if (c == '\n') state_ = ERROR;
+                ++i;
+                break;
+            case SIZE_LF:
+                if (c != '\n') { state_ = ERROR; break; }
+                state_ = chunk_remaining_ == 0 ? TRAILER : DATA;
+                ++i;
+                break;
+            case DATA: {
+                size_t n = len - i;
+                if (n > chunk_remaining_) n = chunk_remaining_;
+                if (!sink(data + i, n)) { state_ = ERROR; break; }
+                chunk_remaining_ -= n;
+                i += n;
+                if (chunk_remaining_ == 0) state_ = DATA_CR;
+                break;
+            }
+            case DATA_CR:
+                state_ = c == '\r' ? DATA_LF : ERROR;
+                ++i;
+                break;
+            case DATA_LF:
+                if (c != '\n') { state_ = ERROR; break; }
+                state_ = SIZE;
+                size_digits_ = 0;
+                ++i;
+                break;
+            case TRAILER:
+                state_ = c == '\r' ? TRAILER_LF : TRAILER_LINE;
+                ++i;
+                break;
+            case TRAILER_LINE:
+                if (c == '\n') state_ = TRAILER;
+                ++i;
+                break;
+            case TRAILER_LF:
+                state_ = c == '\n' ? DONE : ERROR;
+                ++i;
+                break;
+            default:
+                break;
+            }
+        }
+        return i;
+    }
+
+    bool done() const { return state_ == DONE; }
+    bool error() const { return state_ == ERROR; }
+
+    void reset() {
+        state_ = SIZE;
+        chunk_remaining_ = 0;
+        size_digits_ = 0;
+    }
+
+private:
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    State state_ = SIZE;
+    uint64_t chunk_remaining_ = 0;
+    int size_digits_ = 0;
+};
+
+// 请求体流式接收状态
+// 请求体不进入 read_buffer_，到达即写入 sink（上传文件或直接丢弃）
+struct BodyState {
+    enum Mode { NONE, LENGTH, CHUNKED };
+
+    Mode mode = NONE;
+    uint64_t remaining = 0;       // LENGTH 模式剩余字节
+    uint64_t received = 0;        // 已接收的请求体字节（chunked 为解码后）
+    ChunkedDecoder chunked;
+    int sink_fd = -1;             // 上传写入的临时文件，-1 表示丢弃
+    std::string temp_path;        // 临时文件路径，请求体完整收到后才改名为 target_path
+    std::string target_path;
+    int pipe_fd[2] = {-1, -1};    // splice 中转管道，仅 socket -> 文件零拷贝时使用
+    int status = 0;               // 请求体收完后返回的状态码
+    bool write_failed = false;
+    bool continue_sent = false;   // 已回过 100 Continue（路由请求等请求体时会重复解析请求头）
+
+    bool active() const { return mode != NONE; }
+    bool useSplice() const { return pipe_fd[0] >= 0; }
+
+    // 上传未完成（出错、超限、连接中途关闭）时删除临时文件，目标文件保持原样
+    void reset() {
+        if (sink_fd >= 0) close(sink_fd);
+        if (!temp_path.empty()) unlink(temp_path.c_str());
+        temp_path.clear();
+        target_path.clear();
+        if (pipe_fd[0] >= 0) close(pipe_fd[0]);
+        if (pipe_fd[1] >= 0) close(pipe_fd[1]);
+        sink_fd = -1;
+        pipe_fd[0] = pipe_fd[1] = -1;
+        mode = NONE;
+        remaining = 0;
+        received = 0;
+        chunked.reset();
+        status = 0;
+        write_failed = false;
+        continue_sent = false;
+    }
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef RESPONSE_ARENA_H
+#define RESPONSE_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <sys/mman.h>
+
+// 预构建响应的连续内存区：启动时一次分配、顺序写入，之后只读
+// 优先 MAP_HUGETLB（需预留大页），否则按 2MB 对齐后 madvise(MADV_HUGEPAGE) 交给透明大页
+class ResponseArena {
+public:
+    static constexpr size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+    enum Backing { NONE, HUGETLB, THP, SMALL_PAGES };
+
+    ResponseArena() = default;
+    ~ResponseArena() { release(); }
+
+    ResponseArena(const ResponseArena&) = delete;
+    ResponseArena& operator=(const ResponseArena&) = delete;
+
+    bool allocate(size_t size) {
+        release();
+        if (size == 0) return true;
+        capacity_ = (size + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+
+        void* p = mmap(nullptr, capacity_, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            base_ = static_cast<char*>(p);
+            backing_ = HUGETLB;
+            return true;
+        }
+
+        // 多映射一个大页再裁掉首尾，保证起始地址 2MB 对齐，透明大页才能整页映射
+        size_t span = capacity_ + HUGE_PAGE;
+        p = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            capacity_ = 0;
+            return false;
+        }
+        uintptr_t raw = reinterpret_cast<uintptr_t>(p);
+        uintptr_t aligned = (raw + HUGE_PAGE - 1) & ~(uintptr_t)(HUGE_PAGE - 1);
+        if (aligned > raw) munmap(p, aligned - raw);
+        size_t tail = raw + span - (aligned + capacity_);
+        if (tail > 0) munmap(reinterpret_cast<void*>(aligned + capacity_), tail);
+
+        base_ = reinterpret_cast<char*>(aligned);
+        backing_ = madvise(base_, capacity_, MADV_HUGEPAGE) == 0 ? THP : SMALL_PAGES;
+        return true;
+    }
+
+    // 追加一段数据，返回指向区内副本的视图；调用方保证总量不超过 allocate 的大小
+    std::string_view append(std::string_view data) {
+        char* dst = base_ + used_;
+        memcpy(dst, data.data(), data.size());
+        used_ += data.size();
+        return std::string_view(dst, data.size());
+    }
+
+    // 写入完成后设为只读，运行期误写直接触发 SIGSEGV
+    void seal() {
+        if (base_) mprotect(base_, capacity_, PROT_READ);
+    }
+
+    size_t used() const { return used_; }
+    size_t capacity() const { return capacity_; }
+    Backing backing() const { return backing_; }
+
+    const char* backingName() const {
+        switch (backing_) {
+        case HUGETLB: return "MAP_HUGETLB";
+        case THP: return "MADV_HUGEPAGE";
+        case SMALL_PAGES: return "4K pages";
+        default: return "none";
+        }
+    }
+
+private:
+    void release() {
+        if (base_) munmap(base_, capacity_);
+        base_ = nullptr;
+        capacity_ = 0;
+        used_ = 0;
+        backing_ = NONE;
+    }
+
+    char* base_ = nullptr;
+    size_t capacity_ = 0;
+    size_t used_ = 0;
+    Backing backing_ = NONE;
+};
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef RESPONSE_CACHE_H
 #define RESPONSE_CACHE_H
 
+#include <cstdio>
+#include <cstring>
+#include <deque>
 #include <string>
 #include <unordered_map>
 #include <fstream>
@@ -8,43 +11,194 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include <memory>
+#include <string_view>
+#include <vector>
 #include "http_response.h"
+#include "response_arena.h"
+#include "lazy_cache.h"
+#include "cache_snapshot.h"
 
-// 缓存条目：预构建的完整 HTTP 响应
+// 缓存条目：指向 ResponseArena 中预构建的完整 HTTP 响应
 struct CacheEntry {
-    std::string response;      // 完整的 HTTP 响应（headers + body）
+    std::string_view response;   // 完整的 HTTP 响应（headers + body），目录别名与文件共享同一段
     std::string content_type;
     size_t body_size;
 };
 
-// 静态文件响应缓存
-// 启动时预加载所有静态文件到内存，避免每次请求都读磁盘
+// 预构建的静态文件响应，preload 和 hphs-pack 共用
+struct PreparedFile {
+    std::string url_path;
+    std::string alias;           // index.html 所在目录的无斜杠路径，为空表示无别名
+    std::string response;
+    std::string content_type;
+    size_t body_size;
+};
+
+// 静态文件响应缓存，三种模式：
+// - 默认启动时预加载所有静态文件，所有响应首尾相接放进同一块大页内存
+// - 加载了 hphs-pack 生成的快照（loadSnapshot）时直接在只读映射上查找，不读取 www_root
+// - 设置了内存上限（enableBudget）时不预加载，由 LazyCache 在未命中时按需读入并淘汰
 class ResponseCache {
 public:
-    // 预加载指定目录下的所有文件
+    // 有上限的按需缓存，替代 preload；workers 为调用 find 的 Worker 数（静止点回收用）
+    void enableBudget(size_t budget, size_t workers) {
+        lazy_ = std::make_unique<LazyCache>(budget, workers);
+    }
+
+    // 映射快照文件代替 preload，失败返回 false（保持未加载状态）
+    bool loadSnapshot(const std::string& path) {
+        return snapshot_.open(path);
+    }
+
+    // 预加载指定目录下的所有文件：先读入临时缓冲，得到总大小后一次性分配 arena
     void preload(const std::string& www_root) {
-        www_root_ = www_root;
-        loadDirectory(www_root, "");
+        std::vector<PreparedFile> pending = scan(www_root);
+
+        size_t total = 0;
+        for (const PreparedFile& f : pending) total += f.response.size();
+        if (!arena_.allocate(total)) {
+            return;
+        }
+        for (PreparedFile& f : pending) {
+            CacheEntry entry;
+            entry.response = arena_.append(f.response);
+            entry.content_type = std::move(f.content_type);
+            entry.body_size = f.body_size;
+            if (!f.alias.empty()) {
+                cache_[keys_.emplace_back(std::move(f.alias))] = entry;
+                ++alias_count_;
+            }
+            cache_[keys_.emplace_back(std::move(f.url_path))] = std::move(entry);
+        }
+        arena_.seal();
     }
 
-    // 查找缓存，返回 nullptr 表示未命中
-    const CacheEntry* find(const std::string& path) const {
+    // 遍历目录，为不超过 1MB 的文件构建完整响应
+    static std::vector<PreparedFile> scan(const std::string& www_root) {
+        std::vector<PreparedFile> files;
+        loadDirectory(www_root, "", files);
+        return files;
+    }
+
+    // 查找预构建响应，data() 为 nullptr 表示未命中
+    // 按需模式下返回的响应只在本轮事件循环内有效，之后可能被淘汰回收
+    // 命中路径不分配：补全 index.html 的键放在栈上
+    std::string_view find(std::string_view path) const {
+        return withKey(path, [this](std::string_view key) {
+            if (snapshot_.loaded()) {
+                return snapshot_.find(key);
+            }
+            if (lazy_) {
+                const CacheEntry* entry = lazy_->find(key, LazyCache::hashKey(key));
+                return entry ? entry->response : std::string_view();
+            }
+            auto it = cache_.find(key);
+            return it != cache_.end() ? it->second.response : std::string_view();
+        });
+    }
+
+    // 目录请求补全 index.html
+    static std::string cacheKey(const std::string& path) {
         std::string key = path;
         if (key.empty() || key.back() == '/') {
             key += "index.html";
         }
+        return key;
+    }
+
+    // 以补全后的键调用 fn：键放在栈缓冲区中，超长路径才退回 std::string
+    template <typename Fn>
+    static auto withKey(std::string_view path, Fn&& fn) -> decltype(fn(path)) {
+        static constexpr std::string_view INDEX = "index.html";
+        if (!path.empty() && path.back() != '/') {
+            return fn(path);
+        }
+        char buf[256];
+        if (path.size() + INDEX.size() <= sizeof(buf)) {
+            memcpy(buf, path.data(), path.size());
+            memcpy(buf + path.size(), INDEX.data(), INDEX.size());
+            return fn(std::string_view(buf, path.size() + INDEX.size()));
+        }
+        std::string key(path);
+        key += INDEX;
+        return fn(std::string_view(key));
+    }
+
+    // 与预加载相同格式的完整响应
+    static std::string buildResponse(const std::string& content_type, std::string_view body) {
+        std::string resp;
+        resp.reserve(body.size() + 160);
+        resp += "HTTP/1.1 200 OK\r\n";
+        resp += "Server: HPHS/1.0\r\n";
+        resp += "Content-Type: " + content_type + "\r\n";
+        resp += "Content-Length: "+ std::to_string(body.size()) + "\r\n";
+        resp += "ETag: " + etag(body) + "\r\n";
+        resp += "Connection: keep-alive\r\n";
+        resp += "\r\n";
+        resp.append(body.data(), body.size());
+        return resp;
+    }
+
+    // 强校验 ETag："<长度>-<FNV-1a 64>"，均为十六进制
+    static std::string etag(std::string_view body) {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for (unsigned char c : body) {
+            h = (h ^ c) * 0x100000001b3ull;
+        }
+        char buf[48];
+        int n = snprintf(buf, sizeof(buf), "\"%zx-%016llx\"", body.size(),
+                         static_cast<unsigned long long>(h));
+        return std::string(buf, n);
+    }
 
-        auto it = cache_.find(key);
-        if (it != cache_.end()) {
-            return &it->second;
+    // 预构建响应头中的 ETag 值（含引号），没有时为空
+    static std::string_view etagOf(std::string_view response) {
+        static constexpr std::string_view NAME = "\r\nETag: ";
+        size_t header_end = response.find("\r\n\r\n");
+        size_t pos = response.substr(0, header_end).find(NAME);
+        if (pos == std::string_view::npos) return std::string_view();
+        pos += NAME.size();
+        size_t end = response.find("\r\n", pos);
+        return response.substr(pos, end - pos);
+    }
+
+    // If-None-Match 是否匹配 etag：支持 *、逗号分隔的列表和 W/ 前缀（弱比较）
+    static bool etagMatches(std::string_view if_none_match, std::string_view etag) {
+        if (etag.empty()) return false;
+        while (!if_none_match.empty()) {
+            size_t comma = if_none_match.find(',');
+            std::string_view item = if_none_match.substr(0, comma);
+            while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+                item.remove_prefix(1);
+            while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+                item.remove_suffix(1);
+            if (item.substr(0, 2) == "W/") item.remove_prefix(2);
+            if (item == "*" || item == etag) return true;
+            if (comma == std::string_view::npos) break;
+            if_none_match.remove_prefix(comma + 1);
         }
-        return nullptr;
+        return false;
     }
 
-    size_t size() const { return cache_.size(); }
+    // 未命中后是否读入整个文件写入缓存（仅按需模式）
+    bool wantFill(std::string_view path) const {
+        return lazy_ && withKey(path, [this](std::string_view key) {
+                   return lazy_->wantFill(LazyCache::hashKey(key));
+               });
+    }
+
+    // 按需模式的缓存层，未启用时为 nullptr（Worker 线程内部同步，可并发调用）
+    LazyCache* lazy() const { return lazy_.get(); }
+
+    const CacheSnapshot& snapshot() const { return snapshot_; }
+
+    size_t size() const { return snapshot_.loaded() ? snapshot_.entries() : cache_.size(); }
+    size_t aliasCount() const { return alias_count_; }
+    const ResponseArena& arena() const { return arena_; }
 
 private:
-    void loadDirectory(const std::string& base_path, const std::string& rel_path) {
+    static void loadDirectory(const std::string& base_path, const std::string& rel_path,
+                              std::vector<PreparedFile>& files) {
         std::string full_path = base_path + rel_path;
         DIR* dir = opendir(full_path.c_str());
         if (!dir) return;
@@ -61,9 +215,9 @@ private:
             if (stat(file_full_path.c_str(), &st) < 0) continue;
 
             if (S_ISDIR(st.st_mode)) {
-                loadDirectory(base_path, file_rel_path);
+                loadDirectory(base_path, file_rel_path, files);
             } else if (S_ISREG(st.st_mode)) {
-                loadFile(file_full_path, file_rel_path);
+                loadFile(file_full_path, file_rel_path, files);
             }
         }
         closedir(dir);
@@ -72,7 +226,8 @@ private:
     // 文件大小限制：大文件用 sendfile 零拷贝更快
     static constexpr size_t MAX_CACHE_FILE_SIZE = 1 * 1024 * 1024;  // 1MB
 
-    void loadFile(const std::string& full_path, const std::string& url_path) {
+    static void loadFile(const std::string& full_path, const std::string& url_path,
+                         std::vector<PreparedFile>& files) {
         struct stat st;
         if (stat(full_path.c_str(), &st) < 0) return;
 
@@ -92,33 +247,28 @@ private:
         // 构建完整的 HTTP 响应
         std::string content_type = HttpResponse::getContentType(full_path);
 
-        std::string resp;
-        resp += "HTTP/1.1 200 OK\r\n";
-        resp += "Server: HPHS/1.0\r\n";
-        resp += "Content-Type: " + content_type + "\r\n";
-        resp += "Content-Length: "+ std::to_string(body.size()) + "\r\n";
-        resp += "Connection: keep-alive\r\n";
-        resp += "\r\n";
-        resp += body;
-
-        CacheEntry entry;
-        entry.response = std::move(resp);
-        entry.content_type = content_type;
-        entry.body_size = body.size();
-
-        // 如果是 index.html，同时缓存目录路径
-        // "/index.html" (12字符) -> "/" (1字符)
-        if (url_path.size() >= 12 &&
-            url_path.substr(url_path.size() - 12) == "/index.html") {
-            std::string dir_path = url_path.substr(0, url_path.size() - 11);
-            cache_[dir_path] = entry;  // 先存目录路径（拷贝）
-        }
+        PreparedFile pending;
+        pending.url_path = url_path;
+        pending.response = buildResponse(content_type, body);
+        pending.content_type = content_type;
+        pending.body_size = body.size();
 
-        cache_[url_path] = std::move(entry);  // 再 move 到文件路径
+        // 如果是 index.html，不带斜杠的目录路径作为别名共享同一段响应
+        // "/docs/index.html" -> "/docs"（带斜杠的 "/docs/" 由 find 补全）
+        static constexpr std::string_view INDEX = "/index.html";
+        if (url_path.size() > INDEX.size() &&
+            std::string_view(url_path).substr(url_path.size() - INDEX.size()) == INDEX) {
+            pending.alias = url_path.substr(0, url_path.size() - INDEX.size());
+        }
+        files.push_back(std::move(pending));
     }
 
-    std::string www_root_;
-    std::unordered_map<std::string, CacheEntry> cache_;
+    std::deque<std::string> keys_;    // cache_ 的键指向这里，deque 追加时不移动已有元素
+    std::unordered_map<std::string_view, CacheEntry> cache_;
+    ResponseArena arena_;
+    CacheSnapshot snapshot_;
+    size_t alias_count_ = 0;
+    std::unique_ptr<LazyCache> lazy_;
 };
 
 #endif
@@ -0,0 +1,213 @@
+#include "router.h"
+#include "http_response.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <map>
+
+void ResponseWriter::addHeader(std::string_view key, std::string_view value) {
+    if (extra_count_ < MAX_EXTRA_HEADERS) {
+        extra_[extra_count_][0] = key;
+        extra_[extra_count_][1] = value;
+        ++extra_count_;
+    }
+}
+
+void ResponseWriter::write(uint64_t value) {
+    char num[24];
+    auto [end, ec] = std::to_chars(num, num + sizeof(num), value);
+    (void)ec;
+    buf_.append(num, end - num);
+}
+
+size_t ResponseWriter::finish(bool keep_alive) {
+    char head[HEADER_RESERVE];
+    size_t len = 0;
+    bool overflow = false;
+
+    auto put = [&](std::string_view s) {
+        if (len + s.size() > sizeof(head)) {
+            overflow = true;
+            return;
+        }
+        memcpy(head + len, s.data(), s.size());
+        len += s.size();
+    };
+
+    char code[8];
+    auto code_end = std::to_chars(code, code + sizeof(code), status_).ptr;
+    char length[24];
+    auto length_end = std::to_chars(length, length + sizeof(length),
+                                    buf_.size() - HEADER_RESERVE).ptr;
+
+    put("HTTP/1.1 ");
+    put(std::string_view(code, code_end - code));
+    put(" ");
+    put(HttpResponse::getStatusMessage(status_));
+    put("\r\nServer: HPHS/1.0\r\nContent-Type: ");
+    put(content_type_);
+    put("\r\nContent-Length: ");
+    put(std::string_view(length, length_end - length));
+    put(keep_alive ? "\r\nConnection: keep-alive\r\n" : "\r\nConnection: close\r\n");
+    for (size_t i = 0; i < extra_count_; ++i) {
+        put(extra_[i][0]);
+        put(": ");
+        put(extra_[i][1]);
+        put("\r\n");
+    }
+    put("\r\n");
+
+    if (overflow) {
+        // 响应头超出预留空间（极少见）：退化为重新拼接
+        std::string header;
+        header.append("HTTP/1.1 ").append(code, code_end - code).append(" ");
+        header.append(HttpResponse::getStatusMessage(status_));
+        header.append("\r\nServer: HPHS/1.0\r\nContent-Type: ").append(content_type_);
+        header.append("\r\nContent-Length: ").append(length, length_end - length);
+        header.append(keep_alive ? "\r\nConnection: keep-alive\r\n" : "\r\nConnection: close\r\n");
+        for (size_t i = 0; i < extra_count_; ++i) {
+            header.append(extra_[i][0]).append(": ").append(extra_[i][1]).append("\r\n");
+        }
+        header.append("\r\n");
+        buf_.replace(0, HEADER_RESERVE, header);
+        return 0;
+    }
+
+    size_t start = HEADER_RESERVE - len;
+    memcpy(&buf_[start], head, len);
+    return start;
+}
+
+void Router::add(unsigned methods, const std::string& path, MatchType type,
+                 RouteHandler handler) {
+    Route route;
+    route.methods = methods;
+    route.handler = std::move(handler);
+    pending_.push_back({methods, path, type, std::move(route)});
+}
+
+void Router::addStatic(unsigned methods, const std::string& path, MatchType type,
+                       int status, const std::string& content_type,
+                       const std::string& body) {
+    Route route;
+    route.methods = methods;
+    route.response = "HTTP/1.1 " + std::to_string(status) + " " +
+                     HttpResponse::getStatusMessage(status) + "\r\n";
+    route.response += "Server: HPHS/1.0\r\n";
+    route.response += "Content-Type: " + content_type + "\r\n";
+    route.response += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    route.response += "Connection: keep-alive\r\n";
+    route.response += "\r\n";
+    route.response += body;
+    pending_.push_back({methods, path, type, std::move(route)});
+}
+
+uint32_t Router::addWebSocket(const std::string& path, WebSocketHandler handler) {
+    uint32_t channel = static_cast<uint32_t>(ws_paths_.size());
+    ws_paths_.push_back(path);
+    ws_handlers_.push_back(std::move(handler));
+
+    Route route;
+    route.methods = methodBit(HttpRequest::GET);
+    route.websocket = static_cast<int32_t>(channel);
+    pending_.push_back({route.methods, path, EXACT, std::move(route)});
+    return channel;
+}
+
+int32_t Router::webSocketChannel(std::string_view path) const {
+    for (size_t i = 0; i < ws_paths_.size(); ++i) {
+        if (ws_paths_[i] == path) return static_cast<int32_t>(i);
+    }
+    return -1;
+}
+
+void Router::compile() {
+    // 同一路径、同一匹配方式的路由放在一起，组内按注册顺序匹配方法
+    std::stable_sort(pending_.begin(), pending_.end(),
+                     [](const Pending& a, const Pending& b) {
+                         if (a.path != b.path) return a.path < b.path;
+                         return a.type < b.type;
+                     });
+
+    // 先构建临时的指针式前缀树
+    struct TempNode {
+        std::map<char, uint32_t> children;
+        int32_t exact = -1;
+        int32_t prefix = -1;
+    };
+    std::vector<TempNode> temp(1);
+
+    routes_.clear();
+    groups_.clear();
+    for (size_t i = 0; i < pending_.size();) {
+        size_t j = i;
+        Group group;
+        group.first = routes_.size();
+        unsigned allowed = 0;
+        while (j < pending_.size() && pending_[j].path == pending_[i].path &&
+               pending_[j].type == pending_[i].type) {
+            allowed |= pending_[j].methods;
+            routes_.push_back(std::move(pending_[j].route));
+            ++j;
+        }
+        group.count = routes_.size() - group.first;
+
+        // 预构建该路径的 405 响应（带 Allow 头）
+        std::string allow;
+        static const HttpRequest::Method all[] = {
+            HttpRequest::GET, HttpRequest::HEAD, HttpRequest::POST,
+            HttpRequest::PUT, HttpRequest::DELETE};
+        static const char* names[] = {"GET", "HEAD", "POST", "PUT", "DELETE"};
+        for (size_t m = 0; m < 5; ++m) {
+            if (allowed & methodBit(all[m])) {
+                if (!allow.empty()) allow += ", ";
+                allow += names[m];
+            }
+        }
+        std::string body = "<html><body><h1>405 Method Not Allowed</h1></body></html>";
+        group.not_allowed = "HTTP/1.1 405 Method Not Allowed\r\n";
+        group.not_allowed += "Server: HPHS/1.0\r\n";
+        group.not_allowed += "Content-Type: text/html\r\n";
+        group.not_allowed += "Allow: " + allow + "\r\n";
+        group.not_allowed += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+        group.not_allowed += "Connection: keep-alive\r\n\r\n";
+        group.not_allowed += body;
+
+        uint32_t node = 0;
+        for (char c : pending_[i].path) {
+            auto it = temp[node].children.find(c);
+            if (it == temp[node].children.end()) {
+                temp.emplace_back();
+                it = temp[node].children.emplace(c, temp.size() - 1).first;
+            }
+            node = it->second;
+        }
+        int32_t group_index = static_cast<int32_t>(groups_.size());
+        if (pending_[i].type == EXACT) temp[node].exact = group_index;
+        else temp[node].prefix = group_index;
+        groups_.push_back(std::move(group));
+        i = j;
+    }
+    pending_.clear();
+
+    // 按 BFS 顺序扁平化，入队时分配新编号
+    nodes_.assign(temp.size(), Node{});
+    edge_chars_.clear();
+    edge_next_.clear();
+    std::vector<uint32_t> queue{0};
+    std::vector<uint32_t> new_index(temp.size(), 0);
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const TempNode& t = temp[queue[head]];
+        Node& n = nodes_[head];
+        n.exact = t.exact;
+        n.prefix = t.prefix;
+        n.first_edge = edge_chars_.size();
+        n.edge_count = t.children.size();
+        for (const auto& [c, child] : t.children) {
+            new_index[child] = queue.size();
+            queue.push_back(child);
+            edge_chars_.push_back(c);
+            edge_next_.push_back(new_index[child]);
+        }
+    }
+}
@@ -0,0 +1,193 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include "http_request.h"
+#include "websocket.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * 路由处理函数写入的响应
+ *
+ * 直接写进 Connection 的写缓冲区：缓冲区随连接对象复用，预热后不再分配。
+ * 缓冲区开头预留 HEADER_RESERVE 字节，body 写完后再把响应头右对齐填进去，
+ * 这样不需要先知道 Content-Length，也不需要额外拼接。
+ */
+class ResponseWriter {
+public:
+    static constexpr size_t HEADER_RESERVE = 512;
+
+    explicit ResponseWriter(std::string& buffer) : buf_(buffer) {
+        buf_.assign(HEADER_RESERVE, '\0');
+    }
+
+    void setStatus(int code) { status_ = code; }
+    void setContentType(std::string_view type) { content_type_ = type; }
+
+    /**
+     * 额外的响应头，key/value 需在 finish() 之前保持有效
+     */
+    void addHeader(std::string_view key, std::string_view value);
+
+    void write(std::string_view data) { buf_.append(data.data(), data.size()); }
+    void write(uint64_t value);
+    void write(char c) { buf_.push_back(c); }
+
+    /**
+     * 填充响应头
+     * @return 响应在缓冲区中的起始偏移
+     */
+    size_t finish(bool keep_alive);
+
+private:
+    static constexpr size_t MAX_EXTRA_HEADERS = 8;
+
+    std::string& buf_;
+    int status_ = 200;
+    std::string_view content_type_ = "text/plain; charset=utf-8";
+    std::string_view extra_[MAX_EXTRA_HEADERS][2];
+    size_t extra_count_ = 0;
+};
+
+/**
+ * 动态路由处理函数
+ *
+ * 带 Content-Length 请求体的请求在请求体整体到达后调用，通过 HttpRequest::body() 读取；
+ * 请求体不超过 max_header_size，chunked 或更大的请求体直接回 413，不会调用 handler。
+ */
+using RouteHandler = std::function<void(const HttpRequest&, ResponseWriter&)>;
+
+/**
+ * 路由表
+ *
+ * 启动时注册，compile() 后编译成扁平数组形式的静态前缀树，运行期只读，
+ * 多个 Worker 共享无需加锁。支持精确匹配、前缀匹配和按方法匹配。
+ * 静态路由（如健康检查）预构建完整响应，与缓存命中走同一条零分配路径。
+ */
+class Router {
+public:
+    enum MatchType { EXACT, PREFIX };
+
+    static constexpr unsigned methodBit(HttpRequest::Method m) { return 1u << m; }
+    static constexpr unsigned GET_HEAD =
+        (1u << HttpRequest::GET) | (1u << HttpRequest::HEAD);
+    static constexpr unsigned ANY_METHOD =
+        GET_HEAD | (1u << HttpRequest::POST) |
+        (1u << HttpRequest::PUT) | (1u << HttpRequest::DELETE);
+
+    struct Route {
+        unsigned methods = 0;
+        RouteHandler handler;       // 动态路由
+        std::string response;       // 静态路由的预构建响应，非空时优先
+        int32_t websocket = -1;     // WebSocket 端点编号，不小于 0 时按升级请求处理
+    };
+
+    struct Match {
+        const Route* route = nullptr;              // 命中的路由
+        const std::string* not_allowed = nullptr;  // 路径命中但方法不允许：预构建的 405
+    };
+
+    void add(unsigned methods, const std::string& path, MatchType type,
+             RouteHandler handler);
+
+    /**
+     * 注册静态路由，响应在注册时构建完成
+     */
+    void addStatic(unsigned methods, const std::string& path, MatchType type,
+                   int status, const std::string& content_type,
+                   const std::string& body);
+
+    /**
+     * 注册 WebSocket 端点（GET 升级请求），返回端点编号，即广播使用的 channel
+     * handler 在收到完整数据消息时调用，为空时忽略客户端消息
+     */
+    uint32_t addWebSocket(const std::string& path, WebSocketHandler handler);
+
+    /**
+     * 编译为静态前缀树，之后不能再注册
+     */
+    void compile();
+
+    Match match(HttpRequest::Method method, std::string_view path) const {
+        Match result;
+        if (nodes_.empty()) return result;
+
+        const Node* node = &nodes_[0];
+        int32_t best = node->prefix;
+        size_t i = 0;
+        for (; i < path.size(); ++i) {
+            const Node* next = child(*node, path[i]);
+            if (!next) break;
+            node = next;
+            if (node->prefix >= 0) best = node->prefix;
+        }
+        int32_t group = (i == path.size() && node->exact >= 0) ? node->exact : best;
+        if (group < 0) return result;
+
+        const Group& g = groups_[group];
+        unsigned bit = methodBit(method);
+        for (uint32_t r = g.first; r < g.first + g.count; ++r) {
+            if (routes_[r].methods & bit) {
+                result.route = &routes_[r];
+                return result;
+            }
+        }
+        result.not_allowed = &g.not_allowed;
+        return result;
+    }
+
+    bool empty() const { return routes_.empty(); }
+    size_t size() const { return routes_.size(); }
+
+    // 按路径查找 WebSocket 端点编号，不存在时返回 -1
+    int32_t webSocketChannel(std::string_view path) const;
+    const WebSocketHandler& webSocketHandler(uint32_t channel) const {
+        return ws_handlers_[channel];
+    }
+    size_t webSocketCount() const { return ws_paths_.size(); }
+
+private:
+    struct Pending {
+        unsigned methods;
+        std::string path;
+        MatchType type;
+        Route route;
+    };
+
+    // 扁平化后的前缀树节点，子边按字符排序存放在 edge_chars_/edge_next_ 中
+    struct Node {
+        uint32_t first_edge = 0;
+        uint32_t edge_count = 0;
+        int32_t exact = -1;   // 精确匹配的路由组
+        int32_t prefix = -1;  // 前缀匹配的路由组
+    };
+
+    // 同一路径、同一匹配方式的路由（按方法区分）
+    struct Group {
+        uint32_t first = 0;
+        uint32_t count = 0;
+        std::string not_allowed;
+    };
+
+    const Node* child(const Node& node, char c) const {
+        const char* chars = edge_chars_.data() + node.first_edge;
+        for (uint32_t e = 0; e < node.edge_count; ++e) {
+            if (chars[e] == c) return &nodes_[edge_next_[node.first_edge + e]];
+        }
+        return nullptr;
+    }
+
+    std::vector<Pending> pending_;
+    std::vector<Node> nodes_;
+    std::vector<char> edge_chars_;
+    std::vector<uint32_t> edge_next_;
+    std::vector<Group> groups_;
+    std::vector<Route> routes_;
+    std::vector<std::string> ws_paths_;         // 下标即端点编号
+    std::vector<WebSocketHandler> ws_handlers_;
+};
+
+#endif
@@ -1,16 +1,57 @@
 #ifndef SERVER_CONFIG_H
 #define SERVER_CONFIG_H
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <thread>
+#include <vector>
+#include "listen_endpoint.h"
 
 struct ServerConfig {
     int port = 8080;
+    std::vector<ListenEndpoint> listen;           // 监听端点，为空时监听 0.0.0.0:port
     int worker_count = std::thread::hardware_concurrency();
     std::string www_root = "./www";
     int max_events = 4096;
     int idle_timeout_ms = 60000;
     bool use_sendfile = true;
+    int io_threads = 2;                           // 阻塞文件 IO 线程数，0 表示在事件循环内同步执行
+    std::string access_log;                       // 访问日志文件，"-" 为标准输出，为空表示关闭
+    uint32_t access_log_sample = 1;               // 每 N 个请求记录一条
+    size_t access_log_ring = 16384;               // 每个 Worker 环形缓冲区的记录数（64 字节/条）
+    bool latency_stats = true;                    // 分阶段延迟直方图（每个请求约 3 次 vDSO 取时）
+    size_t zerocopy_threshold = 0;                // 预构建响应不小于该字节数时用 MSG_ZEROCOPY 发送，0 表示关闭
+    uint32_t busy_poll_us = 0;                    // 忙轮询窗口（微秒），0 表示关闭，开启后空闲时也会占用 CPU
+    int defer_accept_s = 0;                       // TCP_DEFER_ACCEPT（秒）：连接收到数据才交给 accept，accept 后立即读，0 表示关闭
+    int fastopen_queue = 0;                       // TCP Fast Open 服务端队列长度（需 net.ipv4.tcp_fastopen 含 2），0 表示关闭
+    uint32_t rebalance_ms = 0;                    // 负载均衡检查间隔（毫秒），过载 Worker 把空闲连接迁给轻载 Worker，0 表示关闭
+    int max_workers = 0;                          // 运行期 Worker 数上限，非 0 时可按利用率或管理命令增减 Worker，0 表示固定为 worker_count
+    int min_workers = 1;                          // 缩容下限
+    uint32_t autoscale_ms = 0;                    // 按事件循环利用率自动增减的检查间隔（毫秒），0 表示只响应管理命令
+    uint32_t scale_up_util = 70;                  // 在线 Worker 平均 CPU 利用率（%）高于此值时增加一个
+    uint32_t scale_down_util = 30;                // 少一个 Worker 后平均利用率仍低于此值（连续 3 个周期）时退役一个
+    std::string admin_token;                      // 管理命令的口令（Authorization: Bearer），为空时不注册 POST /_hphs/workers/<n>
+    uint32_t drain_timeout_ms = 30000;            // 退役 Worker 迁出连接的时限，超时仍未迁出的连接直接关闭
+    std::string cache_snapshot;                   // hphs-pack 生成的快照文件，设置后直接映射使用，不再预加载或按需缓存
+    size_t cache_budget = 0;                      // 响应缓存内存上限（字节），未命中时按需读入并淘汰，0 表示启动时预加载全部文件
+    bool epoll_register_once = false;             // 连接注册时一次性订阅 EPOLLIN|EPOLLOUT（边沿触发），此后不再 epoll_ctl
+    bool coroutines = false;                      // 连接由协程处理（需 HPHS_COROUTINES 构建），否则走回调状态机
+    std::vector<std::string> cache_ignore_query = {"*"};   // 查缓存时忽略的 query 参数名，"*" 为全部；含其他参数的请求不查缓存，直接读文件
+    size_t raw_request_cache = 256;               // 每个 Worker 记住的原始请求头条数（逐字节相同的请求跳过解析），0 表示关闭
+    uint32_t ip_conn_rate = 0;                    // 每个客户端 IP 每秒新建连接数上限（所有 Worker 合计，近似），0 表示不限
+    uint32_t ip_request_rate = 0;                 // 每个客户端 IP 每秒请求数上限
+    uint32_t subnet_conn_rate = 0;                // 每个网段（IPv4 /24、IPv6 /48）每秒新建连接数上限
+    uint32_t subnet_request_rate = 0;             // 每个网段每秒请求数上限
+    uint32_t rate_limit_burst_ms = 1000;          // 令牌桶容量，按该时长内的配额计
+    size_t rate_limit_table = 16384;              // 每个 Worker 限流表的条目数（16 字节/条）
+    bool rate_limit_close = false;                // 超限时直接断开（连接为 RST，请求回 429 后关闭），否则回 429 并保持连接
+    std::vector<std::string> websocket_paths;     // WebSocket 广播端点：客户端发来的消息转发给该端点的全部订阅者
+    size_t websocket_queue_limit = 1024 * 1024;   // 每个 WebSocket 连接待发送字节上限，超过视为慢消费者
+    bool websocket_drop_slow = true;              // 慢消费者：true 丢弃新帧，false 断开连接
+    std::string upload_root;                      // PUT 上传目录，为空表示禁用上传
+    size_t max_header_size = 64 * 1024;           // 请求头上限，超过返回 400
+    uint64_t max_body_size = 1ULL << 30;          // 请求体上限，超过返回 413
     bool debug_log = false;
 };
 
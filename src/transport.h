@@ -0,0 +1,60 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Worker 访问连接所用的系统调用：accept、读写、sendfile、关闭和 epoll。
+// 默认的 SocketTransport 直接转发给内核；MemoryTransport 在内存中模拟连接，
+// 用于在单核上确定性地测量和剖析整条请求处理路径、回放录制的请求流。
+// 一次虚函数调用相对系统调用本身可以忽略。
+//
+// 未经过传输层的只有套接字专有的功能：splice 上传、MSG_ZEROCOPY、SO_* 选项、getpeername。
+// Worker 只在 SocketTransport 上使用 splice 和 MSG_ZEROCOPY，其他传输层走普通 read / writev
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    virtual int accept(int listen_fd, sockaddr* addr, socklen_t* addr_len, int flags) = 0;
+    virtual ssize_t read(int fd, void* buf, size_t len) = 0;
+    virtual ssize_t write(int fd, const void* buf, size_t len) = 0;
+    virtual ssize_t writev(int fd, const iovec* iov, int iovcnt) = 0;
+    virtual ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count) = 0;
+    virtual int close(int fd) = 0;
+    virtual int epollCtl(int epfd, int op, int fd, epoll_event* event) = 0;
+    virtual int epollWait(int epfd, epoll_event* events, int max_events, int timeout) = 0;
+};
+
+class SocketTransport final : public Transport {
+public:
+    // 无状态，所有 Worker 共用一个
+    static SocketTransport& instance() {
+        static SocketTransport transport;
+        return transport;
+    }
+
+    int accept(int listen_fd, sockaddr* addr, socklen_t* addr_len, int flags) override {
+        return ::accept4(listen_fd, addr, addr_len, flags);
+    }
+    ssize_t read(int fd, void* buf, size_t len) override { return ::read(fd, buf, len); }
+    ssize_t write(int fd, const void* buf, size_t len) override { return ::write(fd, buf, len); }
+    ssize_t writev(int fd, const iovec* iov, int iovcnt) override {
+        return ::writev(fd, iov, iovcnt);
+    }
+    ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count) override {
+        return ::sendfile(out_fd, in_fd, offset, count);
+    }
+    int close(int fd) override { return ::close(fd); }
+    int epollCtl(int epfd, int op, int fd, epoll_event* event) override {
+        return ::epoll_ctl(epfd, op, fd, event);
+    }
+    int epollWait(int epfd, epoll_event* events, int max_events, int timeout) override {
+        return ::epoll_wait(epfd, events, max_events, timeout);
+    }
+};
+
+#endif
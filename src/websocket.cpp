@@ -0,0 +1,188 @@
+#include "websocket.h"
+#include "http_request.h"
+
+#include <cctype>
+#include <cstring>
+
+namespace websocket {
+
+namespace {
+
+constexpr std::string_view GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+uint32_t rotl(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+// 握手只需要对 60 字节左右的输入做一次 SHA1，用最直接的实现
+void sha1(std::string_view data, uint8_t digest[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    std::string msg(data);
+    uint64_t bit_len = static_cast<uint64_t>(data.size()) * 8;
+    msg.push_back(static_cast<char>(0x80));
+    while (msg.size() % 64 != 56) msg.push_back('\0');
+    for (int i = 7; i >= 0; --i) msg.push_back(static_cast<char>(bit_len >> (i * 8)));
+
+    for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const unsigned char* p =
+                reinterpret_cast<const unsigned char*>(msg.data() + chunk + i * 4);
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+                   (uint32_t(p[2]) << 8) | p[3];
+        }
+        for (int i = 16; i < 80; ++i) w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    for (int i = 0; i < 5; ++i) {
+        digest[i * 4] = static_cast<uint8_t>(h[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(h[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(h[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(h[i]);
+    }
+}
+
+std::string base64(const uint8_t* data, size_t len) {
+    static const char TABLE[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((len + 2) / 3 * 4);
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = uint32_t(data[i]) << 16;
+        if (i + 1 < len) v |= uint32_t(data[i + 1]) << 8;
+        if (i + 2 < len) v |= data[i + 2];
+        out.push_back(TABLE[(v >> 18) & 63]);
+        out.push_back(TABLE[(v >> 12) & 63]);
+        out.push_back(i + 1 < len ? TABLE[(v >> 6) & 63] : '=');
+        out.push_back(i + 2 < len ? TABLE[v & 63] : '=');
+    }
+    return out;
+}
+
+// 逗号分隔的头部值中是否含有 token（不区分大小写），如 "keep-alive, Upgrade"
+bool hasToken(std::string_view value, std::string_view token) {
+    while (!value.empty()) {
+        size_t comma = value.find(',');
+        std::string_view item = value.substr(0, comma);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) item.remove_prefix(1);
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) item.remove_suffix(1);
+        if (item.size() == token.size()) {
+            bool equal = true;
+            for (size_t i = 0; i < item.size() && equal; ++i) {
+                equal = std::tolower(static_cast<unsigned char>(item[i])) ==
+                        std::tolower(static_cast<unsigned char>(token[i]));
+            }
+            if (equal) return true;
+        }
+        if (comma == std::string_view::npos) break;
+        value.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+}  // namespace
+
+std::string handshakeResponse(const HttpRequest& request) {
+    std::string_view key = request.getHeader("Sec-WebSocket-Key");
+    if (request.method() != HttpRequest::GET || request.version() != "HTTP/1.1" ||
+        !hasToken(request.getHeader("Upgrade"), "websocket") ||
+        !hasToken(request.getHeader("Connection"), "upgrade") ||
+        request.getHeader("Sec-WebSocket-Version") != "13" || key.empty()) {
+        return std::string();
+    }
+    std::string response = "HTTP/1.1 101 Switching Protocols\r\n"
+                           "Server: HPHS/1.0\r\n"
+                           "Upgrade: websocket\r\n"
+                           "Connection: Upgrade\r\n"
+                           "Sec-WebSocket-Accept: ";
+    response += acceptKey(key);
+    response += "\r\n\r\n";
+    return response;
+}
+
+std::string acceptKey(std::string_view client_key) {
+    std::string input(client_key);
+    input.append(GUID.data(), GUID.size());
+    uint8_t digest[20];
+    sha1(input, digest);
+    return base64(digest, sizeof(digest));
+}
+
+std::string encodeFrame(Opcode opcode, std::string_view payload) {
+    std::string frame;
+    frame.reserve(payload.size() + 10);
+    frame.push_back(static_cast<char>(0x80 | opcode));
+    if (payload.size() < 126) {
+        frame.push_back(static_cast<char>(payload.size()));
+    } else if (payload.size() <= 0xFFFF) {
+        frame.push_back(static_cast<char>(126));
+        frame.push_back(static_cast<char>(payload.size() >> 8));
+        frame.push_back(static_cast<char>(payload.size()));
+    } else {
+        frame.push_back(static_cast<char>(127));
+        for (int i = 7; i >= 0; --i)
+            frame.push_back(static_cast<char>(static_cast<uint64_t>(payload.size()) >> (i * 8)));
+    }
+    frame.append(payload.data(), payload.size());
+    return frame;
+}
+
+Frame makeFrame(Opcode opcode, std::string_view payload) {
+    return std::make_shared<const std::string>(encodeFrame(opcode, payload));
+}
+
+// 客户端帧必须带掩码，保留位必须为 0；控制帧不能分片且不超过 125 字节
+int parseHeader(std::string_view data, FrameHeader& header) {
+    if (data.size() < 2) return 0;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+    header.fin = (p[0] & 0x80) != 0;
+    header.opcode = p[0] & 0x0F;
+    if ((p[0] & 0x70) != 0 || (p[1] & 0x80) == 0) return -1;
+
+    size_t pos = 2;
+    uint64_t len = p[1] & 0x7F;
+    if (len == 126) {
+        if (data.size() < 4) return 0;
+        len = (uint64_t(p[2]) << 8) | p[3];
+        pos = 4;
+    } else if (len == 127) {
+        if (data.size() < 10) return 0;
+        len = 0;
+        for (int i = 0; i < 8; ++i) len = (len << 8) | p[2 + i];
+        pos = 10;
+    }
+    if ((header.opcode & 0x8) != 0 && (!header.fin || len > 125)) return -1;
+    if (data.size() < pos + 4) return 0;
+    memcpy(header.mask, p + pos, 4);
+    header.length = len;
+    return static_cast<int>(pos + 4);
+}
+
+}  // namespace websocket
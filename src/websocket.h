@@ -0,0 +1,71 @@
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+class HttpRequest;
+
+// WebSocket（RFC 6455）帧编解码与连接状态
+namespace websocket {
+
+enum Opcode : uint8_t {
+    CONTINUATION = 0x0,
+    TEXT = 0x1,
+    BINARY = 0x2,
+    CLOSE = 0x8,
+    PING = 0x9,
+    PONG = 0xA,
+};
+
+// 单条消息（含分片拼接后）的上限，超过以 1009 关闭
+static constexpr size_t MAX_MESSAGE_SIZE = 1024 * 1024;
+
+// 编码后的服务端帧，广播时所有订阅连接共享同一份，按引用计数释放
+using Frame = std::shared_ptr<const std::string>;
+
+// Sec-WebSocket-Accept = base64(SHA1(key + GUID))
+std::string acceptKey(std::string_view client_key);
+
+// 校验升级请求（GET、Upgrade: websocket、Connection 含 Upgrade、版本 13、带 key），
+// 成功时返回 101 响应，失败返回空串
+std::string handshakeResponse(const HttpRequest& request);
+
+// 服务端帧不加掩码
+std::string encodeFrame(Opcode opcode, std::string_view payload);
+Frame makeFrame(Opcode opcode, std::string_view payload);
+
+// 解析一个客户端帧头：返回头部长度，数据不足返回 0，格式错误返回 -1
+struct FrameHeader {
+    bool fin;
+    uint8_t opcode;
+    uint64_t length;
+    uint8_t mask[4];
+};
+int parseHeader(std::string_view data, FrameHeader& header);
+
+}  // namespace websocket
+
+// 收到完整数据消息时在所在 Worker 线程上调用（channel 为端点编号）
+using WebSocketHandler =
+    std::function<void(uint32_t channel, std::string_view payload, bool binary)>;
+
+// 升级后的连接状态，放在 ConnectionCold 中，升级时分配
+struct WebSocketState {
+    uint32_t channel = 0;
+    uint32_t subscriber = 0;            // 在 Worker 订阅表中的下标
+    bool open = false;                  // 101 已写完，已加入订阅表
+    bool closing = false;               // 已发出 close 帧，发完即关闭
+    uint8_t message_opcode = 0;         // 分片消息的类型
+    std::string message;                // 分片消息拼接
+    std::deque<websocket::Frame> out;   // 待发送帧，队首已发出 out_offset 字节
+    size_t out_offset = 0;
+    size_t queued_bytes = 0;            // 队列中尚未发出的字节
+};
+
+#endif
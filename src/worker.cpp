@@ -4,6 +4,8 @@
 #include "http_response.h"
 
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
 #include <fstream>
@@ -17,65 +19,342 @@
 #include <unistd.h>
 #include <vector>
 #include <sys/uio.h>
-
-Worker::Worker(int id, const ServerConfig &config, const ResponseCache &cache)
-    : id_(id), config_(config), cache_(cache) {}
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <ctime>
+#include <pthread.h>
+#include <linux/errqueue.h>
+
+// 内核 6.9 起可以按 epoll 实例开启忙轮询，旧的头文件中没有这些定义
+#ifndef EPIOCSPARAMS
+struct epoll_params {
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t prefer_busy_poll;
+    uint8_t __pad;
+};
+#define EPIOCSPARAMS _IOW(0x8A, 0x01, struct epoll_params)
+#endif
+
+static constexpr int BLOCK_TIMEOUT_MS = 100;
+
+// 负载均衡：请求速率超过均值 25% 且不低于下限时才迁移，每次最多拉平与目标差值的一半，避免来回振荡
+static constexpr int LOAD_TICK_MS = 1000;               // 未开启均衡时仍按此周期发布负载
+static constexpr uint64_t REBALANCE_MIN_LOAD = 1000;    // 请求/秒
+
+// 退役：连接全部迁出后再多处理一会儿邮箱，接住与状态切换同时发出的迁入连接，其余的由 handOff 转交
+static constexpr int DRAIN_GRACE_MS = 100;
+
+Worker::Worker(int id, const ServerConfig &config, const ResponseCache &cache,
+               const Router &router, IoPool *io_pool)
+    : id_(id), config_(config), cache_(cache), router_(router),
+      io_pool_(io_pool),
+      conn_events_(config.epoll_register_once
+                       ? EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET
+                       : EPOLLIN | EPOLLRDHUP | EPOLLET),
+      raw_cache_(config.raw_request_cache) {
+    if (config.ip_conn_rate || config.ip_request_rate || config.subnet_conn_rate ||
+        config.subnet_request_rate) {
+        limiter_ = std::make_unique<RateLimiter>(
+            RateLimiter::Limits{config.ip_conn_rate, config.ip_request_rate},
+            RateLimiter::Limits{config.subnet_conn_rate, config.subnet_request_rate},
+            config.rate_limit_burst_ms, config.rate_limit_table,
+            static_cast<uint32_t>(config.worker_count));
+    }
+}
 
 Worker::~Worker() {
     stop();
     join();
+    // 线程退出后邮箱中剩余的消息：释放其中持有的 fd
+    mailbox_.drain([](WorkerMessage *msg) {
+        if (msg->type == WorkerMessage::CONNECTION && msg->fd >= 0)
+            close(msg->fd);
+        if (msg->io_task) {
+            if (msg->io_task->fd >= 0)
+                close(msg->io_task->fd);
+            delete msg->io_task;
+        }
+        delete msg;
+    });
+    for (IoTask *task : io_free_)
+        delete task;
     if (epoll_fd_ >= 0)
         close(epoll_fd_);
-    if (listen_fd_ >= 0)
-        close(listen_fd_);
+    closeListeners();
 }
 
-void Worker::start() {
+bool Worker::start() {
     epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
     if (epoll_fd_ < 0)
-        return;
+        return false;
+    if (config_.busy_poll_us > 0) {
+        spin_budget_ns_ = static_cast<uint64_t>(config_.busy_poll_us) * 1000;
+        enableEpollBusyPoll();
+    }
 
-    listen_fd_ = createListenSocket();
-    if (listen_fd_ < 0)
-        return;
+    if (!openListeners()) {
+        closeListeners();
+        close(epoll_fd_);
+        epoll_fd_ = -1;
+        return false;
+    }
 
-    // listen_fd 使用 nullptr 作为标记
-    addToEpoll(listen_fd_, EPOLLIN | EPOLLET, nullptr);
+    // 共享的套接字用 EPOLLEXCLUSIVE，新连接只唤醒一个 Worker
+    for (size_t i = 0; i < listeners_.size(); ++i) {
+        uint32_t events = EPOLLIN | EPOLLET;
+        if (!listeners_[i].owned)
+            events |= EPOLLEXCLUSIVE;
+        addTagToEpoll(listeners_[i].fd, events, LISTEN_TAG_BASE + i);
+    }
+    addTagToEpoll(mailbox_.eventFd(), EPOLLIN | EPOLLET, MAILBOX_TAG);
 
+    // 重新启动时从当前计数开始统计负载
+    load_requests_ = request_count_.load(std::memory_order_relaxed);
+    drain_start_ = std::chrono::steady_clock::time_point();
+    spinning_ = false;
     running_ = true;
+    state_.store(State::RUNNING, std::memory_order_release);
     thread_ = std::thread(&Worker::run, this);
+    return true;
 }
 
 void Worker::stop() { running_ = false; }
 
+const char *Worker::stateName(State state) {
+    switch (state) {
+    case State::RUNNING: return "running";
+    case State::DRAINING: return "draining";
+    default: return "stopped";
+    }
+}
+
+void Worker::retire() {
+    State expected = State::RUNNING;
+    if (!state_.compare_exchange_strong(expected, State::DRAINING))
+        return;
+    // 空消息只为唤醒阻塞中的 epoll_wait
+    post([](Worker &) {});
+}
+
+void Worker::handOff(Worker &target) {
+    mailbox_.drain([&](WorkerMessage *msg) {
+        switch (msg->type) {
+        case WorkerMessage::CONNECTION:
+            target.postConnection(msg->fd, std::move(msg->buffered));
+            break;
+        case WorkerMessage::CACHE_GENERATION:
+            cache_generation_ = std::max(cache_generation_, msg->generation);
+            raw_cache_.clear();
+            break;
+        case WorkerMessage::IO_COMPLETE:
+            // 只在停止时仍有 IO 未完成的情况下出现，连接已经关闭
+            --io_inflight_;
+            if (msg->io_task->fd >= 0)
+                close(msg->io_task->fd);
+            delete msg->io_task;
+            break;
+        default:
+            // 闭包和 WebSocket 广播只对在线的 Worker 有意义
+            break;
+        }
+        delete msg;
+    });
+}
+
 void Worker::join() {
     if (thread_.joinable())
         thread_.join();
 }
 
-int Worker::createListenSocket() {
-    int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
-    if (sockfd < 0)
-        return -1;
+// 创建本 Worker 自己的监听套接字：TCP 端点靠 SO_REUSEPORT 各自绑定，
+// 含 {worker} 的 UNIX 端点每个 Worker 一个文件
+bool Worker::openListeners() {
+    for (const ListenEndpoint &endpoint : config_.listen) {
+        if (!endpoint.perWorker())
+            continue;
+        int fd = openListenSocket(endpoint, id_);
+        if (fd < 0) {
+            std::cerr << "Worker " << id_ << " failed to listen on "
+                      << endpoint.describe() << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (endpoint.tcp())
+            configureListenSocket(fd);
+        listeners_.push_back({fd, endpoint.tcp(), true,
+                              endpoint.tcp() ? std::string() : endpoint.unixPath(id_)});
+    }
+    return !listeners_.empty();
+}
+
+// 关闭本 Worker 创建的监听套接字，共享的保留（归 HttpServer 所有，重新启动时再注册）
+void Worker::closeListeners() {
+    size_t kept = 0;
+    for (const ListenSocket &ls : listeners_) {
+        if (!ls.owned) {
+            listeners_[kept++] = ls;
+            continue;
+        }
+        close(ls.fd);
+        if (!ls.unix_path.empty())
+            unlink(ls.unix_path.c_str());
+    }
+    listeners_.resize(kept);
+}
+
+// 退役第一步：先接完已排在接受队列中的连接，再关闭本 Worker 的监听套接字，
+// SO_REUSEPORT 组随之缩小，之后的新连接由其余 Worker 接收。
+// 接完到关闭之间刚完成握手的连接仍会被内核重置；内核 5.14 起开启 net.ipv4.tcp_migrate_req
+// 后，这些连接改由内核迁到组内其他套接字
+void Worker::stopAccepting(const std::chrono::steady_clock::time_point &now) {
+    for (const ListenSocket &ls : listeners_) {
+        if (ls.owned)
+            handleAccept(ls.fd, ls.tcp, now);
+        removeFromEpoll(ls.fd);
+    }
+    closeListeners();
+}
 
+// 退役中每轮事件循环调用：处于请求间隙的连接轮流迁给在线的 Worker，其余等本次请求完成；
+// 超过 drain_timeout_ms 仍未迁出的关闭。连接和进行中的 IO 都清空后返回 true
+bool Worker::drain(const std::chrono::steady_clock::time_point &now) {
+    if (drain_start_ == std::chrono::steady_clock::time_point()) {
+        drain_start_ = now;
+        stopAccepting(now);
+        // 订阅关系按 Worker 维护，WebSocket 连接不迁移：发送 1001（Going Away）让客户端重连
+        std::vector<Connection *> ws;
+        conns_.forEach([&](Connection *conn) {
+            if (conn->state() == ConnectionState::WEBSOCKET && !conn->cold().ws->closing)
+                ws.push_back(conn);
+        });
+        for (Connection *conn : ws) {
+            if (!closeWebSocket(*conn, 1001))
+                closeConnection(conn, CloseReason::WEBSOCKET);
+        }
+    }
+
+    std::vector<Worker *> targets;
+    for (Worker *peer : peers_) {
+        if (peer != this && peer->state() == State::RUNNING)
+            targets.push_back(peer);
+    }
+    auto elapsed = now - drain_start_;
+    bool expired = elapsed >= std::chrono::milliseconds(config_.drain_timeout_ms);
+    std::vector<Connection *> pending;
+    conns_.forEach([&](Connection *conn) { pending.push_back(conn); });
+    size_t next = 0;
+    for (Connection *conn : pending) {
+        if (!targets.empty() && migratable(*conn)) {
+            migrateConnection(conn, *targets[next++ % targets.size()]);
+        } else if (expired) {
+            closeConnection(conn, CloseReason::DRAINED);
+        }
+    }
+    return conns_.size() == 0 && io_inflight_ == 0 &&
+           elapsed >= std::chrono::milliseconds(DRAIN_GRACE_MS);
+}
+
+// 线程退出时归还按需增长的资源，退役后的 Worker 只剩计数器和邮箱
+void Worker::releaseResources() {
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+    // 仍有 IO 任务持有连接指针时保留连接表
+    if (io_inflight_ == 0)
+        conns_.shrink();
+    load_.store(0, std::memory_order_relaxed);
+    cpu_clock_ready_.store(false, std::memory_order_release);
+#if HPHS_COROUTINES
+    frames_.trim();
+    timers_.clear();
+    timers_.shrink_to_fit();
+    scratch_.clear();
+    scratch_.shrink_to_fit();
+#endif
+}
+
+// 监听套接字上的选项由 accept 出来的连接继承，每个新连接省掉一次 setsockopt
+void Worker::configureListenSocket(int sockfd) {
     int opt = 1;
-    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-    setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    // 只建立了握手、还没发请求的连接留在内核里，Worker 不为它醒来；超时后照常交给 accept
+    if (config_.defer_accept_s > 0) {
+        setsockopt(sockfd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &config_.defer_accept_s,
+                   sizeof(config_.defer_accept_s));
+    }
+    // TFO：带 cookie 的客户端在 SYN 中携带请求，省掉一个 RTT
+    if (config_.fastopen_queue > 0 &&
+        setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN, &config_.fastopen_queue,
+                   sizeof(config_.fastopen_queue)) < 0 &&
+        id_ == 0) {
+        std::cerr << "TCP_FASTOPEN: " << strerror(errno) << std::endl;
+    }
+    // 套接字级忙轮询，accept 出来的连接继承这两个选项
+    // 提高 SO_BUSY_POLL 超过 net.core.busy_read 需要 CAP_NET_ADMIN，失败时只剩用户态自旋
+    if (config_.busy_poll_us > 0) {
+        int usecs = static_cast<int>(config_.busy_poll_us);
+        if (setsockopt(sockfd, SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof(usecs)) < 0 &&
+            id_ == 0) {
+            std::cerr << "SO_BUSY_POLL: " << strerror(errno) << std::endl;
+        }
+        setsockopt(sockfd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &opt, sizeof(opt));
+    }
+}
 
-    struct sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(config_.port);
+void Worker::enableEpollBusyPoll() {
+    struct epoll_params params{};
+    params.busy_poll_usecs = config_.busy_poll_us;
+    params.busy_poll_budget = 8;
+    params.prefer_busy_poll = 1;
+    if (ioctl(epoll_fd_, EPIOCSPARAMS, &params) < 0 && id_ == 0) {
+        std::cerr << "EPIOCSPARAMS: " << strerror(errno) << std::endl;
+    }
+}
 
-    if (bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
-        close(sockfd);
-        return -1;
+uint64_t Worker::cpuTimeNs() const {
+    if (!cpu_clock_ready_.load(std::memory_order_acquire))
+        return 0;
+    struct timespec ts;
+    if (clock_gettime(cpu_clock_, &ts) < 0)
+        return 0;
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// 决定下一次 epoll_wait 的超时。忙轮询模式下有事件就继续 0 超时轮询，
+// 连续空轮询超过预算后退回阻塞等待；自旋期间等到了事件说明自旋有效，预算翻倍，
+// 自旋落空则预算减半，负载下降时自动少占 CPU
+int Worker::nextPollTimeout(int events) {
+    if (!spinning_) {
+        blocking_waits_.store(blocking_waits_.load(std::memory_order_relaxed) + 1,
+                              std::memory_order_relaxed);
+        if (config_.busy_poll_us == 0 || events == 0)
+            return BLOCK_TIMEOUT_MS;
+        spinning_ = true;
+        spin_start_ns_ = 0;
+        return 0;
     }
-    if (listen(sockfd, SOMAXCONN) < 0) {
-        close(sockfd);
-        return -1;
+
+    uint64_t max_ns = static_cast<uint64_t>(config_.busy_poll_us) * 1000;
+    if (events > 0) {
+        if (spin_start_ns_ != 0)
+            spin_budget_ns_ = std::min(spin_budget_ns_ * 2, max_ns);
+        spin_start_ns_ = 0;
+        return 0;
     }
-    return sockfd;
+
+    busy_polls_.store(busy_polls_.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+    uint64_t now_ns = monotonicNs();
+    if (spin_start_ns_ == 0) {
+        spin_start_ns_ = now_ns;
+        return 0;
+    }
+    if (now_ns - spin_start_ns_ < spin_budget_ns_)
+        return 0;
+    spin_budget_ns_ = std::max(spin_budget_ns_ / 2, max_ns / 16);
+    spinning_ = false;
+    return BLOCK_TIMEOUT_MS;
 }
 
 // 主事件循环
@@ -83,40 +362,60 @@ int Worker::createListenSocket() {
 void Worker::run() {
     std::vector<struct epoll_event> events(config_.max_events);
     auto last_idle_check = std::chrono::steady_clock::now();
+    last_load_tick_ = last_idle_check;
+    int timeout = BLOCK_TIMEOUT_MS;
 
+    if (pthread_getcpuclockid(pthread_self(), &cpu_clock_) == 0) {
+        cpu_clock_ready_.store(true, std::memory_order_release);
+    }
+#if HPHS_COROUTINES
+    FramePool::current() = &frames_;
+    scratch_.resize(65536);
+#endif
+
+    LazyCache *lazy = cache_.lazy();
+    if (lazy)
+        lazy->online(id_);
     while (running_) {
         // 获取当前时间
         auto now = std::chrono::steady_clock::now();
+        // 上一轮拿到的按需缓存条目都已不再引用
+        if (lazy)
+            lazy->quiescent(id_);
 
-        int n = epoll_wait(epoll_fd_, events.data(), config_.max_events, 100);
+#if HPHS_COROUTINES
+        timeout = timerTimeout(timeout);
+#endif
+        int n = transport_->epollWait(epoll_fd_, events.data(), config_.max_events, timeout);
+        addRelaxed(syscalls_.epoll_wait, 1);
 
         if (n < 0) {
             if (errno == EINTR)
                 continue;
             break;
         }
+        timeout = nextPollTimeout(n);
+        // 一次唤醒取一次时间，本批事件共用（后处理的事件计入了排队时间）
+        if (n > 0 && config_.latency_stats) {
+            event_ns_ = monotonicNs();
+        }
+        if (n > 0 && limiter_)
+            limiter_now_ = limiter_->clock();
 
-        for (int i = 0; i < n; ++i) {
-            uint32_t ev = events[i].events;
+        dispatchEvents(events.data(), n, now);
+        if (state_.load(std::memory_order_relaxed) == State::DRAINING && drain(now))
+            break;
 
-            // 通过 data.ptr 判断：nullptr = listen_fd，否则是 Connection*
-            if (events[i].data.ptr == nullptr) {
-                handleAccept();
-            } else {
-                Connection *conn =
-                    static_cast<Connection *>(events[i].data.ptr);
-                if (ev & (EPOLLERR | EPOLLHUP)) {
-                    closeConnection(conn);
-                }
-                if ((ev & EPOLLIN) && conn->state() != ConnectionState::CLOSING) {
-                    handleRead(conn, now);
-                }
-                if (ev & EPOLLOUT) {
-                    handleWrite(conn, now);
-                }
-            }
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(now - last_load_tick_)
+                .count() >= (config_.rebalance_ms > 0 ? config_.rebalance_ms : LOAD_TICK_MS)) {
+            updateLoad(now);
         }
 
+#if HPHS_COROUTINES
+        runTimers(now);
+        // 协程模式下空闲超时由每次等待的截止时间处理
+        if (config_.coroutines) continue;
+#endif
         // 每5秒查看空闲连接
         if (std::chrono::duration_cast<std::chrono::seconds>(now -
                                                              last_idle_check)
@@ -126,19 +425,137 @@ void Worker::run() {
         }
     }
     // 清理所有活跃连接
-    for (Connection *conn : active_conns_) {
-        if (conn) {
-            close(conn->fd());
-            conn_pool_.release(conn);
+    conns_.forEach([this](Connection *conn) {
+#if HPHS_COROUTINES
+        destroyCoroutine(conn);
+#endif
+        transport_->close(conn->fd());
+        conns_.release(conn);
+    });
+    connection_count_.store(0, std::memory_order_relaxed);
+    if (lazy)
+        lazy->offline(id_);
+    releaseResources();
+    state_.store(State::STOPPED, std::memory_order_release);
+}
+
+bool Worker::attachConnection(int fd) {
+    Connection *conn = registerConnection(fd);
+#if HPHS_COROUTINES
+    if (conn && config_.coroutines) serveConnection(conn);
+#endif
+    return conn != nullptr;
+}
+
+// 事件循环一轮的简化版：没有忙轮询、负载统计和空闲检查。
+// 按需缓存：进入时登记上线，返回前下线。两次 poll 之间不持有任何条目（写阻塞的响应已复制，
+// 与 run() 每轮的静止点相同），调用方停止 poll 后也不会拖住其他 Worker 的回收
+int Worker::poll(int timeout_ms) {
+    LazyCache *lazy = cache_.lazy();
+    if (lazy)
+        lazy->online(id_);
+    int n = pollEvents(timeout_ms);
+    if (lazy)
+        lazy->offline(id_);
+    return n;
+}
+
+int Worker::pollEvents(int timeout_ms) {
+    struct epoll_event events[64];
+    int n = transport_->epollWait(epoll_fd_, events, 64, timeout_ms);
+    addRelaxed(syscalls_.epoll_wait, 1);
+    // 邮箱的 eventfd 不在内存传输层中，直接看唤醒标记
+    if (!socketTransport() && mailbox_.notified() && n >= 0 && n < 64) {
+        events[n].events = EPOLLIN;
+        events[n].data.u64 = MAILBOX_TAG;
+        ++n;
+    }
+    if (n <= 0)
+        return n;
+    auto now = std::chrono::steady_clock::now();
+    if (config_.latency_stats)
+        event_ns_ = monotonicNs();
+    if (limiter_)
+        limiter_now_ = limiter_->clock();
+    dispatchEvents(events, n, now);
+#if HPHS_COROUTINES
+    runTimers(now);
+#endif
+    return n;
+}
+
+void Worker::dispatchEvents(const struct epoll_event *events, int n,
+                            const std::chrono::steady_clock::time_point &now) {
+    for (int i = 0; i < n; ++i) {
+        uint32_t ev = events[i].events;
+
+        // 通过 data.u64 判断：特殊标记为 eventfd / 监听套接字，否则是连接槽位 + generation
+        uint64_t tag = events[i].data.u64;
+        if (tag == MAILBOX_TAG) {
+            handleMessages(now);
+        } else if (tag < LISTEN_TAG_BASE + listeners_.size()) {
+            const ListenSocket &ls = listeners_[tag - LISTEN_TAG_BASE];
+            handleAccept(ls.fd, ls.tcp, now);
+        } else {
+            // 本批前面的事件已关闭该连接时 find 返回 nullptr
+            Connection *conn = conns_.find(tag);
+            if (!conn)
+                continue;
+            int fd = conn->fd();
+            // 零拷贝完成通知同样以 EPOLLERR 送达，取完错误队列后连接可能仍然正常
+            if ((ev & EPOLLHUP) ||
+                ((ev & EPOLLERR) && !drainErrorQueue(*conn))) {
+                closeConnection(conn, (ev & EPOLLERR) ? CloseReason::ERROR
+                                                      : CloseReason::PEER);
+                continue;
+            }
+#if HPHS_COROUTINES
+            // 升级为 WebSocket 的连接已结束协程，与状态机走同一条帧处理路径
+            if (config_.coroutines && conn->state() != ConnectionState::WEBSOCKET) {
+                wakeCoroutine(conn, ev, now);
+                continue;
+            }
+#endif
+            if (ev & EPOLLIN) {
+                handleRead(conn, now, !(ev & EPOLLRDHUP));
+            }
+            // handleRead 中可能已经关闭并归还了连接
+            if ((ev & EPOLLOUT) && conn->fd() == fd) {
+                if (conn->state() == ConnectionState::WRITING) {
+                    handleWrite(conn, now);
+                    resumeRead(conn, now);
+                } else if (conn->state() == ConnectionState::WEBSOCKET &&
+                           !flushWebSocket(*conn)) {
+                    closeConnection(conn, CloseReason::WEBSOCKET);
+                }
+            }
         }
     }
-    active_conns_.clear();
 }
 
-void Worker::handleAccept() {
+// 从连接表获取槽位并注册 epoll，失败时关闭 fd
+Connection *Worker::registerConnection(int fd) {
+    Connection *conn = conns_.acquire(fd);
+    if (!addToEpoll(fd, conn_events_, conn)) {
+        transport_->close(fd);
+        conns_.release(conn);
+        return nullptr;
+    }
+    conn->timing().accept_ns = event_ns_;
+    connection_count_.store(conns_.size(), std::memory_order_relaxed);
+    return conn;
+}
+
+void Worker::handleAccept(int listen_fd, bool tcp,
+                          const std::chrono::steady_clock::time_point &now) {
+    // 延迟 accept 或 TFO 下新连接通常已带着请求，accept 后直接读，不等下一轮 epoll_wait
+    bool read_now = tcp && (config_.defer_accept_s > 0 || config_.fastopen_queue > 0);
     while (true) {
-        int client_fd =
-            accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(addr);
+        int client_fd = transport_->accept(listen_fd, reinterpret_cast<sockaddr *>(&addr),
+                                           &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        addRelaxed(syscalls_.accept, 1);
         if (client_fd < 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK)
                 break;
@@ -148,27 +565,49 @@ void Worker::handleAccept() {
             break;
         }
 
-        int flag = 1;
-        setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
-
-        // 从对象池获取连接
-        Connection *conn = conn_pool_.acquire(client_fd);
+        PeerKey peer;
+        if (limiter_ && tcp) {
+            peer = PeerKey::fromAddress(addr);
+            if (limiter_->limitsConnections() &&
+                !limiter_->allowConnection(peer, limiter_now_)) {
+                rejectConnection(client_fd);
+                continue;
+            }
+        }
 
-        // 先尝试添加到 epoll
-        if (!addToEpoll(client_fd, EPOLLIN | EPOLLET, conn)) {
-            close(client_fd);
-            conn_pool_.release(conn);
+        Connection *conn = registerConnection(client_fd);
+        if (!conn)
+            continue;
+        HPHS_PROBE(accept, client_fd, id_);
+        conn->cold().peer = peer;
+#if HPHS_COROUTINES
+        if (config_.coroutines) {
+            serveConnection(conn);
             continue;
         }
+#endif
+        if (read_now)
+            handleRead(conn, now, true);
+    }
+}
 
-        // 添加到活跃列表，并记录索引
-        conn->setPoolIndex(active_conns_.size());
-        active_conns_.push_back(conn);
+// 超过连接速率的新连接：按配置回 429 后关闭，或直接 RST，不占用连接槽位
+void Worker::rejectConnection(int fd) {
+    HPHS_PROBE(close, fd, static_cast<int>(CloseReason::RATE_LIMITED), 0);
+    if (config_.rate_limit_close) {
+        struct linger lg = {1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    } else {
+        const std::string &response = RateLimiter::tooManyRequests(false);
+        transport_->write(fd, response.data(), response.size());
+        addRelaxed(syscalls_.write, 1);
     }
+    transport_->close(fd);
 }
 
 void Worker::handleRead(Connection *conn,
-                        const std::chrono::steady_clock::time_point &now) {
+                        const std::chrono::steady_clock::time_point &now,
+                        bool fresh_edge) {
     if (!conn) return;
 
     conn->updateActivity(now);
@@ -176,23 +615,52 @@ void Worker::handleRead(Connection *conn,
 
     char stack_buffer[65536];
     while (true) {
-        ssize_t bytes = read(fd, stack_buffer, sizeof(stack_buffer));
+        if (conn->state() == ConnectionState::WEBSOCKET) {
+            handleWebSocketRead(conn, now);
+            return;
+        }
+
+        // 上传走 splice：socket 中的请求体不读入用户态
+        if (conn->state() == ConnectionState::READING_BODY &&
+            conn->body().useSplice()) {
+            int r = spliceBody(*conn);
+            if (r < 0) {
+                closeConnection(conn, CloseReason::ERROR);
+                return;
+            }
+            if (r == 0)
+                return;
+            handleWrite(conn, now);
+            if (conn->fd() != fd || conn->busy())
+                return;
+            continue;
+        }
+
+        ssize_t bytes = transport_->read(fd, stack_buffer, sizeof(stack_buffer));
+        addRelaxed(syscalls_.read, 1);
         if (bytes < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // 上一个响应写完后回到这里时，缓冲区中可能还有流水线请求
+                processBuffered(conn, now);
                 break;
-            closeConnection(conn);
+            }
+            closeConnection(conn, CloseReason::ERROR);
             return;
         } else if (bytes == 0) {
-            closeConnection(conn);
+            closeConnection(conn, CloseReason::PEER);
             return;
         }
+        if (conn->timing().start_ns == 0) {
+            conn->timing().start_ns = event_ns_;
+        }
         // conn->appendRead(buffer, bytes);
 
         // 快速通道
         char* current_ptr = stack_buffer;
         size_t remaining = bytes;
 
-        if(conn->readBuffer().empty()){
+        // 等待 IO 或写出中的连接只缓存数据，保证流水线请求按序响应
+        if(conn->readBuffer().empty() && !conn->busy()){
             while(remaining > 0){
                 size_t consumed = processRequest(*conn, std::string_view(current_ptr, remaining));
 
@@ -200,13 +668,25 @@ void Worker::handleRead(Connection *conn,
                     current_ptr += consumed;
                     remaining -= consumed;
 
+                    if(conn->state() == ConnectionState::WAITING_IO){
+                        if(remaining > 0){
+                            conn->appendRead(current_ptr, remaining);
+                        }
+                        goto loop_end;
+                    }
                     if(conn->state() == ConnectionState::WRITING){
                         handleWrite(conn, now);
+                        // 非 keep-alive 响应写完后连接已被关闭归还
+                        if(conn->fd() != fd) return;
                         // 如果在写，剩下的数据存入缓存等待下一次处理
-                        if(conn->state() == ConnectionState::WRITING){
+                        if(conn->busy()){
                             if(remaining > 0){
                                 conn->appendRead(current_ptr, remaining);
                             }
+                            // 升级为 WebSocket：紧跟握手的帧按 WebSocket 处理
+                            if(conn->state() == ConnectionState::WEBSOCKET){
+                                handleWebSocketRead(conn, now);
+                            }
                             goto loop_end;
                         }
                     }
@@ -223,20 +703,13 @@ void Worker::handleRead(Connection *conn,
         }
 
         // 慢速通道
-        while (conn->readBuffer().size() > 0) {
-            if(conn->state() == ConnectionState::WRITING) break;
-
-            size_t consumed = processRequest(*conn);
-            if (consumed == 0) break;
-            conn->consumeReadBuffer(consumed);
-
-            // 如果设置了WRITING，执行写入
-            if (conn->state() == ConnectionState::WRITING) {
-                handleWrite(conn, now);
-                // 如果写入未完成，等待EPOLLOUT
-                if(conn->state() == ConnectionState::WRITING) break;
-            }
-        }
+        if (!processBuffered(conn, now)) return;
+        if (conn->state() == ConnectionState::WEBSOCKET) continue;
+
+        // 边沿触发下读到的数据少于缓冲区说明接收队列已空，之后到达的数据会产生新的边沿，
+        // 省掉一次必然 EAGAIN 的 read；对端已关闭写方向（EPOLLRDHUP）时不会再有边沿，仍需读到 0
+        if (fresh_edge && static_cast<size_t>(bytes) < sizeof(stack_buffer))
+            break;
     }
 
 loop_end:
@@ -244,6 +717,38 @@ loop_end:
 
 }
 
+// 处理读缓冲区中已有的请求，返回 false 表示连接已关闭归还
+bool Worker::processBuffered(Connection *conn,
+                             const std::chrono::steady_clock::time_point &now) {
+    int fd = conn->fd();
+    while (conn->readBuffer().size() > 0) {
+        if(conn->busy()) break;
+
+        size_t consumed = processRequest(*conn);
+        if (consumed == 0) break;
+        conn->consumeReadBuffer(consumed);
+
+        // 如果设置了WRITING，执行写入
+        if (conn->state() == ConnectionState::WRITING) {
+            handleWrite(conn, now);
+            if (conn->fd() != fd) return false;
+            // 如果写入未完成，等待EPOLLOUT
+            if(conn->busy()) break;
+        }
+    }
+    return true;
+}
+
+// 响应在事件循环外完成（EPOLLOUT、IO 完成、splice 上传）后恢复读取：
+// 先处理缓冲区中的流水线请求，再把 socket 读到 EAGAIN
+void Worker::resumeRead(Connection *conn,
+                        const std::chrono::steady_clock::time_point &now) {
+    if (conn->fd() >= 0 && (conn->state() == ConnectionState::READING ||
+                            conn->state() == ConnectionState::WEBSOCKET)) {
+        handleRead(conn, now);
+    }
+}
+
 size_t Worker::processRequest(Connection &conn, std::string_view data) {
     
     std::string_view view_to_parse;
@@ -253,74 +758,433 @@ size_t Worker::processRequest(Connection &conn, std::string_view data) {
         view_to_parse = conn.readBuffer();
     }
 
+    // 正在接收请求体：数据直接流向 sink，不进入请求解析
+    if (conn.state() == ConnectionState::READING_BODY) {
+        return consumeBody(conn, view_to_parse);
+    }
+
+    // 与之前某个请求逐字节相同的请求头：直接使用上次的结果。
+    // 访问日志需要解析出的字段，请求限流的 429 取决于请求本身的 keep-alive，这两种情况走完整路径
+    RawRequestCache::Hit hit;
+    if (raw_cache_.enabled() && !access_log_ &&
+        !(limiter_ && limiter_->limitsRequests()) &&
+        raw_cache_.lookup(view_to_parse, hit)) {
+        ++request_count_;
+        HPHS_PROBE(request, conn.fd(), static_cast<int>(hit.method), hit.target.data(),
+                   hit.target.size());
+        if (config_.latency_stats) {
+            recordParsed(conn);
+        }
+        conn.setCachedResponse(hit.response);
+        conn.setKeepAlive(hit.keep_alive);
+        conn.setState(ConnectionState::WRITING);
+        if (hit.cached) {
+            addRelaxed(cache_hits_, 1);
+            HPHS_PROBE(cache_hit, conn.fd(), hit.target.data(), hit.target.size());
+        }
+        addRelaxed(raw_hits_, 1);
+        return hit.length;
+    }
+
     HttpRequest request;
 
     if (!request.parse(view_to_parse)) {
 
         // 解析失败两种可能：1.数据不够， 2.格式错误
-        if (conn.readBuffer().size() > 10 * 1024 * 1024) {
-            HttpResponse response;
-            response.setStatusCode(400);
-            response.setBody(
-                "<html><body><h1>400 Bad Request</h1></body></html>");
-            response.setContentType("text/html");
-            response.setKeepAlive(false);
-
-            conn.setWriteBuffer(response.build());
-            conn.setState(ConnectionState::WRITING);
-            conn.setKeepAlive(false);
-            // modifyEpoll(conn.fd(), EPOLLOUT | EPOLLET, &conn);
-            // handleWrite(&conn, std::chrono::steady_clock::now());
-            return 0;
+        if (request.headerComplete() ||
+            view_to_parse.size() > config_.max_header_size) {
+            setErrorResponse(conn, 400);
+            return view_to_parse.size();
         }
 
         return 0;
     }
+
+    // 路由优先于上传和静态文件。路由不流式接收请求体，小请求体等整体到达后再处理，
+    // 在计数和限流之前返回，避免重新解析时重复记账
+    Router::Match match;
+    if (!router_.empty()) {
+        match = router_.match(request.method(), request.path());
+        if (match.route && request.hasBody() && !request.chunked() &&
+            request.contentLength() <= config_.max_header_size &&
+            view_to_parse.size() - request.parseLength() < request.contentLength()) {
+            // 请求体一个字节都还没到时才发 100，等待期间请求头会被重复解析，只发一次
+            if (request.expectContinue() && !conn.body().continue_sent &&
+                view_to_parse.size() == request.parseLength()) {
+                conn.body().continue_sent = true;
+                sendContinue(conn);
+                if (conn.state() == ConnectionState::WRITING)
+                    return view_to_parse.size();
+            }
+            return 0;
+        }
+    }
+
     ++request_count_;
+    HPHS_PROBE(request, conn.fd(), static_cast<int>(request.method()),
+               request.path().data(), request.path().size());
+    if (config_.latency_stats) {
+        recordParsed(conn);
+    }
 
-    // 优先查缓存（避免 stat 和文件读取）
-    if (request.method() == HttpRequest::GET ||
-        request.method() == HttpRequest::HEAD) {
-        const CacheEntry *cached = cache_.find(request.path());
-        if (cached) {
-            // 缓存命中：直接使用预构建的响应
-            conn.setCachedResponse(&cached->response);
+    if (access_log_ && access_log_->sampled(log_counter_)) {
+        beginAccessLog(conn, request);
+    }
+
+    // 超过请求速率：回预构建的 429。带请求体时不读请求体，写完即关闭
+    if (limiter_ && limiter_->limitsRequests() &&
+        !limiter_->allowRequest(conn.cold().peer, limiter_now_)) {
+        bool keep_alive = !config_.rate_limit_close && !request.hasBody() &&
+                          request.keepAlive();
+        conn.setCachedResponse(RateLimiter::tooManyRequests(keep_alive));
+        conn.setKeepAlive(keep_alive);
+        conn.setState(ConnectionState::WRITING);
+        return keep_alive ? request.parseLength() : view_to_parse.size();
+    }
+
+    // 带请求体的请求：命中路由时整体交给 handler，chunked 或超过请求头上限的回 413；
+    // 其余先回复还是先收完由 beginBody 决定
+    if (request.hasBody()) {
+        if (match.route) {
+            if (request.chunked() || request.contentLength() > config_.max_header_size) {
+                setErrorResponse(conn, 413);
+                return view_to_parse.size();
+            }
+            conn.body().continue_sent = false;
+            request.setBody(view_to_parse.substr(request.parseLength(), request.contentLength()));
+            dispatchRoute(conn, request, match);
+            return request.parseLength() + request.contentLength();
+        }
+        beginBody(conn, request);
+        return request.parseLength();
+    }
+
+    if (!router_.empty()) {
+        if (match.route || match.not_allowed) {
+            dispatchRoute(conn, request, match);
+            // 静态路由的响应在路由表中，与缓存响应一样不变
+            if (match.route && match.route->websocket < 0 && !match.route->response.empty()) {
+                raw_cache_.insert(view_to_parse.substr(0, request.parseLength()),
+                                  match.route->response, true, false,
+                                  static_cast<uint8_t>(request.method()));
+            }
+            return request.parseLength();
+        }
+    }
+
+    // 优先查缓存（避免 stat 和文件读取）；query 中有未忽略的参数时直接读文件
+    bool cacheable = (request.method() == HttpRequest::GET ||
+                      request.method() == HttpRequest::HEAD) &&
+                     (request.query().empty() || cacheableQuery(request.query()));
+    if (cacheable) {
+        std::string_view cached = cache_.find(request.path());
+        if (cached.data()) {
             conn.setKeepAlive(true); // 缓存响应默认 keep-alive
             conn.setState(ConnectionState::WRITING);
-            // modifyEpoll(conn.fd(), EPOLLOUT | EPOLLET, &conn);
-            // handleWrite(&conn, std::chrono::steady_clock::now());
+            addRelaxed(cache_hits_, 1);
+            HPHS_PROBE(cache_hit, conn.fd(), request.path().data(), request.path().size());
+            // 条件请求：ETag 匹配时回 304，响应取决于 If-None-Match，不记入原始请求头缓存
+            if (!request.ifNoneMatch().empty() &&
+                notModified(conn, cached, request.ifNoneMatch())) {
+                return request.parseLength();
+            }
+            // 缓存命中：直接使用预构建的响应
+            conn.setCachedResponse(cached);
+            // 预加载和快照模式下响应在进程生命周期内不变，按需模式的条目可能被淘汰，不记录
+            if (!cache_.lazy()) {
+                raw_cache_.insert(view_to_parse.substr(0, request.parseLength()), cached, true,
+                                  true, static_cast<uint8_t>(request.method()));
+            }
             return request.parseLength();
         }
+        addRelaxed(cache_misses_, 1);
+        HPHS_PROBE(cache_miss, conn.fd(), request.path().data(), request.path().size());
     }
 
-    // 缓存未命中，走原来的逻辑
-    HttpResponse response;
+    // 按需缓存：频率草图认为值得缓存时读入整个文件并写入缓存
+    bool fill = cacheable && cache_.wantFill(request.path());
+
+    // 缓存未命中：有 IO 线程池时 stat/open/read 交给 IO 线程，连接挂起等待完成
+    if (io_pool_ && (request.method() == HttpRequest::GET ||
+                     request.method() == HttpRequest::HEAD)) {
+        submitStaticFile(conn, request, fill);
+        return request.parseLength();
+    }
+    if (fill && fillCacheSync(conn, request.path())) {
+        return request.parseLength();
+    }
+
+    // 同步模式，走原来的逻辑
+    bool keep_alive = request.keepAlive();
+    conn.setKeepAlive(keep_alive);
     if (request.method() == HttpRequest::GET ||
         request.method() == HttpRequest::HEAD) {
-        serveStaticFile(request.path(), response);
+        serveStaticFile(conn, request.path(), keep_alive);
     } else {
-        response.setStatusCode(405);
-        response.setBody(
-            "<html><body><h1>405 Method Not Allowed</h1></body></html>");
-        response.setContentType("text/html");
+        conn.setCachedResponse(HttpResponse::prebuiltError(405, keep_alive));
+    }
+    conn.setState(ConnectionState::WRITING);
+
+    return request.parseLength();
+}
+
+// 路由分发：静态路由和 405 与缓存命中一样直接引用预构建响应，
+// 动态路由写入连接自身的写缓冲区（随连接复用，预热后不分配）
+void Worker::dispatchRoute(Connection &conn, const HttpRequest &request,
+                           const Router::Match &match) {
+    conn.setState(ConnectionState::WRITING);
+    if (match.not_allowed) {
+        conn.setCachedResponse(*match.not_allowed);
+        conn.setKeepAlive(true);
+        return;
+    }
+
+    const Router::Route &route = *match.route;
+    if (route.websocket >= 0) {
+        if (!beginWebSocket(conn, request, static_cast<uint32_t>(route.websocket)))
+            setErrorResponse(conn, 400);
+        return;
+    }
+    if (!route.response.empty()) {
+        conn.setCachedResponse(route.response);
+        conn.setKeepAlive(true);
+        return;
     }
 
     bool keep_alive = request.keepAlive();
-    response.setKeepAlive(keep_alive);
+    ResponseWriter writer(conn.writeBuffer());
+    route.handler(request, writer);
+    conn.setWriteOffset(writer.finish(keep_alive));
     conn.setKeepAlive(keep_alive);
+}
 
-    if (response.useSendfile()) {
-        conn.setWriteBuffer(response.build());
-        conn.setSendfile(response.getSendfilePath(),
-                         response.getSendfileSize());
+static uint64_t clockNs(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+void Worker::beginAccessLog(Connection &conn, const HttpRequest &request) {
+    AccessLogRecord &r = conn.logRecord();
+    std::string_view path = request.target();
+    size_t len = std::min(path.size(), sizeof(r.path));
+
+    r.timestamp_ns = clockNs(CLOCK_REALTIME);
+    r.method = static_cast<uint8_t>(request.method());
+    r.worker = static_cast<uint8_t>(id_);
+    r.path_len = static_cast<uint8_t>(len);
+    r.path_truncated = path.size() > len;
+    r.path_hash = r.path_truncated
+                      ? AccessLogger::hashPath(path.data(), path.size())
+                      : 0;
+    memcpy(r.path, path.data(), len);
+    conn.beginLog(clockNs(CLOCK_MONOTONIC));
+}
+
+void Worker::commitAccessLog(Connection &conn) {
+    AccessLogRecord &r = conn.logRecord();
+    r.latency_us = static_cast<uint32_t>(
+        (clockNs(CLOCK_MONOTONIC) - conn.logStartNs()) / 1000);
+    access_log_->ring(id_).push(r);
+    conn.endLog();
+}
+
+void Worker::recordParsed(Connection &conn) {
+    RequestTiming &t = conn.timing();
+    uint64_t now_ns = monotonicNs();
+    // 流水线中后续的请求在前一个响应写完后才开始计时
+    if (t.start_ns == 0) t.start_ns = event_ns_;
+    latency_.parse.record(now_ns - t.start_ns);
+    if (t.requests++ == 0 && t.accept_ns != 0) {
+        latency_.first_request.record(now_ns - t.accept_ns);
+    }
+}
+
+// 错误响应都是预构建的（Connection: close），不分配
+void Worker::setErrorResponse(Connection &conn, int status) {
+    conn.resetBody();
+    conn.writeBuffer().clear();
+    conn.setWriteOffset(0);
+    conn.setCachedResponse(HttpResponse::prebuiltError(status, false));
+    conn.setState(ConnectionState::WRITING);
+    conn.setKeepAlive(false);
+}
+
+// 100 Continue 只有 25 字节，且处理请求时连接上没有未写完的响应，直接写出。
+// EAGAIN 时客户端等到自己的超时后照常发送请求体；只写出一部分时响应流已损坏，回错误并关闭
+void Worker::sendContinue(Connection &conn) {
+    static constexpr std::string_view CONTINUE = "HTTP/1.1 100 Continue\r\n\r\n";
+    ssize_t n = transport_->write(conn.fd(), CONTINUE.data(), CONTINUE.size());
+    addRelaxed(syscalls_.write, 1);
+    if (n > 0 && static_cast<size_t>(n) < CONTINUE.size())
+        setErrorResponse(conn, 500);
+}
+
+// 请求体处理
+// 带 Expect: 100-continue 时，要读取请求体才回 100 Continue；一开始就拒绝的请求（413、405、500）
+// 直接回最终响应并关闭，不再等待请求体
+// PUT 且配置了 upload_root 时先写入 upload_root 下的临时文件，收完再 rename 到目标路径，
+// 中途失败不会留下截断的文件；其余请求体直接丢弃
+// Content-Length 上传走 splice(socket -> pipe -> file)，数据不经过用户态
+void Worker::beginBody(Connection &conn, const HttpRequest &request) {
+    if (!request.chunked() && request.contentLength() > config_.max_body_size) {
+        setErrorResponse(conn, 413);
+        return;
+    }
+
+    BodyState &body = conn.body();
+    body.reset();
+    conn.setKeepAlive(request.keepAlive());
+
+    if (request.method() == HttpRequest::PUT && !config_.upload_root.empty()) {
+        std::string_view path = request.path();
+        if (path.empty() || path[0] != '/' || path.back() == '/' ||
+            path.find("..") != std::string_view::npos) {
+            setErrorResponse(conn, 400);
+            return;
+        }
+        body.target_path = config_.upload_root + std::string(path);
+        body.temp_path = config_.upload_root + "/.hphs-upload-XXXXXX";
+        body.sink_fd = mkostemp(&body.temp_path[0], O_CLOEXEC);
+        if (body.sink_fd >= 0) {
+            fchmod(body.sink_fd, 0644);
+        } else {
+            body.temp_path.clear();
+            if (request.expectContinue()) {
+                setErrorResponse(conn, 500);
+                return;
+            }
+        }
+        body.status = body.sink_fd >= 0 ? 201 : 500;
     } else {
-        conn.setWriteBuffer(response.build());
+        body.status = 405;
+        // 丢弃的请求体较大或客户端还在等 100 时不再读取，回复后直接关闭连接
+        if (request.chunked() || request.expectContinue() ||
+            request.contentLength() > config_.max_header_size) {
+            setErrorResponse(conn, 405);
+            return;
+        }
+    }
+
+    if (request.chunked()) {
+        body.mode = BodyState::CHUNKED;
+    } else {
+        body.mode = BodyState::LENGTH;
+        body.remaining = request.contentLength();
+        if (body.sink_fd >= 0 && socketTransport() &&
+            pipe2(body.pipe_fd, O_NONBLOCK | O_CLOEXEC) < 0) {
+            body.pipe_fd[0] = body.pipe_fd[1] = -1;  // 退化为 read + write
+        }
     }
+    if (request.expectContinue()) {
+        sendContinue(conn);
+        if (conn.state() == ConnectionState::WRITING)
+            return;
+    }
+    conn.setState(ConnectionState::READING_BODY);
+}
+
+size_t Worker::consumeBody(Connection &conn, std::string_view data) {
+    BodyState &body = conn.body();
+
+    auto sink = [&](const char *p, size_t len) {
+        body.received += len;
+        if (body.received > config_.max_body_size) return false;
+        while (body.sink_fd >= 0 && len > 0 && !body.write_failed) {
+            ssize_t n = write(body.sink_fd, p, len);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                body.write_failed = true;
+                break;
+            }
+            p += n;
+            len -= n;
+        }
+        return true;
+    };
+
+    size_t consumed = 0;
+    if (body.mode == BodyState::LENGTH) {
+        consumed = std::min<uint64_t>(data.size(), body.remaining);
+        sink(data.data(), consumed);
+        body.remaining -= consumed;
+        if (body.remaining == 0) finishBody(conn);
+    } else {
+        consumed = body.chunked.feed(data.data(), data.size(), sink);
+        if (body.chunked.error()) {
+            setErrorResponse(conn, body.received > config_.max_body_size ? 413 : 400);
+            return data.size();
+        }
+        if (body.chunked.done()) finishBody(conn);
+    }
+    return consumed;
+}
+
+// 返回 1 表示请求体接收完毕，0 表示等待更多数据，-1 表示出错
+int Worker::spliceBody(Connection &conn) {
+    BodyState &body = conn.body();
+    while (body.remaining > 0) {
+        size_t chunk = std::min<uint64_t>(body.remaining, 65536);
+        ssize_t n = splice(conn.fd(), nullptr, body.pipe_fd[1], nullptr, chunk,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (n == 0)
+            return -1;  // 对端在请求体中途关闭
+
+        // 管道中的数据必须全部落盘，否则会和下一段数据混在一起
+        ssize_t left = n;
+        while (left > 0) {
+            ssize_t m = splice(body.pipe_fd[0], nullptr, body.sink_fd, nullptr,
+                               left, SPLICE_F_MOVE);
+            if (m < 0 && errno == EINTR)
+                continue;
+            if (m <= 0)
+                return -1;
+            left -= m;
+        }
+        body.remaining -= n;
+        body.received += n;
+    }
+    finishBody(conn);
+    return 1;
+}
+
+void Worker::finishBody(Connection &conn) {
+    BodyState &body = conn.body();
+    int status = body.write_failed ? 500 : body.status;
+    if (status == 201) {
+        // 改名成功后临时文件即目标文件，reset 不再删除
+        if (rename(body.temp_path.c_str(), body.target_path.c_str()) == 0) {
+            body.temp_path.clear();
+        } else {
+            status = 500;
+        }
+    }
+    conn.resetBody();
     conn.setState(ConnectionState::WRITING);
-    // modifyEpoll(conn.fd(), EPOLLOUT | EPOLLET, &conn);
-    // handleWrite(&conn, std::chrono::steady_clock::now());
 
-    return request.parseLength();
+    // 丢弃请求体的 405 和写入失败的 500 用预构建响应
+    if (status != 201) {
+        conn.writeBuffer().clear();
+        conn.setWriteOffset(0);
+        conn.setCachedResponse(HttpResponse::prebuiltError(status, conn.keepAlive()));
+        return;
+    }
+
+    HttpResponse response;
+    response.setStatusCode(status);
+    response.setBody("<html><body><h1>" + std::to_string(status) +
+                     "</h1></body></html>");
+    response.setContentType("text/html");
+    response.setKeepAlive(conn.keepAlive());
+
+    conn.setWriteBuffer(response.build());
 }
 
 void Worker::handleWrite(Connection *conn,
@@ -328,83 +1192,181 @@ void Worker::handleWrite(Connection *conn,
     if (!conn) return;
 
     conn->updateActivity(now);
-    int fd = conn->fd();
+    uint64_t done_ns = 0;
+    WriteStatus status = writeBuffers(*conn, done_ns);
+    if (status == WriteStatus::DONE && conn->hasSendfile()) {
+        status = writeFile(*conn);
+    }
+
+    if (status == WriteStatus::AGAIN) {
+        armWritable(*conn);
+        return;
+    }
+    if (status == WriteStatus::ERROR)
+        closeConnection(conn, CloseReason::ERROR);
+    else if (!finishResponse(*conn, done_ns))
+        closeConnection(conn, CloseReason::DONE);
+}
+
+// 写出写缓冲区和预构建响应（writev 合并），不改 epoll 也不关闭连接，
+// 手写状态机和协程共用；done_ns 在一次写完时返回写出时间，供完成耗时复用
+Worker::WriteStatus Worker::writeBuffers(Connection &conn, uint64_t &done_ns) {
+    int fd = conn.fd();
+
+    // 响应第一次写出时记录状态码（"HTTP/1.1 200"）和总字节数
+    if (conn.logPending() && conn.logRecord().status == 0) {
+        const char *head = conn.writeRemaining() > 0 ? conn.writeData()
+                           : conn.hasCachedResponse() ? conn.cachedData()
+                                                      : nullptr;
+        size_t head_len = conn.writeRemaining() > 0 ? conn.writeRemaining()
+                          : conn.hasCachedResponse() ? conn.cachedRemaining()
+                                                     : 0;
+        AccessLogRecord &r = conn.logRecord();
+        r.status = head_len >= 12 ? (head[9] - '0') * 100 +
+                                        (head[10] - '0') * 10 + (head[11] - '0')
+                                  : 0;
+        r.bytes = conn.writeRemaining() +
+                  (conn.hasCachedResponse() ? conn.cachedRemaining() : 0) +
+                  (conn.hasSendfile() ? conn.sendfileSize() - conn.sendfileOffset() : 0);
+    }
+
+    uint64_t write_ns = 0;   // 首字节写出时间，单次写完时同时作为完成时间
+    int writes = 0;
 
     // 使用writev合并发送write_buffer和cached_response
-    while (conn->writeRemaining() > 0 ||
-            (conn->hasCachedResponse() && conn->cachedRemaining() > 0)) {
+    while (conn.writeRemaining() > 0 ||
+            (conn.hasCachedResponse() && conn.cachedRemaining() > 0)) {
         
         struct iovec iov[2];
         int iovcnt = 0;
 
-        if(conn->writeRemaining() > 0){
-            iov[iovcnt].iov_base = const_cast<char*>(conn->writeData());
-            iov[iovcnt].iov_len =  conn->writeRemaining();
+        if(conn.writeRemaining() > 0){
+            iov[iovcnt].iov_base = const_cast<char*>(conn.writeData());
+            iov[iovcnt].iov_len =  conn.writeRemaining();
             iovcnt++;
         }
 
-        if(conn->hasCachedResponse() && conn->cachedRemaining() > 0){
-            iov[iovcnt].iov_base = const_cast<char*>(conn->cachedData());
-            iov[iovcnt].iov_len =  conn->cachedRemaining();
+        if(conn.hasCachedResponse() && conn.cachedRemaining() > 0){
+            iov[iovcnt].iov_base = const_cast<char*>(conn.cachedData());
+            iov[iovcnt].iov_len =  conn.cachedRemaining();
             iovcnt++;
         }
 
 
-        ssize_t sent = writev(fd, iov, iovcnt);
+        // 大的预构建响应走 MSG_ZEROCOPY；响应在只读 arena / 快照映射 / 路由表中，
+        // 进程运行期间不会修改或释放，内核引用期间天然保持不变
+        ssize_t sent;
+        // 按需缓存模式下条目可能被回收，不走零拷贝；sendZerocopy 直接操作套接字，
+        // 内存传输层等非套接字连接走普通 writev
+        if (config_.zerocopy_threshold > 0 && !cache_.lazy() && socketTransport() && iovcnt == 1 &&
+            conn.writeRemaining() == 0 &&
+            conn.cachedRemaining() >= config_.zerocopy_threshold) {
+            sent = sendZerocopy(conn);
+        } else {
+            sent = transport_->writev(fd, iov, iovcnt);
+            addRelaxed(syscalls_.write, 1);
+        }
         if (sent < 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                if(!conn->hasEpollout()){
-                    conn->setHasEpollout(true);
-                    modifyEpoll(fd, EPOLLIN | EPOLLOUT | EPOLLET, conn);
-                }
-                return;
+                HPHS_PROBE(write_again, fd,
+                           conn.writeRemaining() +
+                               (conn.hasCachedResponse() ? conn.cachedRemaining() : 0));
+                if (cache_.lazy() && conn.hasCachedResponse())
+                    pinCachedResponse(conn);
+                return WriteStatus::AGAIN;
             }
-            closeConnection(conn);
-            return;
+            return WriteStatus::ERROR;
+        }
+        ++writes;
+        if (config_.latency_stats && !conn.timing().first_byte &&
+            conn.timing().start_ns != 0) {
+            write_ns = monotonicNs();
+            latency_.first_byte.record(write_ns - conn.timing().start_ns);
+            conn.timing().first_byte = true;
         }
 
         //更新缓冲区偏移
         size_t remaining = sent;
-        if(conn->writeRemaining() > 0){
-            size_t consume = std::min(remaining, conn->writeRemaining());
-            conn->advanceWrite(consume);
+        if(conn.writeRemaining() > 0){
+            size_t consume = std::min(remaining, conn.writeRemaining());
+            conn.advanceWrite(consume);
             remaining -= consume;
         }
-        if(remaining > 0 && conn->hasCachedResponse()){
-            conn->advanceCached(remaining);
+        if(remaining > 0 && conn.hasCachedResponse()){
+            conn.advanceCached(remaining);
         }
     }
 
-    conn->clearCachedResponse();
+    conn.clearCachedResponse();
+    done_ns = writes == 1 ? write_ns : 0;
+    return WriteStatus::DONE;
+}
 
-    // 发送sendfile
-    if (conn->hasSendfile() && !conn->sendfileComplete()) {
-        if (!sendWithSendfile(*conn)) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                modifyEpoll(fd, EPOLLIN | EPOLLOUT | EPOLLET, conn);
-                return;
-            }
-            closeConnection(conn);
-            return;
-        }
-        if (!conn->sendfileComplete())
-            return;
+// 发送 sendfile 部分
+Worker::WriteStatus Worker::writeFile(Connection &conn) {
+    if (conn.sendfileComplete())
+        return WriteStatus::DONE;
+    if (!sendWithSendfile(conn))
+        return WriteStatus::ERROR;
+    return conn.sendfileComplete() ? WriteStatus::DONE : WriteStatus::AGAIN;
+}
+
+// 等待 EPOLLOUT 继续发送；一次注册模式下 EPOLLOUT 始终在订阅中，只记录等待状态
+void Worker::armWritable(Connection &conn) {
+    if (!conn.hasEpollout()) {
+        conn.setHasEpollout(true);
+        if (!config_.epoll_register_once)
+            modifyEpoll(conn.fd(), conn_events_ | EPOLLOUT, &conn);
     }
+}
 
-    if (conn->keepAlive()) {
-        // conn->clearReadBuffer();
-        conn->setWriteBuffer("");
-        conn->setState(ConnectionState::READING);
-        if(conn->readBuffer().size()>0){
-            handleRead(conn, now);
-            return;
-        }
-        modifyEpoll(fd, EPOLLIN | EPOLLET, conn);
-    } else {
-        closeConnection(conn);
+// 只有曾经等待过可写时才需要撤掉 EPOLLOUT
+void Worker::disarmWritable(Connection &conn) {
+    if (conn.hasEpollout()) {
+        conn.setHasEpollout(false);
+        if (!config_.epoll_register_once)
+            modifyEpoll(conn.fd(), conn_events_, &conn);
     }
 }
 
+// 响应写完：提交日志和延迟统计，keep-alive 时回到 READING，返回 false 表示调用方应关闭连接
+bool Worker::finishResponse(Connection &conn, uint64_t done_ns) {
+    HPHS_PROBE(response, conn.fd(), conn.keepAlive());
+    if (conn.logPending()) {
+        commitAccessLog(conn);
+    }
+
+    RequestTiming &timing = conn.timing();
+    if (config_.latency_stats && timing.start_ns != 0) {
+        if (done_ns == 0 || conn.hasSendfile())
+            done_ns = monotonicNs();
+        latency_.complete.record(done_ns - timing.start_ns);
+    }
+    timing.start_ns = 0;
+    timing.first_byte = false;
+
+    if (!conn.keepAlive())
+        return false;
+
+    conn.setWriteBuffer("");
+    conn.setState(ConnectionState::READING);
+    // 缓冲区中剩余的流水线请求由调用方继续处理，这里不递归进入 handleRead
+    disarmWritable(conn);
+    // 101 已写完：之后的数据按 WebSocket 帧处理
+    if (conn.cold().ws)
+        enterWebSocket(conn);
+    return true;
+}
+
+// 按需缓存的条目只保证在本轮事件循环内有效：写不完时把剩余部分转存到连接自己的写缓冲区
+// （路由表中的预构建响应也会被转存，只发生在套接字写满时）
+void Worker::pinCachedResponse(Connection &conn) {
+    std::string rest(conn.writeData(), conn.writeRemaining());
+    rest.append(conn.cachedData(), conn.cachedRemaining());
+    conn.setWriteBuffer(std::move(rest));
+    conn.clearCachedResponse();
+}
+
 bool Worker::sendWithSendfile(Connection &conn) {
 
     if (conn.fileFd() < 0) {
@@ -415,11 +1377,14 @@ bool Worker::sendWithSendfile(Connection &conn) {
         }
         conn.setFileFd(file_fd);
     }
+    if (conn.sendfileOffset() == 0)
+        HPHS_PROBE(sendfile_start, conn.fd(), conn.sendfileSize());
 
     while (conn.sendfileOffset() < conn.sendfileSize()) {
         ssize_t sent =
-            sendfile(conn.fd(), conn.fileFd(), &conn.sendfileOffset(),
-                     conn.sendfileSize() - conn.sendfileOffset());
+            transport_->sendfile(conn.fd(), conn.fileFd(), &conn.sendfileOffset(),
+                                 conn.sendfileSize() - conn.sendfileOffset());
+        addRelaxed(syscalls_.sendfile, 1);
 
         if (sent < 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
@@ -428,80 +1393,425 @@ bool Worker::sendWithSendfile(Connection &conn) {
             conn.closeFileFd();
             return false;
         }
+        if (sent == 0) {
+            // 文件在发送期间被截断，已声明的 Content-Length 无法满足
+            conn.closeFileFd();
+            return false;
+        }
     }
+    HPHS_PROBE(sendfile_done, conn.fd(), conn.sendfileSize());
     conn.closeFileFd();
     return true;
 }
 
-void Worker::serveStaticFile(const std::string &path, HttpResponse &response) {
-    std::string filepath = config_.www_root + path;
-    if (filepath.back() == '/')
-        filepath += "index.html";
+// 返回值与 writev 相同；套接字不支持或 ENOBUFS（optmem 用尽）时退回普通发送
+ssize_t Worker::sendZerocopy(Connection &conn) {
+    ConnectionCold &cold = conn.cold();
+    if (cold.zerocopy == 0) {
+        int one = 1;
+        cold.zerocopy = setsockopt(conn.fd(), SOL_SOCKET, SO_ZEROCOPY, &one,
+                                   sizeof(one)) == 0 ? 1 : -1;
+    }
+    if (cold.zerocopy > 0) {
+        ssize_t n = send(conn.fd(), conn.cachedData(), conn.cachedRemaining(),
+                         MSG_ZEROCOPY);
+        addRelaxed(syscalls_.write, 1);
+        if (n >= 0) {
+            // 每次成功的调用占用一个通知序号，部分发送也一样
+            ++cold.zerocopy_pending;
+            addRelaxed(zerocopy_.sends, 1);
+            addRelaxed(zerocopy_.bytes, n);
+            return n;
+        }
+        if (errno != ENOBUFS)
+            return n;
+    }
+    addRelaxed(zerocopy_.fallbacks, 1);
+    addRelaxed(syscalls_.write, 1);
+    return transport_->write(conn.fd(), conn.cachedData(), conn.cachedRemaining());
+}
+
+// 取出错误队列中的零拷贝完成通知，返回 false 表示存在真正的套接字错误
+bool Worker::drainErrorQueue(Connection &conn) {
+    ConnectionCold &cold = conn.cold();
+    if (cold.zerocopy <= 0)
+        return false;
+
+    char control[128];
+    while (true) {
+        struct msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(conn.fd(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            break;
+
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                  (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+                continue;
+            auto *serr = reinterpret_cast<struct sock_extended_err *>(CMSG_DATA(cm));
+            if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno != 0)
+                return false;
+            // 通知是区间 [ee_info, ee_data]，内核会合并连续的完成
+            uint32_t count = serr->ee_data - serr->ee_info + 1;
+            cold.zerocopy_pending -= std::min(count, cold.zerocopy_pending);
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                addRelaxed(zerocopy_.copied, count);
+            else
+                addRelaxed(zerocopy_.completed, count);
+        }
+    }
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(conn.fd(), SOL_SOCKET, SO_ERROR, &err, &len);
+    return err == 0;
+}
+
+// www_root + path，目录补全 index.html；写入调用方的栈缓冲区，超长时返回 false
+bool Worker::staticFilePath(std::string_view path, char (&out)[PATH_MAX]) const {
+    static constexpr std::string_view INDEX = "index.html";
+    const std::string &root = config_.www_root;
+    bool dir = path.empty() || path.back() == '/';
+    size_t len = root.size() + path.size() + (dir ? INDEX.size() : 0);
+    if (len >= PATH_MAX)
+        return false;
+    memcpy(out, root.data(), root.size());
+    memcpy(out + root.size(), path.data(), path.size());
+    if (dir)
+        memcpy(out + root.size() + path.size(), INDEX.data(), INDEX.size());
+    out[len] = '\0';
+    return true;
+}
+
+void Worker::submitStaticFile(Connection &conn, const HttpRequest &request,
+                              bool fill) {
+    IoTask *task = acquireIoTask();
+    task->kind = config_.use_sendfile ? IoTask::STAT_OPEN : IoTask::READ_FILE;
+    char filepath[PATH_MAX];
+    if (staticFilePath(request.path(), filepath))
+        task->path.assign(filepath);
+    if (fill) {
+        task->fill_limit = cache_.lazy()->maxEntrySize();
+        task->url_path = std::string(request.path());
+    }
+    task->conn = &conn;
+    task->generation = conn.generation();
+    task->completion = &mailbox_;
+
+    conn.setKeepAlive(request.keepAlive());
+    conn.setState(ConnectionState::WAITING_IO);
+    ++io_inflight_;
+    io_pool_->submit(task);
+}
+
+// IO 线程完成的任务在这里转成响应，连接从 WAITING_IO 恢复
+void Worker::handleIoCompletion(
+    IoTask *task, const std::chrono::steady_clock::time_point &now) {
+    --io_inflight_;
+    Connection *conn = task->conn;
+    // 连接在等待期间已关闭（可能已被复用），结果直接丢弃
+    if (conn->generation() == task->generation &&
+        conn->state() == ConnectionState::WAITING_IO) {
+        // 为按需缓存读入的文件先尝试写入缓存，未准入时按普通响应发送
+        if (task->error != 0) {
+            conn->setCachedResponse(HttpResponse::prebuiltError(404, conn->keepAlive()));
+        } else if (!task->filled || !fillCache(*conn, task->url_path, task->path, task->data)) {
+            HttpResponse response;
+            {
+                response.setStatusCode(200);
+                response.setContentType(HttpResponse::getContentType(task->path));
+                if (task->kind == IoTask::STAT_OPEN) {
+                    response.setSendFilePath(task->path, task->size);
+                } else {
+                    response.setBody(std::move(task->data));
+                }
+            }
+            response.setKeepAlive(conn->keepAlive());
+            conn->setWriteBuffer(response.build());
+            if (response.useSendfile()) {
+                conn->setSendfile(response.getSendfilePath(),
+                                  response.getSendfileSize());
+                conn->setFileFd(task->fd);  // 文件已在 IO 线程打开
+                task->fd = -1;
+            }
+        }
+        conn->setState(ConnectionState::WRITING);
+#if HPHS_COROUTINES
+        if (config_.coroutines) {
+            resumeCoroutine(conn, now);
+        } else
+#endif
+        {
+            handleWrite(conn, now);
+            resumeRead(conn, now);
+        }
+    }
+    if (task->fd >= 0)
+        close(task->fd);
+    releaseIoTask(task);
+}
+
+// path 预留 PATH_MAX，复用的任务赋值路径不会再分配
+IoTask *Worker::acquireIoTask() {
+    if (io_free_.empty()) {
+        IoTask *task = new IoTask;
+        task->path.reserve(PATH_MAX);
+        return task;
+    }
+    IoTask *task = io_free_.back();
+    io_free_.pop_back();
+    return task;
+}
+
+// 结果字段清零后放回；读入的文件内容已移交响应或缓存，剩下的缓冲区直接释放
+void Worker::releaseIoTask(IoTask *task) {
+    task->path.clear();
+    task->fill_limit = 0;
+    task->url_path.clear();
+    task->error = 0;
+    task->size = 0;
+    task->fd = -1;
+    std::string().swap(task->data);
+    task->filled = false;
+    task->conn = nullptr;
+    task->next = nullptr;
+    io_free_.push_back(task);
+}
+
+// 跨线程消息
+void Worker::post(std::function<void(Worker &)> fn) {
+    WorkerMessage *msg = new WorkerMessage;
+    msg->type = WorkerMessage::CLOSURE;
+    msg->closure = std::move(fn);
+    mailbox_.push(msg);
+}
+
+void Worker::postConnection(int fd, std::string buffered) {
+    WorkerMessage *msg = new WorkerMessage;
+    msg->type = WorkerMessage::CONNECTION;
+    msg->fd = fd;
+    msg->buffered = std::move(buffered);
+    mailbox_.push(msg);
+}
+
+void Worker::postCacheGeneration(uint64_t generation) {
+    WorkerMessage *msg = new WorkerMessage;
+    msg->type = WorkerMessage::CACHE_GENERATION;
+    msg->generation = generation;
+    mailbox_.push(msg);
+}
+
+void Worker::postWebSocketFrame(uint32_t channel,
+                                std::shared_ptr<const std::string> frame) {
+    WorkerMessage *msg = new WorkerMessage;
+    msg->type = WorkerMessage::WEBSOCKET_FRAME;
+    msg->channel = channel;
+    msg->frame = std::move(frame);
+    mailbox_.push(msg);
+}
+
+// 一次 eventfd 唤醒处理邮箱中的全部消息
+void Worker::handleMessages(const std::chrono::steady_clock::time_point &now) {
+    size_t n = mailbox_.drain([&](WorkerMessage *msg) {
+        switch (msg->type) {
+        case WorkerMessage::CLOSURE:
+            if (msg->closure) msg->closure(*this);
+            break;
+        case WorkerMessage::CONNECTION:
+            adoptConnection(msg->fd, msg->buffered, now);
+            break;
+        case WorkerMessage::CACHE_GENERATION:
+            cache_generation_ = std::max(cache_generation_, msg->generation);
+            raw_cache_.clear();
+            break;
+        case WorkerMessage::IO_COMPLETE:
+            handleIoCompletion(msg->io_task, now);
+            break;
+        case WorkerMessage::WEBSOCKET_FRAME:
+            broadcastWebSocket(msg->channel, msg->frame);
+            break;
+        }
+        delete msg;
+    });
+    message_count_.fetch_add(n, std::memory_order_relaxed);
+}
+
+// 接管其他 Worker 转交的连接：注册到本 epoll，继续处理已缓存的数据
+void Worker::adoptConnection(int fd, std::string &buffered,
+                             const std::chrono::steady_clock::time_point &now) {
+    Connection *conn = registerConnection(fd);
+    if (!conn)
+        return;
+    migrated_in_.fetch_add(1, std::memory_order_relaxed);
+    // 迁移消息不带对端地址，限流时重新取一次
+    if (limiter_) {
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(addr);
+        if (getpeername(fd, reinterpret_cast<sockaddr *>(&addr), &addr_len) == 0)
+            conn->cold().peer = PeerKey::fromAddress(addr);
+    }
+
+    if (!buffered.empty()) {
+        conn->appendRead(buffered.data(), buffered.size());
+    }
+#if HPHS_COROUTINES
+    if (config_.coroutines) {
+        serveConnection(conn);
+        return;
+    }
+#endif
+    handleRead(conn, now);
+}
+
+// 把读入的文件写入按需缓存并改为发送缓存中的响应，未准入时返回 false
+bool Worker::fillCache(Connection &conn, const std::string &url_path,
+                       const std::string &file_path, const std::string &body) {
+    LazyCache *lazy = cache_.lazy();
+    std::string key = ResponseCache::cacheKey(url_path);
+    std::string content_type = HttpResponse::getContentType(file_path);
+    const CacheEntry *entry =
+        lazy->insert(key, LazyCache::hashKey(key),
+                     ResponseCache::buildResponse(content_type, body),
+                     content_type, body.size());
+    if (!entry)
+        return false;
+    conn.setCachedResponse(entry->response);
+    conn.setKeepAlive(true);
+    conn.setState(ConnectionState::WRITING);
+    return true;
+}
+
+// 无 IO 线程池时在事件循环内读入小文件写入缓存，不满足条件时返回 false 走普通路径
+bool Worker::fillCacheSync(Connection &conn, std::string_view path) {
+    char filepath[PATH_MAX];
+    struct stat file_stat;
+    if (!staticFilePath(path, filepath) || stat(filepath, &file_stat) < 0 || !S_ISREG(file_stat.st_mode) ||
+        static_cast<size_t>(file_stat.st_size) > cache_.lazy()->maxEntrySize())
+        return false;
+
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file)
+        return false;
+    std::ostringstream oss;
+    oss << file.rdbuf();
+    return fillCache(conn, std::string(path), filepath, oss.str());
+}
 
+// query 中的参数都在 cache_ignore_query 中时仍按路径查缓存（如 /app.js?v=123）
+bool Worker::cacheableQuery(std::string_view query) const {
+    const std::vector<std::string> &ignored = config_.cache_ignore_query;
+    if (ignored.size() == 1 && ignored[0] == "*")
+        return true;
+    while (!query.empty()) {
+        size_t amp = query.find('&');
+        std::string_view param = query.substr(0, amp);
+        std::string_view name = param.substr(0, param.find('='));
+        if (!name.empty() &&
+            std::find(ignored.begin(), ignored.end(), name) == ignored.end())
+            return false;
+        if (amp == std::string_view::npos)
+            break;
+        query.remove_prefix(amp + 1);
+    }
+    return true;
+}
+
+// 304 只有状态行和几个头，写入连接自身的写缓冲区（随连接复用，预热后不分配）
+bool Worker::notModified(Connection &conn, std::string_view cached,
+                         std::string_view if_none_match) {
+    std::string_view etag = ResponseCache::etagOf(cached);
+    if (!ResponseCache::etagMatches(if_none_match, etag))
+        return false;
+    std::string &out = conn.writeBuffer();
+    out.clear();
+    out.append("HTTP/1.1 304 Not Modified\r\nServer: HPHS/1.0\r\nETag: ");
+    out.append(etag.data(), etag.size());
+    out.append("\r\nConnection: keep-alive\r\n\r\n");
+    conn.setWriteOffset(0);
+    return true;
+}
+
+// 同步模式的静态文件：不存在时回预构建的 404，不分配
+void Worker::serveStaticFile(Connection &conn, std::string_view path, bool keep_alive) {
+    char filepath[PATH_MAX];
     struct stat file_stat;
-    if (stat(filepath.c_str(), &file_stat) < 0) {
-        response.setStatusCode(404);
-        response.setBody("<html><body><h1> 404 Not Found</h1></body></html>");
-        response.setContentType("text/html");
+    if (!staticFilePath(path, filepath) || stat(filepath, &file_stat) < 0) {
+        conn.setCachedResponse(HttpResponse::prebuiltError(404, keep_alive));
         return;
     }
 
+    HttpResponse response;
     response.setStatusCode(200);
     response.setContentType(HttpResponse::getContentType(filepath));
+    response.setKeepAlive(keep_alive);
 
     if (config_.use_sendfile) {
         response.setSendFilePath(filepath, file_stat.st_size);
+        conn.setWriteBuffer(response.build());
+        conn.setSendfile(response.getSendfilePath(), response.getSendfileSize());
     } else {
         std::ifstream file(filepath, std::ios::binary);
         std::ostringstream oss;
         oss << file.rdbuf();
         response.setBody(oss.str());
+        conn.setWriteBuffer(response.build());
     }
 }
 
 // Epoll操作
 bool Worker::addToEpoll(int fd, uint32_t events, Connection *conn) {
+    return addTagToEpoll(fd, events, conn->epollTag());
+}
+
+bool Worker::addTagToEpoll(int fd, uint32_t events, uint64_t tag) {
     struct epoll_event ev{};
     ev.events = events;
-    ev.data.ptr = conn; // 使用指针而非 fd
-    return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == 0;
+    ev.data.u64 = tag;
+    addRelaxed(syscalls_.epoll_ctl, 1);
+    return transport_->epollCtl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == 0;
 }
 
 bool Worker::modifyEpoll(int fd, uint32_t events, Connection *conn) {
     struct epoll_event ev{};
     ev.events = events;
-    ev.data.ptr = conn; // 使用指针而非 fd
-    return epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+    ev.data.u64 = conn->epollTag();
+    addRelaxed(syscalls_.epoll_ctl, 1);
+    return transport_->epollCtl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) == 0;
 }
 
 void Worker::removeFromEpoll(int fd) {
-    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    addRelaxed(syscalls_.epoll_ctl, 1);
+    transport_->epollCtl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
 }
 
-void Worker::closeConnection(Connection *conn) {
+void Worker::closeConnection(Connection *conn, CloseReason reason) {
     if (!conn) return;
+    HPHS_PROBE(close, conn->fd(), static_cast<int>(reason), conn->timing().requests);
 
     conn->setState(ConnectionState::CLOSING);
 
+    const RequestTiming &timing = conn->timing();
+    if (config_.latency_stats && timing.accept_ns != 0) {
+        latency_.lifetime.record(monotonicNs() - timing.accept_ns);
+        latency_.requests_per_conn.record(timing.requests);
+    }
+
+#if HPHS_COROUTINES
+    destroyCoroutine(conn);
+#endif
+    if (conn->cold().ws) {
+        unsubscribeWebSocket(*conn);
+        conn->cold().ws.reset();
+    }
     int fd = conn->fd();
     conn->closeFileFd();
     removeFromEpoll(fd);
-    close(fd);
+    transport_->close(fd);
 
-    // 从活跃列表移除（使用索引实现真正的 O(1)）
-    size_t idx = conn->poolIndex();
-    if (idx < active_conns_.size() && active_conns_[idx] == conn) {
-        // swap-and-pop
-        Connection *last = active_conns_.back();
-        if (last != conn) {
-            active_conns_[idx] = last;
-            last->setPoolIndex(idx); // 更新被移动连接的索引
-        }
-        active_conns_.pop_back();
-    }
-
-    // 归还对象池
-    conn_pool_.release(conn);
+    // 归还槽位，generation 递增使残留的 epoll 事件和 IO 完成失效
+    conns_.release(conn);
+    connection_count_.store(conns_.size(), std::memory_order_relaxed);
 }
 
 void Worker::checkIdleConnections(
@@ -509,12 +1819,107 @@ void Worker::checkIdleConnections(
     std::vector<Connection *> to_close;
     to_close.reserve(100);
 
-    for (Connection *conn : active_conns_) {
-        if (conn && conn->isIdle(config_.idle_timeout_ms, now)) {
+    conns_.forEach([&](Connection *conn) {
+        // WebSocket 连接是长连接，不按空闲超时关闭
+        if (conn->state() != ConnectionState::WEBSOCKET &&
+            conn->isIdle(config_.idle_timeout_ms, now)) {
             to_close.push_back(conn);
         }
-    }
+    });
     for (Connection *conn : to_close) {
-        closeConnection(conn);
+        closeConnection(conn, CloseReason::IDLE);
     }
-}
\ No newline at end of file
+}
+
+// 发布本周期的请求速率，开启均衡时顺带检查是否需要迁出连接
+void Worker::updateLoad(const std::chrono::steady_clock::time_point &now) {
+    uint64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                              now - last_load_tick_).count();
+    uint64_t requests = request_count_.load(std::memory_order_relaxed);
+    uint64_t load = (requests - load_requests_) * 1000 / std::max<uint64_t>(elapsed_ms, 1);
+    load_requests_ = requests;
+    last_load_tick_ = now;
+    load_.store(load, std::memory_order_relaxed);
+
+    if (config_.rebalance_ms > 0 && peers_.size() > 1) {
+        rebalance(load, elapsed_ms);
+    }
+}
+
+// 本 Worker 明显高于均值时，把本周期请求最多的空闲连接迁给当前最轻的 Worker，
+// 迁出量不超过双方差值的一半，迁移后目标不会反超本 Worker；
+// 单个连接的速率超过可迁出量时跳过（迁过去只是把过载换个位置）
+void Worker::rebalance(uint64_t load, uint64_t elapsed_ms) {
+    // 每个连接本周期的请求数，同时推进标记
+    std::vector<std::pair<uint64_t, Connection *>> candidates;
+    conns_.forEach([&](Connection *conn) {
+        RequestTiming &timing = conn->timing();
+        uint64_t rate = (timing.requests - timing.load_mark) * 1000 /
+                        std::max<uint64_t>(elapsed_ms, 1);
+        timing.load_mark = timing.requests;
+        if (rate > 0) candidates.emplace_back(rate, conn);
+    });
+
+    uint64_t total = 0;
+    size_t online = 0;
+    Worker *target = nullptr;
+    uint64_t target_load = UINT64_MAX;
+    for (Worker *peer : peers_) {
+        // 未启动和退役中的 Worker 不参与
+        if (peer != this && peer->state() != State::RUNNING)
+            continue;
+        uint64_t l = peer == this ? load : peer->load();
+        total += l;
+        ++online;
+        if (peer != this && l < target_load) {
+            target_load = l;
+            target = peer;
+        }
+    }
+    uint64_t mean = total / online;
+    if (!target || load < REBALANCE_MIN_LOAD || load * 4 <= mean * 5 ||
+        target_load >= mean)
+        return;
+
+    uint64_t budget = (load - target_load) / 2;
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    uint64_t moved = 0;
+    size_t count = 0;
+    for (const auto &c : candidates) {
+        if (moved + c.first > budget) continue;
+        if (!migratable(*c.second)) continue;
+        migrateConnection(c.second, *target);
+        moved += c.first;
+        ++count;
+    }
+    if (count == 0) return;
+
+    // 先行调整双方发布的负载，下一周期再由实测值覆盖
+    load_.store(load - moved, std::memory_order_relaxed);
+    target->load_.fetch_add(moved, std::memory_order_relaxed);
+    addRelaxed(rebalances_, 1);
+}
+
+// 只迁移处于请求间隙的连接：没有待写的响应、进行中的请求体、打开的文件或未完成的零拷贝发送；
+// 读缓冲区中不完整的请求随连接一起转交
+bool Worker::migratable(Connection &conn) {
+    return conn.state() == ConnectionState::READING && !conn.hasEpollout() &&
+           !conn.logPending() && conn.writeComplete() && !conn.hasCachedResponse() &&
+           conn.fileFd() < 0 && conn.cold().zerocopy_pending == 0;
+}
+
+void Worker::migrateConnection(Connection *conn, Worker &target) {
+    int fd = conn->fd();
+    std::string buffered(conn->readBuffer());
+    removeFromEpoll(fd);
+#if HPHS_COROUTINES
+    destroyCoroutine(conn);
+#endif
+    // fd 不关闭，归还槽位后由目标 Worker 在自己的线程上接管
+    conns_.release(conn);
+    connection_count_.store(conns_.size(), std::memory_order_relaxed);
+    migrated_out_.fetch_add(1, std::memory_order_relaxed);
+    target.postConnection(fd, std::move(buffered));
+}
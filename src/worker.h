@@ -3,57 +3,364 @@
 
 #include "server_config.h"
 #include "connection.h"
-#include "connection_pool.h"
+#include "connection_table.h"
 #include "response_cache.h"
+#include "router.h"
+#include "io_pool.h"
+#include "mailbox.h"
+#include "access_log.h"
+#include "latency_histogram.h"
+#include "probes.h"
+#include "rate_limiter.h"
+#include "raw_request_cache.h"
+#include "transport.h"
+#include <memory>
 #include <thread>
 #include <atomic>
 #include <vector>
+#include <ctime>
+#include <climits>
+#include <string_view>
+#if HPHS_COROUTINES
+#include "coro.h"
+#endif
 
 class Worker{
 public:
-    Worker(int id, const ServerConfig& config, const ResponseCache& cache);
+    Worker(int id, const ServerConfig& config, const ResponseCache& cache,
+           const Router& router, IoPool* io_pool = nullptr);
     ~Worker();
 
-    void start();
+    // 可选组件，需在 start() 之前设置
+    void setAccessLog(AccessLogger* logger) { access_log_ = logger; }
+    // 连接的系统调用经由的传输层，默认直接访问内核
+    void setTransport(Transport* transport) { transport_ = transport; }
+    // 套接字专有的功能（MSG_ZEROCOPY、splice 上传）只在内核套接字上启用，其他传输层退回普通读写
+    bool socketTransport() const { return transport_ == &SocketTransport::instance(); }
+    // 所有 Worker 共享的监听套接字（不含 {worker} 的 UNIX 端点），fd 归 HttpServer 所有
+    void addSharedListener(int fd, bool tcp) { listeners_.push_back({fd, tcp, false, {}}); }
+    // 参与负载均衡的全部 Worker（含自身及尚未启动的），运行期只读；迁移只选 RUNNING 的目标
+    void setPeers(std::vector<Worker*> peers) { peers_ = std::move(peers); }
+
+    // start() 失败（epoll 或监听套接字）时返回 false；退役并 join 之后可以再次 start()
+    bool start();
     void stop();
     void join();
 
+    // 运行状态：STOPPED（未启动或已退役）→ RUNNING → DRAINING（退役中）→ STOPPED
+    enum class State : uint8_t { STOPPED, RUNNING, DRAINING };
+    State state() const { return state_.load(std::memory_order_acquire); }
+    static const char* stateName(State state);
+    // 退役（任意线程调用）：关闭本 Worker 的监听套接字（先接受完已排队的连接），
+    // 空闲连接迁给其他 RUNNING Worker，进行中的请求完成后再迁，超过 drain_timeout_ms 的关闭；
+    // 全部迁出后线程退出并释放连接表等资源，调用方随后 join()
+    void retire();
+    // join 之后调用：邮箱中残留的迁入连接转交 target，其余消息丢弃
+    void handOff(Worker& target);
+
+    // 不启动事件循环线程，在调用线程上驱动本 Worker（配合 MemoryTransport 做确定性的基准和回放）：
+    // attachConnection 把 fd 当作刚接受的连接注册；poll 从传输层取一批就绪事件处理，返回事件数
+    // 内存传输层不报告邮箱的 eventfd，poll 直接检查邮箱，IO 线程池的完成照常处理
+    bool attachConnection(int fd);
+    int poll(int timeout_ms = 0);
+    // 已提交给 IO 线程池、尚未处理完成的任务数，只在驱动 poll 的线程上读取
+    uint32_t ioInflight() const {
+        return io_inflight_;
+    }
+
+    int id() const {
+        return id_;
+    }
     size_t connectionCount() const {
-        return active_conns_.size();
+        return connection_count_.load(std::memory_order_relaxed);
     }
     uint64_t requestCount() const {
         return request_count_;
     }
+    // 线程已消耗的 CPU 时间（纳秒），忙轮询模式下用来衡量用核心换延迟的代价
+    uint64_t cpuTimeNs() const;
+    uint64_t busyPolls() const {
+        return busy_polls_.load(std::memory_order_relaxed);
+    }
+    uint64_t blockingWaits() const {
+        return blocking_waits_.load(std::memory_order_relaxed);
+    }
+    // 最近一个统计周期的请求速率（请求/秒）；迁移连接时发送方会先行调整双方的值，
+    // 避免多个过载 Worker 在同一周期内挤向同一个目标
+    uint64_t load() const {
+        return load_.load(std::memory_order_relaxed);
+    }
+    uint64_t migratedOut() const {
+        return migrated_out_.load(std::memory_order_relaxed);
+    }
+    uint64_t migratedIn() const {
+        return migrated_in_.load(std::memory_order_relaxed);
+    }
+    // 迁出过连接的均衡周期数；事件循环内不打印，由 stats 观测
+    uint64_t rebalances() const {
+        return rebalances_.load(std::memory_order_relaxed);
+    }
+    // 静态文件 GET/HEAD 的缓存命中 / 未命中次数
+    uint64_t cacheHits() const {
+        return cache_hits_.load(std::memory_order_relaxed);
+    }
+    uint64_t cacheMisses() const {
+        return cache_misses_.load(std::memory_order_relaxed);
+    }
+    // 跳过解析、由原始请求头直接命中的请求数
+    uint64_t rawHits() const {
+        return raw_hits_.load(std::memory_order_relaxed);
+    }
+    size_t rawCacheCapacity() const { return raw_cache_.capacity(); }
+    // 零拷贝发送计数，任意线程可读取
+    struct ZerocopyCounters {
+        std::atomic<uint64_t> sends{0};      // 以 MSG_ZEROCOPY 发出的次数
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> completed{0};  // 完成通知：内核确实未拷贝
+        std::atomic<uint64_t> copied{0};     // 完成通知：内核退回了拷贝（如回环、网卡不支持）
+        std::atomic<uint64_t> fallbacks{0};  // 超过阈值但走了普通 writev（不支持或 ENOBUFS）
+    };
+    const ZerocopyCounters& zerocopy() const {
+        return zerocopy_;
+    }
+    // 热路径系统调用计数，任意线程可读取
+    struct SyscallCounters {
+        std::atomic<uint64_t> epoll_wait{0};
+        std::atomic<uint64_t> epoll_ctl{0};
+        std::atomic<uint64_t> accept{0};
+        std::atomic<uint64_t> read{0};
+        std::atomic<uint64_t> write{0};      // writev / write / send
+        std::atomic<uint64_t> sendfile{0};
+    };
+    const SyscallCounters& syscalls() const {
+        return syscalls_;
+    }
+    // WebSocket 计数，任意线程可读取
+    struct WebSocketCounters {
+        std::atomic<uint64_t> connections{0};   // 当前已升级的连接
+        std::atomic<uint64_t> messages{0};      // 收到的完整数据消息
+        std::atomic<uint64_t> frames{0};        // 发出的帧（含排队后发出的）
+        std::atomic<uint64_t> queued{0};        // 未能直接写完、进入发送队列的帧
+        std::atomic<uint64_t> dropped{0};       // 发送队列超限被丢弃的帧
+        std::atomic<uint64_t> slow_closed{0};   // 发送队列超限被断开的连接
+    };
+    const WebSocketCounters& webSocket() const {
+        return ws_;
+    }
+    // 按客户端限流，未配置时为空；计数任意线程可读取
+    const RateLimiter* rateLimiter() const { return limiter_.get(); }
+    // 在线 Worker 数变化后重新分摊限流配额，只能在本 Worker 线程上调用（经 post 投递）
+    void setRateShare(int active_workers) {
+        if (limiter_) limiter_->setWorkers(static_cast<uint32_t>(active_workers));
+    }
+    // 分阶段延迟直方图，任意线程可读取合并
+    const LatencyStats& latency() const {
+        return latency_;
+    }
+
+    // 跨线程投递（任意线程调用），消息在本 Worker 线程上按序处理
+    void post(WorkerMessage* msg) { mailbox_.push(msg); }
+    void post(std::function<void(Worker&)> fn);
+    void postConnection(int fd, std::string buffered);
+    void postCacheGeneration(uint64_t generation);
+    void postWebSocketFrame(uint32_t channel, std::shared_ptr<const std::string> frame);
+
+    // 以下只能在本 Worker 线程上调用（例如 post 的闭包内）
+    uint64_t cacheGeneration() const { return cache_generation_; }
+    uint64_t messageCount() const {
+        return message_count_.load(std::memory_order_relaxed);
+    }
+#if HPHS_COROUTINES
+    // 协程帧池（本 Worker 线程上或 join 之后读取）
+    const FramePool& framePool() const { return frames_; }
+#endif
 
 private:
+    // 单写者计数器：只有所属 Worker 写，不需要原子读改写
+    static void addRelaxed(std::atomic<uint64_t>& counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n,
+                      std::memory_order_relaxed);
+    }
+
     void run();
-    int createListenSocket();
+    bool openListeners();
+    void closeListeners();
+    bool drain(const std::chrono::steady_clock::time_point& now);
+    void stopAccepting(const std::chrono::steady_clock::time_point& now);
+    void releaseResources();
+    void configureListenSocket(int fd);
+    void enableEpollBusyPoll();
+    int nextPollTimeout(int events);
 
-    void handleAccept();
-    void handleRead(Connection* conn, const std::chrono::steady_clock::time_point & now);
+    void dispatchEvents(const struct epoll_event* events, int n,
+                        const std::chrono::steady_clock::time_point& now);
+    void handleAccept(int listen_fd, bool tcp, const std::chrono::steady_clock::time_point& now);
+    Connection* registerConnection(int fd);
+    void rejectConnection(int fd);
+    // fresh_edge：由本轮 EPOLLIN 边沿触发（无 EPOLLRDHUP），短读后可以不再读到 EAGAIN
+    void handleRead(Connection* conn, const std::chrono::steady_clock::time_point & now,
+                    bool fresh_edge = false);
     void handleWrite(Connection* conn, const std::chrono::steady_clock::time_point & now);
-    void closeConnection(Connection* conn);
+    bool processBuffered(Connection* conn, const std::chrono::steady_clock::time_point & now);
+    void resumeRead(Connection* conn, const std::chrono::steady_clock::time_point & now);
+    void closeConnection(Connection* conn, CloseReason reason);
 
     size_t processRequest(Connection& conn, std::string_view data={});
-    void serveStaticFile(const std::string& path, class HttpResponse& response);
+    int pollEvents(int timeout_ms);
+    void beginBody(Connection& conn, const class HttpRequest& request);
+    void sendContinue(Connection& conn);
+    size_t consumeBody(Connection& conn, std::string_view data);
+    int spliceBody(Connection& conn);
+    void finishBody(Connection& conn);
+    void setErrorResponse(Connection& conn, int status);
+    void beginAccessLog(Connection& conn, const class HttpRequest& request);
+    void commitAccessLog(Connection& conn);
+    void recordParsed(Connection& conn);
+    void dispatchRoute(Connection& conn, const class HttpRequest& request,
+                       const Router::Match& match);
+    void serveStaticFile(Connection& conn, std::string_view path, bool keep_alive);
+    bool staticFilePath(std::string_view path, char (&out)[PATH_MAX]) const;
+    bool cacheableQuery(std::string_view query) const;
+    bool notModified(Connection& conn, std::string_view cached, std::string_view if_none_match);
+    void submitStaticFile(Connection& conn, const class HttpRequest& request, bool fill);
+    IoTask* acquireIoTask();
+    void releaseIoTask(IoTask* task);
+    bool fillCache(Connection& conn, const std::string& url_path,
+                   const std::string& file_path, const std::string& body);
+    bool fillCacheSync(Connection& conn, std::string_view path);
+    void handleIoCompletion(IoTask* task, const std::chrono::steady_clock::time_point& now);
+    void handleMessages(const std::chrono::steady_clock::time_point& now);
+    void adoptConnection(int fd, std::string& buffered,
+                         const std::chrono::steady_clock::time_point& now);
+    enum class WriteStatus { DONE, AGAIN, ERROR };
+    WriteStatus writeBuffers(Connection& conn, uint64_t& done_ns);
+    WriteStatus writeFile(Connection& conn);
+    bool finishResponse(Connection& conn, uint64_t done_ns);
+    void armWritable(Connection& conn);
+    void disarmWritable(Connection& conn);
     bool sendWithSendfile(Connection& conn);
+    ssize_t sendZerocopy(Connection& conn);
+    void pinCachedResponse(Connection& conn);
+    bool drainErrorQueue(Connection& conn);
     void checkIdleConnections(const std::chrono::steady_clock::time_point & now);
+    void updateLoad(const std::chrono::steady_clock::time_point& now);
+    void rebalance(uint64_t load, uint64_t elapsed_ms);
+    bool migratable(Connection& conn);
+    void migrateConnection(Connection* conn, Worker& target);
 
-    bool addToEpoll(int fd, uint32_t events, Connection* conn = nullptr);
-    bool modifyEpoll(int fd, uint32_t events, Connection* conn = nullptr);
+    // WebSocket（升级后的连接不再经过 HTTP 解析，帧收发在这里处理）
+    bool beginWebSocket(Connection& conn, const class HttpRequest& request, uint32_t channel);
+    void enterWebSocket(Connection& conn);
+    void handleWebSocketRead(Connection* conn, const std::chrono::steady_clock::time_point& now);
+    bool processWebSocketFrames(Connection& conn);
+    bool sendWebSocket(Connection& conn, const websocket::Frame& frame, bool droppable);
+    bool flushWebSocket(Connection& conn);
+    bool closeWebSocket(Connection& conn, uint16_t code);
+    void broadcastWebSocket(uint32_t channel, const websocket::Frame& frame);
+    void unsubscribeWebSocket(Connection& conn);
+
+    bool addToEpoll(int fd, uint32_t events, Connection* conn);
+    bool addTagToEpoll(int fd, uint32_t events, uint64_t tag);
+    bool modifyEpoll(int fd, uint32_t events, Connection* conn);
     void removeFromEpoll(int fd);
 
+#if HPHS_COROUTINES
+    // 协程模式：每个连接一个 serveConnection 协程，挂起时把帧地址记在连接冷数据中，
+    // 由事件循环按等待的事件（或截止时间）恢复；实现在 worker_coro.cpp
+    enum CoroWait : uint8_t { WAIT_NONE, WAIT_READ, WAIT_WRITE, WAIT_IO };
+    struct Suspend;
+    struct ReadOp;
+    struct ReadableOp;
+    struct WriteOp;
+    struct SendfileOp;
+    struct IoOp;
+    CoTask serveConnection(Connection* conn);
+    void wakeCoroutine(Connection* conn, uint32_t events,
+                       const std::chrono::steady_clock::time_point& now);
+    void resumeCoroutine(Connection* conn, const std::chrono::steady_clock::time_point& now);
+    void destroyCoroutine(Connection* conn);
+    void armDeadline(Connection& conn, uint64_t deadline_ns);
+    void runTimers(const std::chrono::steady_clock::time_point& now);
+    int timerTimeout(int timeout) const;
+
+    struct TimerEntry {
+        uint64_t deadline_ns;
+        uint64_t tag;           // Connection::epollTag()，连接关闭后条目自然失效
+        bool operator>(const TimerEntry& other) const { return deadline_ns > other.deadline_ns; }
+    };
+#endif
+
+    // epoll data.u64 中的特殊标记：0 为邮箱，1 起为第 i 个监听套接字，
+    // 不小于 2^32 的值为 Connection::epollTag()
+    static constexpr uint64_t MAILBOX_TAG = 0;
+    static constexpr uint64_t LISTEN_TAG_BASE = 1;
+
+    struct ListenSocket {
+        int fd;
+        bool tcp;
+        bool owned;             // 本 Worker 创建（退出时关闭）
+        std::string unix_path;  // 本 Worker 创建的 UNIX 套接字文件，退出时删除
+    };
+
 private:
     int id_;
     const ServerConfig& config_;
     const ResponseCache& cache_;                // 响应缓存（共享）
-    int listen_fd_ = -1;
+    const Router& router_;                      // 路由表（共享，只读）
+    IoPool* io_pool_;                           // 阻塞 IO 线程池（共享），nullptr 表示在事件循环内同步执行
+    Transport* transport_ = &SocketTransport::instance();
+    Mailbox mailbox_;                           // 跨线程消息（eventfd 注册在本 Worker 的 epoll）
+    uint64_t cache_generation_ = 0;
+    AccessLogger* access_log_ = nullptr;        // 访问日志（共享，每个 Worker 写自己的环）
+    uint64_t log_counter_ = 0;                  // 采样计数
+    LatencyStats latency_;
+    ZerocopyCounters zerocopy_;
+    SyscallCounters syscalls_;
+    WebSocketCounters ws_;
+    std::vector<std::vector<Connection*>> ws_subscribers_;  // 按端点编号的订阅连接，关闭时交换删除
+    const uint32_t conn_events_;                // 连接注册的 epoll 事件，取决于 epoll_register_once
+    uint64_t event_ns_ = 0;                     // 本轮 epoll_wait 返回的时间，开启延迟统计时才更新
+    std::unique_ptr<RateLimiter> limiter_;      // 按客户端限流，未配置任何速率时为空
+    uint32_t limiter_now_ = 0;                  // 本轮 epoll_wait 返回时的限流时钟
+    std::atomic<uint64_t> message_count_{0};
+    std::atomic<uint64_t> cache_hits_{0};
+    std::atomic<uint64_t> cache_misses_{0};
+    RawRequestCache raw_cache_;                 // 原始请求头 → 预构建响应
+    std::atomic<uint64_t> raw_hits_{0};
+    std::vector<ListenSocket> listeners_;
     int epoll_fd_ = -1;
+    std::atomic<State> state_{State::STOPPED};
+    std::chrono::steady_clock::time_point drain_start_;  // 开始退役的时间，未退役时为默认值
+    uint32_t io_inflight_ = 0;                  // 已提交给 IO 线程池、尚未回投的任务
+    std::vector<IoTask*> io_free_;              // 完成后回收的 IoTask，下次提交直接复用
+
+    // 忙轮询：连续空轮询超过 spin_budget_ns_ 后退回阻塞等待，预算按命中情况自适应
+    bool spinning_ = false;                     // 上一次 epoll_wait 是否为 0 超时
+    uint64_t spin_start_ns_ = 0;                // 本轮连续空轮询的开始时间，0 表示上次轮询有事件
+    uint64_t spin_budget_ns_ = 0;
+    std::atomic<uint64_t> busy_polls_{0};       // 空的 0 超时轮询次数
+    std::atomic<uint64_t> blocking_waits_{0};   // 阻塞等待次数
+    clockid_t cpu_clock_ = CLOCK_THREAD_CPUTIME_ID;
+    std::atomic<bool> cpu_clock_ready_{false};
     std::thread thread_;
     std::atomic<bool> running_{false};
-    ConnectionPool conn_pool_;                  // 对象池（构造函数中初始化）
-    std::vector<Connection*> active_conns_;     // 活跃连接列表
+    ConnectionTable conns_;                     // 连接表（槽位 + generation 寻址）
     std::atomic<uint64_t> request_count_{0};
+    std::atomic<size_t> connection_count_{0};   // conns_.size() 的跨线程可读副本
+
+    // 负载发布与连接迁移
+    std::vector<Worker*> peers_;
+    std::atomic<uint64_t> load_{0};
+    std::atomic<uint64_t> migrated_out_{0};
+    std::atomic<uint64_t> migrated_in_{0};
+    std::atomic<uint64_t> rebalances_{0};
+    uint64_t load_requests_ = 0;                // 上一个统计周期结束时的 request_count_
+    std::chrono::steady_clock::time_point last_load_tick_;
+#if HPHS_COROUTINES
+    FramePool frames_;                          // 协程帧池
+    std::vector<TimerEntry> timers_;            // 等待截止时间的最小堆，每个连接至多一个有效条目
+    std::vector<char> scratch_;                 // 协程共用的读缓冲区，挂起前必须消费完或转存
+#endif
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,324 @@
+// 协程版连接处理（HPHS_COROUTINES 构建）
+//
+// serveConnection 把 handleRead / processBuffered / handleWrite 之间的回调跳转
+// 写成一个顺序循环；请求解析、路由、缓存、写出仍复用状态机的同一批函数。
+// 每个等待点先直接尝试系统调用，只有 EAGAIN 时才挂起，缓存命中的热路径不挂起。
+
+#include "worker.h"
+#include "connection.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <functional>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+// 挂起点的公共部分：记录帧地址和等待的事件，限时等待登记截止时间
+struct Worker::Suspend {
+    Worker* worker;
+    Connection* conn;
+    uint8_t wait;
+    uint64_t timeout_ns;        // 0 表示不限时
+    bool suspended = false;
+
+    Suspend(Worker* w, Connection* c, uint8_t what, uint64_t timeout)
+        : worker(w), conn(c), wait(what), timeout_ns(timeout) {}
+
+    void park(std::coroutine_handle<> handle) {
+        ConnectionCold& cold = conn->cold();
+        cold.coro = handle.address();
+        cold.coro_wait = wait;
+        cold.timed_out = false;
+        if (timeout_ns != 0) worker->armDeadline(*conn, monotonicNs() + timeout_ns);
+        suspended = true;
+    }
+
+    bool timedOut() const { return suspended && conn->cold().timed_out; }
+};
+
+// read：返回值与 read(2) 相同，超时返回 -1 / ETIMEDOUT；
+// 被陈旧的边沿事件唤醒时可能仍是 EAGAIN，调用方重试
+struct Worker::ReadOp : Suspend {
+    char* buf;
+    size_t len;
+    ssize_t result = -1;
+    int error = 0;
+
+    ReadOp(Worker* w, Connection* c, char* b, size_t n, uint64_t timeout)
+        : Suspend(w, c, WAIT_READ, timeout), buf(b), len(n) {}
+
+    bool await_ready() {
+        result = worker->transport_->read(conn->fd(), buf, len);
+        error = errno;
+        addRelaxed(worker->syscalls_.read, 1);
+        return result >= 0 || (error != EAGAIN && error != EWOULDBLOCK);
+    }
+    void await_suspend(std::coroutine_handle<> handle) { park(handle); }
+    ssize_t await_resume() {
+        if (suspended) {
+            if (timedOut()) {
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            addRelaxed(worker->syscalls_.read, 1);
+            return worker->transport_->read(conn->fd(), buf, len);
+        }
+        errno = error;
+        return result;
+    }
+};
+
+// 等待可读但不读取（splice 上传），超时返回 false
+struct Worker::ReadableOp : Suspend {
+    ReadableOp(Worker* w, Connection* c, uint64_t timeout)
+        : Suspend(w, c, WAIT_READ, timeout) {}
+
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> handle) { park(handle); }
+    bool await_resume() { return !timedOut(); }
+};
+
+// 写出写缓冲区和预构建响应，阻塞时挂起等待 EPOLLOUT，恢复后再写一次
+struct Worker::WriteOp : Suspend {
+    uint64_t& done_ns;
+    WriteStatus status = WriteStatus::DONE;
+
+    WriteOp(Worker* w, Connection* c, uint64_t& done, uint64_t timeout)
+        : Suspend(w, c, WAIT_WRITE, timeout), done_ns(done) {}
+
+    bool await_ready() {
+        status = worker->writeBuffers(*conn, done_ns);
+        return status != WriteStatus::AGAIN;
+    }
+    void await_suspend(std::coroutine_handle<> handle) {
+        worker->armWritable(*conn);
+        park(handle);
+    }
+    WriteStatus await_resume() {
+        if (!suspended) return status;
+        if (timedOut()) return WriteStatus::ERROR;
+        return worker->writeBuffers(*conn, done_ns);
+    }
+};
+
+// sendfile 部分，与 WriteOp 相同的等待方式
+struct Worker::SendfileOp : Suspend {
+    WriteStatus status = WriteStatus::DONE;
+
+    SendfileOp(Worker* w, Connection* c, uint64_t timeout)
+        : Suspend(w, c, WAIT_WRITE, timeout) {}
+
+    bool await_ready() {
+        status = worker->writeFile(*conn);
+        return status != WriteStatus::AGAIN;
+    }
+    void await_suspend(std::coroutine_handle<> handle) {
+        worker->armWritable(*conn);
+        park(handle);
+    }
+    WriteStatus await_resume() {
+        if (!suspended) return status;
+        if (timedOut()) return WriteStatus::ERROR;
+        return worker->writeFile(*conn);
+    }
+};
+
+// 等待 IO 线程池完成，handleIoCompletion 生成响应后恢复
+struct Worker::IoOp : Suspend {
+    IoOp(Worker* w, Connection* c) : Suspend(w, c, WAIT_IO, 0) {}
+
+    bool await_ready() { return conn->state() != ConnectionState::WAITING_IO; }
+    void await_suspend(std::coroutine_handle<> handle) { park(handle); }
+    void await_resume() {}
+};
+
+CoTask Worker::serveConnection(Connection *conn) {
+    // 每次等待的截止时间即空闲超时，协程模式下不再需要周期扫描
+    const uint64_t idle_ns = static_cast<uint64_t>(config_.idle_timeout_ms) * 1000000;
+    CloseReason reason = CloseReason::ERROR;
+
+    while (true) {
+        ConnectionState state = conn->state();
+
+        // 升级为 WebSocket 后协程结束，帧收发交给事件循环
+        if (state == ConnectionState::WEBSOCKET) {
+            handleWebSocketRead(conn, std::chrono::steady_clock::now());
+            co_return;
+        }
+
+        if (state == ConnectionState::WAITING_IO) {
+            co_await IoOp(this, conn);
+            continue;
+        }
+
+        if (state == ConnectionState::WRITING) {
+            uint64_t done_ns = 0;
+            WriteStatus status;
+            while ((status = co_await WriteOp(this, conn, done_ns, idle_ns)) ==
+                   WriteStatus::AGAIN) {
+            }
+            if (status == WriteStatus::DONE && conn->hasSendfile()) {
+                while ((status = co_await SendfileOp(this, conn, idle_ns)) ==
+                       WriteStatus::AGAIN) {
+                }
+            }
+            if (status == WriteStatus::ERROR)
+                break;
+            if (!finishResponse(*conn, done_ns)) {
+                reason = CloseReason::DONE;
+                break;
+            }
+            continue;
+        }
+
+        // 上传走 splice：socket 中的请求体不读入用户态
+        if (state == ConnectionState::READING_BODY && conn->body().useSplice()) {
+            int r = spliceBody(*conn);
+            if (r < 0) break;
+            if (r == 0 && !co_await ReadableOp(this, conn, idle_ns)) break;
+            continue;
+        }
+
+        // 缓冲区中的流水线请求
+        if (!conn->readBuffer().empty()) {
+            size_t consumed = processRequest(*conn);
+            if (consumed > 0) {
+                conn->consumeReadBuffer(consumed);
+                continue;
+            }
+        }
+
+        ssize_t bytes = co_await ReadOp(this, conn, scratch_.data(), scratch_.size(), idle_ns);
+        if (bytes < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                continue;
+            if (errno == ETIMEDOUT)
+                reason = CloseReason::IDLE;
+            break;
+        }
+        if (bytes == 0) {
+            reason = CloseReason::PEER;
+            break;
+        }
+        if (conn->timing().start_ns == 0) {
+            conn->timing().start_ns = event_ns_;
+        }
+
+        // 快速通道：缓冲区为空时直接在共用缓冲区上解析，响应能一次写完就不挂起
+        std::string_view data(scratch_.data(), bytes);
+        if (conn->readBuffer().empty()) {
+            while (!data.empty()) {
+                size_t consumed = processRequest(*conn, data);
+                if (consumed == 0)
+                    break;
+                data.remove_prefix(consumed);
+
+                if (conn->state() == ConnectionState::WRITING) {
+                    uint64_t done_ns = 0;
+                    WriteStatus status = writeBuffers(*conn, done_ns);
+                    if (status == WriteStatus::DONE && conn->hasSendfile())
+                        status = writeFile(*conn);
+                    if (status == WriteStatus::ERROR)
+                        goto done;
+                    if (status == WriteStatus::AGAIN)
+                        break;  // 循环顶部挂起等待可写
+                    if (!finishResponse(*conn, done_ns)) {
+                        reason = CloseReason::DONE;
+                        goto done;
+                    }
+                    if (conn->busy())
+                        break;  // 升级为 WebSocket
+                } else if (conn->busy()) {
+                    break;
+                }
+            }
+        }
+
+        // 共用缓冲区会被其他协程覆盖，挂起前把剩余数据转存到连接自己的读缓冲区
+        if (!data.empty()) {
+            conn->appendRead(data.data(), data.size());
+        }
+    }
+
+done:
+    closeConnection(conn, reason);
+}
+
+void Worker::wakeCoroutine(Connection *conn, uint32_t events,
+                           const std::chrono::steady_clock::time_point &now) {
+    uint8_t wait = conn->cold().coro_wait;
+    if ((wait == WAIT_READ && (events & EPOLLIN)) ||
+        (wait == WAIT_WRITE && (events & EPOLLOUT))) {
+        resumeCoroutine(conn, now);
+    }
+    // 其他事件忽略：协程下次读写前总会先尝试系统调用，边沿不会丢失
+}
+
+void Worker::resumeCoroutine(Connection *conn,
+                             const std::chrono::steady_clock::time_point &now) {
+    ConnectionCold &cold = conn->cold();
+    void *frame = cold.coro;
+    if (!frame) return;
+    cold.coro = nullptr;
+    cold.coro_wait = WAIT_NONE;
+    cold.deadline_ns = 0;
+    conn->updateActivity(now);
+    std::coroutine_handle<>::from_address(frame).resume();
+}
+
+// 连接在协程挂起期间被外部关闭（EPOLLHUP、服务停止）时销毁协程帧
+void Worker::destroyCoroutine(Connection *conn) {
+    ConnectionCold &cold = conn->cold();
+    if (cold.coro) {
+        void *frame = cold.coro;
+        cold.coro = nullptr;
+        std::coroutine_handle<>::from_address(frame).destroy();
+    }
+}
+
+// 每个连接在堆中至多保留一个有效条目：新截止时间不早于已有条目时只记录下来，
+// 条目到期时再按记录的截止时间顺延，频繁的 keep-alive 等待不会让堆膨胀
+void Worker::armDeadline(Connection &conn, uint64_t deadline_ns) {
+    ConnectionCold &cold = conn.cold();
+    cold.deadline_ns = deadline_ns;
+    if (cold.timer_queued && cold.timer_ns <= deadline_ns) return;
+    cold.timer_queued = true;
+    cold.timer_ns = deadline_ns;
+    timers_.push_back({deadline_ns, conn.epollTag()});
+    std::push_heap(timers_.begin(), timers_.end(), std::greater<TimerEntry>());
+}
+
+void Worker::runTimers(const std::chrono::steady_clock::time_point &now) {
+    if (timers_.empty()) return;
+    uint64_t now_ns = monotonicNs();
+    while (!timers_.empty() && timers_.front().deadline_ns <= now_ns) {
+        std::pop_heap(timers_.begin(), timers_.end(), std::greater<TimerEntry>());
+        TimerEntry entry = timers_.back();
+        timers_.pop_back();
+
+        Connection *conn = conns_.find(entry.tag);
+        if (!conn) continue;
+        ConnectionCold &cold = conn->cold();
+        // 已被更早的条目取代
+        if (!cold.timer_queued || cold.timer_ns != entry.deadline_ns) continue;
+        cold.timer_queued = false;
+        // 已不在限时等待中
+        if (!cold.coro || cold.deadline_ns == 0) continue;
+        if (cold.deadline_ns > now_ns) {
+            armDeadline(*conn, cold.deadline_ns);
+            continue;
+        }
+        cold.timed_out = true;
+        resumeCoroutine(conn, now);
+    }
+}
+
+// epoll_wait 的阻塞时间不超过最近的截止时间
+int Worker::timerTimeout(int timeout) const {
+    if (timeout == 0 || timers_.empty()) return timeout;
+    uint64_t now_ns = monotonicNs();
+    uint64_t deadline = timers_.front().deadline_ns;
+    if (deadline <= now_ns) return 0;
+    uint64_t ms = (deadline - now_ns + 999999) / 1000000;
+    return ms < static_cast<uint64_t>(timeout) ? static_cast<int>(ms) : timeout;
+}
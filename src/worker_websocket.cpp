@@ -0,0 +1,263 @@
+// WebSocket 连接处理
+//
+// 升级请求在 dispatchRoute 中校验，101 写完后连接转入 WEBSOCKET 状态并加入所在 Worker 的订阅表。
+// 广播的帧只编码一次，各 Worker 通过邮箱拿到同一个 shared_ptr，在自己的线程上逐个写给订阅连接：
+// 发送队列为空时直接 write，写不完的帧以引用的形式挂到连接的发送队列，EPOLLOUT 时 writev 续写，
+// 不为每个连接拷贝帧内容。队列超过 websocket_queue_limit 的慢消费者丢弃新帧或被断开。
+
+#include "worker.h"
+#include "connection.h"
+#include "http_request.h"
+
+#include <cerrno>
+#include <sys/uio.h>
+#include <unistd.h>
+
+static constexpr int WS_MAX_IOV = 64;
+static constexpr size_t WS_READ_CHUNK = 16384;
+static constexpr size_t WS_MESSAGE_KEEP = 65536;    // 消息缓冲区超过该容量时用完即释放
+
+// 校验通过时把 101 放进写缓冲区，写完后由 finishResponse 转入 WebSocket
+bool Worker::beginWebSocket(Connection &conn, const HttpRequest &request,
+                            uint32_t channel) {
+    std::string response = websocket::handshakeResponse(request);
+    if (response.empty())
+        return false;
+    conn.setWriteBuffer(std::move(response));
+    conn.setKeepAlive(true);
+    conn.cold().ws = std::make_unique<WebSocketState>();
+    conn.cold().ws->channel = channel;
+    return true;
+}
+
+void Worker::enterWebSocket(Connection &conn) {
+    WebSocketState &ws = *conn.cold().ws;
+    conn.setState(ConnectionState::WEBSOCKET);
+    if (ws_subscribers_.size() <= ws.channel)
+        ws_subscribers_.resize(ws.channel + 1);
+    std::vector<Connection *> &subscribers = ws_subscribers_[ws.channel];
+    ws.subscriber = static_cast<uint32_t>(subscribers.size());
+    subscribers.push_back(&conn);
+    ws.open = true;
+    addRelaxed(ws_.connections, 1);
+}
+
+// 从订阅表中交换删除，被换过来的连接更新自己的下标
+void Worker::unsubscribeWebSocket(Connection &conn) {
+    WebSocketState &ws = *conn.cold().ws;
+    if (!ws.open)
+        return;
+    ws.open = false;
+    std::vector<Connection *> &subscribers = ws_subscribers_[ws.channel];
+    Connection *last = subscribers.back();
+    subscribers[ws.subscriber] = last;
+    last->cold().ws->subscriber = ws.subscriber;
+    subscribers.pop_back();
+    ws_.connections.store(ws_.connections.load(std::memory_order_relaxed) - 1,
+                          std::memory_order_relaxed);
+}
+
+void Worker::handleWebSocketRead(Connection *conn,
+                                 const std::chrono::steady_clock::time_point &now) {
+    conn->updateActivity(now);
+    int fd = conn->fd();
+    // 紧跟握手到达的帧已在读缓冲区中
+    if (!processWebSocketFrames(*conn)) {
+        closeConnection(conn, CloseReason::WEBSOCKET);
+        return;
+    }
+
+    char buffer[WS_READ_CHUNK];
+    CloseReason reason = CloseReason::WEBSOCKET;
+    while (true) {
+        ssize_t n = transport_->read(fd, buffer, sizeof(buffer));
+        addRelaxed(syscalls_.read, 1);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return;
+            if (errno == EINTR)
+                continue;
+            reason = CloseReason::ERROR;
+            break;
+        }
+        if (n == 0) {
+            reason = CloseReason::PEER;
+            break;
+        }
+        // 已发出 close 帧：等发送队列写完，期间收到的数据丢弃
+        if (conn->cold().ws->closing)
+            continue;
+        conn->appendRead(buffer, n);
+        if (!processWebSocketFrames(*conn))
+            break;
+    }
+    closeConnection(conn, reason);
+}
+
+// 处理读缓冲区中的完整帧，返回 false 表示应立即关闭连接
+bool Worker::processWebSocketFrames(Connection &conn) {
+    WebSocketState &ws = *conn.cold().ws;
+    while (!ws.closing) {
+        std::string_view data = conn.readBuffer();
+        websocket::FrameHeader header;
+        int head = websocket::parseHeader(data, header);
+        if (head == 0)
+            return true;
+        if (head < 0)
+            return closeWebSocket(conn, 1002);
+        bool control = (header.opcode & 0x8) != 0;
+        if (!control && header.length > websocket::MAX_MESSAGE_SIZE - ws.message.size())
+            return closeWebSocket(conn, 1009);
+        if (data.size() - head < header.length)
+            return true;
+
+        if (header.opcode == websocket::CONTINUATION) {
+            if (ws.message_opcode == 0)
+                return closeWebSocket(conn, 1002);
+        } else if (header.opcode == websocket::TEXT || header.opcode == websocket::BINARY) {
+            if (ws.message_opcode != 0)
+                return closeWebSocket(conn, 1002);
+            ws.message_opcode = header.opcode;
+        } else if (header.opcode != websocket::CLOSE && header.opcode != websocket::PING &&
+                   header.opcode != websocket::PONG) {
+            return closeWebSocket(conn, 1002);
+        }
+
+        // 去掉掩码：数据帧拼到消息缓冲区，控制帧单独存放（不超过 125 字节）
+        std::string control_payload;
+        std::string &out = control ? control_payload : ws.message;
+        const char *payload = data.data() + head;
+        size_t base = out.size();
+        size_t len = static_cast<size_t>(header.length);
+        out.resize(base + len);
+        for (size_t i = 0; i < len; ++i)
+            out[base + i] = static_cast<char>(payload[i] ^ header.mask[i & 3]);
+        conn.consumeReadBuffer(head + len);
+
+        if (header.opcode == websocket::PING) {
+            if (!sendWebSocket(conn, websocket::makeFrame(websocket::PONG, control_payload),
+                               false))
+                return false;
+        } else if (header.opcode == websocket::CLOSE) {
+            // 回应对端的状态码，发送队列写完后关闭
+            uint16_t code = control_payload.size() >= 2
+                                ? static_cast<uint16_t>(
+                                      (static_cast<uint8_t>(control_payload[0]) << 8) |
+                                      static_cast<uint8_t>(control_payload[1]))
+                                : 1000;
+            return closeWebSocket(conn, code);
+        } else if (!control && header.fin) {
+            addRelaxed(ws_.messages, 1);
+            const WebSocketHandler &handler = router_.webSocketHandler(ws.channel);
+            if (handler)
+                handler(ws.channel, ws.message, ws.message_opcode == websocket::BINARY);
+            ws.message.clear();
+            if (ws.message.capacity() > WS_MESSAGE_KEEP)
+                ws.message.shrink_to_fit();
+            ws.message_opcode = 0;
+        }
+    }
+    return true;
+}
+
+// 发出 close 帧并停止接收；返回 false 表示帧已写完（或写失败），调用方可以直接关闭
+bool Worker::closeWebSocket(Connection &conn, uint16_t code) {
+    WebSocketState &ws = *conn.cold().ws;
+    ws.closing = true;
+    conn.clearReadBuffer();
+    char payload[2] = {static_cast<char>(code >> 8), static_cast<char>(code & 0xFF)};
+    if (!sendWebSocket(conn, websocket::makeFrame(websocket::CLOSE,
+                                                  std::string_view(payload, 2)),
+                       false))
+        return false;
+    return !ws.out.empty();
+}
+
+// 发送一帧：队列为空时直接写，写不完时把帧的引用挂到发送队列，返回 false 表示应关闭连接
+// droppable 的帧（广播）在队列超限时按配置丢弃或断开，控制帧总是入队
+bool Worker::sendWebSocket(Connection &conn, const websocket::Frame &frame,
+                           bool droppable) {
+    WebSocketState &ws = *conn.cold().ws;
+    size_t offset = 0;
+    if (ws.out.empty()) {
+        ssize_t n = transport_->write(conn.fd(), frame->data(), frame->size());
+        addRelaxed(syscalls_.write, 1);
+        if (n == static_cast<ssize_t>(frame->size())) {
+            addRelaxed(ws_.frames, 1);
+            return true;
+        }
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return false;
+            n = 0;
+        }
+        offset = static_cast<size_t>(n);
+        ws.out_offset = offset;
+        armWritable(conn);
+    } else if (droppable &&
+               ws.queued_bytes + frame->size() > config_.websocket_queue_limit) {
+        if (config_.websocket_drop_slow) {
+            addRelaxed(ws_.dropped, 1);
+            return true;
+        }
+        addRelaxed(ws_.slow_closed, 1);
+        return false;
+    }
+    ws.out.push_back(frame);
+    ws.queued_bytes += frame->size() - offset;
+    addRelaxed(ws_.queued, 1);
+    return true;
+}
+
+// EPOLLOUT：writev 续写发送队列，写空后撤掉 EPOLLOUT；返回 false 表示应关闭连接
+bool Worker::flushWebSocket(Connection &conn) {
+    WebSocketState &ws = *conn.cold().ws;
+    while (!ws.out.empty()) {
+        struct iovec iov[WS_MAX_IOV];
+        int iovcnt = 0;
+        for (auto it = ws.out.begin(); it != ws.out.end() && iovcnt < WS_MAX_IOV;
+             ++it, ++iovcnt) {
+            size_t skip = iovcnt == 0 ? ws.out_offset : 0;
+            iov[iovcnt].iov_base = const_cast<char *>((*it)->data() + skip);
+            iov[iovcnt].iov_len = (*it)->size() - skip;
+        }
+        ssize_t n = transport_->writev(conn.fd(), iov, iovcnt);
+        addRelaxed(syscalls_.write, 1);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        ws.queued_bytes -= static_cast<size_t>(n);
+        size_t sent = static_cast<size_t>(n);
+        while (sent > 0) {
+            size_t rest = ws.out.front()->size() - ws.out_offset;
+            if (sent < rest) {
+                ws.out_offset += sent;
+                break;
+            }
+            sent -= rest;
+            ws.out.pop_front();
+            ws.out_offset = 0;
+            addRelaxed(ws_.frames, 1);
+        }
+    }
+    disarmWritable(conn);
+    return !ws.closing;
+}
+
+void Worker::broadcastWebSocket(uint32_t channel, const websocket::Frame &frame) {
+    if (channel >= ws_subscribers_.size())
+        return;
+    std::vector<Connection *> &subscribers = ws_subscribers_[channel];
+    // 倒序遍历：关闭的连接被交换删除，换到当前位置的是已经处理过的连接
+    for (size_t i = subscribers.size(); i-- > 0;) {
+        Connection *conn = subscribers[i];
+        if (conn->cold().ws->closing)
+            continue;
+        if (!sendWebSocket(*conn, frame, true))
+            closeConnection(conn, CloseReason::WEBSOCKET);
+    }
+}